@@ -1,5 +1,6 @@
 #include <SPI.h>
 #include "Pinnacle.h"
+#include "Baseline.h"
 
 // ___ Using a Cirque 1CA027 (Pinnacle IC) with an Arduino to make cap-sense measurements___
 // This demonstration application is built to work with a Teensy 3.1/3.2 but it can easily be adapted to
@@ -38,6 +39,26 @@
 
 #define ENABLE_SERIAL_DEBUG
 
+// A measurement normally completes within a few milliseconds. One that hasn't after this long is
+// abandoned, so a sensor that stops responding can't hang loop().
+#define ADC_TIMEOUT_US    20000
+#define ERA_TIMEOUT_US    5000
+
+// Results of ADC_PollMeasurement() and Sequencer_Service()
+#define ADC_BUSY          0
+#define ADC_DONE          1
+#define ADC_TIMEOUT       2
+
+// Measurement sequencer (see Sequencer_Start()).
+// By default each vector is written only after the previous result has been read. Set SEQ_PIPELINE
+// to 1 to write the next vector while the current measurement runs instead; that assumes Pinnacle
+// has taken the toggle/polarity bytes when the measurement started, so CompareSequencer() checks the
+// results against ADC_TakeMeasurement() at start-up and turns pipelining back off if they differ.
+#define SEQ_PIPELINE          0
+#define SEQ_DR_SETTLE_US      50    // DR may still read high this long after the flags are cleared
+#define SEQ_COMPARE_ROUNDS    20    // rounds of Measurements[] timed each way at start-up
+#define SEQ_MATCH_MARGIN      8     // counts a sequencer average may lie outside the per-vector spread
+
 typedef struct
 {
   unsigned long Toggle;
@@ -58,8 +79,31 @@ MeasVector Measurements[] =
 
 const int NumberMeasurements = sizeof(Measurements) / sizeof(Measurements[0]);
 
-int MeasurementResults[NumberMeasurements];
-int Compensation[NumberMeasurements];
+// Each measurement's baseline and level (see Baseline.h)
+baseline_t Baselines[NumberMeasurements];
+
+const baselineConfig_t BaselineConfig =
+{
+  40,     // proximity
+  150,    // touch
+  15,     // hysteresis
+  4,      // noiseMultiple
+  3,      // debounce
+  6,      // driftShift
+  3000,   // maxFreeze, a few seconds
+};
+
+unsigned long MeasStartedAt = 0;    // micros() when the running measurement was started
+unsigned long MeasTimeouts = 0;     // measurements abandoned since power-up
+
+// Sequencer state
+bool SeqPipeline = SEQ_PIPELINE;    // cleared by CompareSequencer() if pipelined results don't match
+int SeqIndex = 0;                   // entry of Measurements[] being measured
+unsigned char VectorShadow[8];      // what HostReg__19..26 hold, so unchanged bytes aren't rewritten
+bool VectorShadowValid = false;
+unsigned long SeqClearedAt = 0;     // micros() when Status1 was last cleared
+unsigned long SeqBytesWritten = 0;  // toggle/polarity bytes sent and skipped by Sequencer_Program()
+unsigned long SeqBytesSkipped = 0;
 
 // setup() gets called once at power-up, sets up serial debug output and Cirque's Pinnacle ASIC.
 void setup()
@@ -71,52 +115,59 @@ void setup()
   #endif
 
   Pinnacle_Init();
-  SimpleCompInit();
+  BaselineInit();
+  CompareSequencer();
+  Sequencer_Start();
 }
 
+// loop() never waits on the sensor: the sequencer measures Measurements[] over and over, and each
+// pass only picks up a result if one is ready, so other work can be added here without being held up.
+// Results go to each measurement's baseline, and a line is printed when one changes level.
 void loop()
 {
-  int Signal[NumberMeasurements];
-  int i;
-  // Make all of the measurements
-  for (i=0;i<NumberMeasurements;i++)
+  int Index;
+  signed short Value;
+
+  switch(Sequencer_Service(&Index, &Value))
   {
-    MeasurementResults[i] = ADC_TakeMeasurement(Measurements[i].Toggle, Measurements[i].Positive);
-    // compensate the measurement
-    Signal[i] = MeasurementResults[i] - Compensation[i];
+    case ADC_BUSY:
+      return;
+    case ADC_DONE:
+      break;
+    case ADC_TIMEOUT:
+      MeasTimeouts++;     // the baseline just misses one result
+      return;
   }
 
+  if(!Baseline_update(&Baselines[Index], &BaselineConfig, Value)) return;
+
 #ifdef ENABLE_SERIAL_DEBUG
-  for (i=0;i<NumberMeasurements;i++)
+  Serial.print("Meas ");
+  Serial.print(Index);
+  Serial.print(": ");
+  Serial.print(Baseline_levelName(Baselines[Index].level));
+  Serial.print("\tsignal ");
+  Serial.print(Baselines[Index].signal);
+  Serial.print("\tnoise ");
+  Serial.print(Baselines[Index].noise >> 4);
+  if(MeasTimeouts)
   {
-    Serial.print("Meas ");
-    Serial.print(i);
-    Serial.print(": ");
-    Serial.print(Signal[i]);
-    Serial.print("\t");
-  } 
-    Serial.println();        
-#endif  
+    Serial.print("\tTimeouts: ");
+    Serial.print(MeasTimeouts);
+  }
+  Serial.println();
+#endif
 }
 
-/* Init a simple compensation scheme where at first boot the measured values are used as the baseline to subtract a finger from on subsequent values */
-void SimpleCompInit()
+/* Start every measurement's baseline over; each one settles on its first BASELINE_SETTLE_SAMPLES results
+   instead of holding up start-up */
+void BaselineInit()
 {
   int x;
-  unsigned short i;
-  signed short Value;
-  signed long AccumValue;
+
   for (x = 0; x < NumberMeasurements; x++)
   {
-    i = 0;
-    AccumValue = 0;
-    while (i < 5)  //take 5 measurements and average them for a bit lower noise compensation value
-    {
-        Value = ADC_TakeMeasurement(Measurements[x].Toggle, Measurements[x].Positive);
-        i++;
-        AccumValue += Value;
-      }
-    Compensation[x] = AccumValue / 5;
+    Baseline_init(&Baselines[x]);
   }
 }
 
@@ -178,13 +229,188 @@ void ADC_SetConfig( unsigned char AccumBits_ElecFreq, unsigned char BitLength, u
   RAP_Write(HostReg__9,ApertureWidth);
 }
 
-/* Take an actual measurement */
-signed short ADC_TakeMeasurement( unsigned long Toggle, unsigned long Polarity )
+/* Time SEQ_COMPARE_ROUNDS rounds of Measurements[] taken one vector at a time with
+   ADC_TakeMeasurement(), then through the sequencer, and print the measurements per second of each.
+   The sequencer's average for each vector must lie within the spread ADC_TakeMeasurement() gave it
+   (plus SEQ_MATCH_MARGIN); if it doesn't while pipelining, pipelining is turned off. */
+void CompareSequencer()
 {
-  unsigned char temp8;
-  unsigned short temp16;
-  signed short K2_Track_ADC_Result;
+  const unsigned long Count = (unsigned long)SEQ_COMPARE_ROUNDS * NumberMeasurements;
+  unsigned long Started, PerVectorMicros, SequencerMicros, Done;
+  signed short Value;
+  signed short Low[NumberMeasurements], High[NumberMeasurements];
+  long Sum[NumberMeasurements];
+  int Taken[NumberMeasurements];
+  int Index, Mismatches = 0;
+  unsigned long i;
+
+  for (Index = 0; Index < NumberMeasurements; Index++)
+  {
+    Low[Index] = 32767;
+    High[Index] = -32768;
+    Sum[Index] = 0;
+    Taken[Index] = 0;
+  }
+
+  Started = micros();
+  for (i = 0; i < Count; i++)
+  {
+    Index = i % NumberMeasurements;
+    if (!ADC_TakeMeasurement(Measurements[Index].Toggle, Measurements[Index].Positive, &Value)) continue;
+    if (Value < Low[Index]) Low[Index] = Value;
+    if (Value > High[Index]) High[Index] = Value;
+  }
+  PerVectorMicros = micros() - Started;
+
+  Sequencer_Start();
+  SeqBytesWritten = SeqBytesSkipped = 0;
+  Started = micros();
+  for (Done = 0; Done < Count; )
+  {
+    switch (Sequencer_Service(&Index, &Value))
+    {
+      case ADC_BUSY:
+        continue;
+      case ADC_DONE:
+        Sum[Index] += Value;
+        Taken[Index]++;
+        break;
+    }
+    Done++;
+  }
+  SequencerMicros = micros() - Started;
+
+  for (Index = 0; Index < NumberMeasurements; Index++)
+  {
+    if (Taken[Index] == 0 || Low[Index] > High[Index]) continue;    // timed out every time, nothing to compare
+    if (Sum[Index] < ((long)Low[Index] - SEQ_MATCH_MARGIN) * Taken[Index] ||
+      Sum[Index] > ((long)High[Index] + SEQ_MATCH_MARGIN) * Taken[Index]) Mismatches++;
+  }
+
+#ifdef ENABLE_SERIAL_DEBUG
+  Serial.print("Measurements/s, per vector: ");
+  Serial.print(Count * 1000000.0 / PerVectorMicros, 1);
+  Serial.print(", sequencer: ");
+  Serial.print(Count * 1000000.0 / SequencerMicros, 1);
+  Serial.print(" (vector bytes written ");
+  Serial.print(SeqBytesWritten);
+  Serial.print(", skipped ");
+  Serial.print(SeqBytesSkipped);
+  Serial.println(")");
+  if (Mismatches)
+  {
+    Serial.print("Sequencer results differ from per-vector ones for ");
+    Serial.print(Mismatches);
+    Serial.print(" of ");
+    Serial.print(NumberMeasurements);
+    Serial.println(SeqPipeline ? " vectors, pipelining turned off" : " vectors");
+  }
+#endif
+
+  if (Mismatches) SeqPipeline = false;
+}
+
+/*  Measurement sequencer  */
+// Runs Measurements[] back-to-back. Compared to ADC_TakeMeasurement() per vector:
+//  - toggle/polarity bytes that are the same as the previous vector's aren't written again, and
+//    the ones that changed go out in a single CS cycle
+//  - with SeqPipeline, the next vector is written while the current measurement runs, so once a
+//    result is in only the result read, the flag clear and the start command remain
+//  - the two result bytes are read in one transfer, and the flags are cleared without a fixed delay
+// NOTE: the measurement info block (HostReg__19..26) only has room for one vector; HostReg__27 up
+// are the ERA window, so AnyMeas_Control_NumMeas stays at 1.
+
+/* Start measuring Measurements[] from the first entry, see Sequencer_Service() */
+void Sequencer_Start()
+{
+  SeqIndex = 0;
+  VectorShadowValid = false;    // ADC_StartMeasurement() writes the registers without the shadow
+  Sequencer_Program(0);
+  Sequencer_Trigger();
+}
+
+/* Picks up the result of the running measurement, if it's ready, and starts the next one.
+   Returns ADC_BUSY, or ADC_DONE (with the result in <*Result>) or ADC_TIMEOUT for the entry of
+   Measurements[] given in <*Index> */
+unsigned char Sequencer_Service(int * Index, signed short * Result)
+{
+  unsigned char Data[2];
+  unsigned char Status = ADC_DONE;
+
+  if(micros() - SeqClearedAt < SEQ_DR_SETTLE_US || !DR_Asserted())
+  {
+    if(micros() - MeasStartedAt < ADC_TIMEOUT_US) return ADC_BUSY;
+    Status = ADC_TIMEOUT;
+  }
+  else
+  {
+    RAP_ReadBytes(AnyMeas_Result_High_Byte, Data, 2);
+    *Result = (signed short)(((unsigned short)Data[0] << 8) | Data[1]);
+  }
+
+  RAP_Write(HOSTREG__STATUS1, 0x00);   // clear DR; Sequencer_Service() ignores it until it has settled
+  SeqClearedAt = micros();
+
+  *Index = SeqIndex;
+  SeqIndex = (SeqIndex + 1) % NumberMeasurements;
+  if(!SeqPipeline) Sequencer_Program(SeqIndex);
+  Sequencer_Trigger();
+  return Status;
+}
+
+/* Starts measuring Measurements[SeqIndex], whose vector has already been written */
+void Sequencer_Trigger()
+{
+  RAP_Write(HostReg__3,0x18);
+  MeasStartedAt = micros();
+  if(SeqPipeline) Sequencer_Program((SeqIndex + 1) % NumberMeasurements);
+}
+
+/* Writes the toggle/polarity bytes of Measurements[<Index>] that differ from what the registers hold */
+void Sequencer_Program(int Index)
+{
+  unsigned char Values[8];
+  unsigned char Pairs[16];
+  unsigned char i, Count = 0;
+
+  for(i = 0; i < 4; i++)
+  {
+    Values[i] = (unsigned char)(Measurements[Index].Toggle >> (24 - 8 * i));
+    Values[i + 4] = (unsigned char)(Measurements[Index].Positive >> (24 - 8 * i));
+  }
+
+  for(i = 0; i < 8; i++)
+  {
+    if(VectorShadowValid && Values[i] == VectorShadow[i]) continue;
+    Pairs[2 * Count] = HostReg__19 + i;
+    Pairs[2 * Count + 1] = Values[i];
+    VectorShadow[i] = Values[i];
+    Count++;
+  }
+  VectorShadowValid = true;
+
+  SeqBytesWritten += Count;
+  SeqBytesSkipped += 8 - Count;
+  if(Count) RAP_WritePairs(Pairs, Count);
+}
+
+/* Take an actual measurement, waiting up to ADC_TIMEOUT_US for it. Returns false if it timed out */
+bool ADC_TakeMeasurement( unsigned long Toggle, unsigned long Polarity, signed short * Result )
+{
+  unsigned char Status;
 
+  ADC_StartMeasurement(Toggle, Polarity);
+  do
+  {
+    Status = ADC_PollMeasurement(Result);
+  } while(Status == ADC_BUSY);
+
+  return Status == ADC_DONE;
+}
+
+/* Start a measurement, ADC_PollMeasurement() picks up the result */
+void ADC_StartMeasurement( unsigned long Toggle, unsigned long Polarity )
+{
   RAP_Write(HostReg__19,((unsigned char)((Toggle >> 24))));
   RAP_Write(HostReg__20,((unsigned char)((Toggle >> 16))));
   RAP_Write(HostReg__21,((unsigned char)((Toggle >> 8))));
@@ -197,10 +423,23 @@ signed short ADC_TakeMeasurement( unsigned long Toggle, unsigned long Polarity )
   
   //Start the measurement
   RAP_Write(HostReg__3,0x18);
+  MeasStartedAt = micros();
+}
 
-  //!!!!! BLOCKS ON RESULT HERE
-  //now wait for DR to go high and then get the measurement result
-  while(!DR_Asserted());      //consider adding a counter, or enabling a watchdog to avoid being stuck forever
+/* Check on the measurement started by ADC_StartMeasurement() without waiting for it.
+   Returns ADC_BUSY while it runs, then ADC_DONE with the result in <*Result>, or ADC_TIMEOUT */
+unsigned char ADC_PollMeasurement( signed short * Result )
+{
+  unsigned char temp8;
+  unsigned short temp16;
+
+  //DR goes high when the measurement result is ready
+  if(!DR_Asserted())
+  {
+    if(micros() - MeasStartedAt < ADC_TIMEOUT_US) return ADC_BUSY;
+    Pinnacle_ClearFlags();    // give up on it, the next measurement starts afresh
+    return ADC_TIMEOUT;
+  }
 
   RAP_ReadBytes(HostReg__17,&temp8,1);
   temp16 = (unsigned short)temp8;
@@ -211,8 +450,8 @@ signed short ADC_TakeMeasurement( unsigned long Toggle, unsigned long Polarity )
   //clear DR
   Pinnacle_ClearFlags();
 
-  K2_Track_ADC_Result = (signed short)temp16;
-  return (K2_Track_ADC_Result);
+  *Result = (signed short)temp16;
+  return ADC_DONE;
 }
 
 // Clears Status1 register flags (SW_CC and SW_DR)
@@ -243,11 +482,9 @@ void Pinnacle_EnableFeed(bool feedEnable)
 
 /*  ERA (Extended Register Access) Functions  */
 // Reads <count> bytes from an extended register at <address> (16-bit address),
-// stores values in <*data>
-void ERA_ReadBytes(uint16_t address, uint8_t * data, uint16_t count)
+// stores values in <*data>. Returns false if Pinnacle stopped responding.
+bool ERA_ReadBytes(uint16_t address, uint8_t * data, uint16_t count)
 {  
-  uint8_t ERAControlValue = 0xFF;
-
   Pinnacle_EnableFeed(false); // Disable feed
 
   RAP_Write(0x1C, (uint8_t)(address >> 8));     // Send upper byte of ERA address
@@ -257,22 +494,20 @@ void ERA_ReadBytes(uint16_t address, uint8_t * data, uint16_t count)
   {
     RAP_Write(0x1E, 0x05);  // Signal ERA-read (auto-increment) to Pinnacle
     
-    // Wait for status register 0x1E to clear
-    do
-    {
-      RAP_ReadBytes(0x1E, &ERAControlValue, 1);
-    } while(ERAControlValue != 0x00);
+    if(!ERA_WaitIdle()) return false;
     
     RAP_ReadBytes(0x1B, data + i, 1);
     
     Pinnacle_ClearFlags();
   }
+  return true;
 }
 
-// Writes a byte, <data>, to an extended register at <address> (16-bit address)
-void ERA_WriteByte(uint16_t address, uint8_t data)
+// Writes a byte, <data>, to an extended register at <address> (16-bit address).
+// Returns false if Pinnacle stopped responding.
+bool ERA_WriteByte(uint16_t address, uint8_t data)
 {
-  uint8_t ERAControlValue = 0xFF;
+  bool Completed;
 
   Pinnacle_EnableFeed(false); // Disable feed
 
@@ -283,13 +518,25 @@ void ERA_WriteByte(uint16_t address, uint8_t data)
 
   RAP_Write(0x1E, 0x02);  // Signal an ERA-write to Pinnacle
 
-  // Wait for status register 0x1E to clear
+  Completed = ERA_WaitIdle();
+    
+  Pinnacle_ClearFlags();
+  return Completed;
+}
+
+// Waits up to ERA_TIMEOUT_US for status register 0x1E to clear. Returns false if it didn't.
+bool ERA_WaitIdle()
+{
+  uint8_t ERAControlValue = 0xFF;
+  unsigned long StartedAt = micros();
+
   do
   {
     RAP_ReadBytes(0x1E, &ERAControlValue, 1);
-  } while(ERAControlValue != 0x00);
-    
-  Pinnacle_ClearFlags();
+    if(ERAControlValue == 0x00) return true;
+  } while(micros() - StartedAt < ERA_TIMEOUT_US);
+
+  return false;
 }
 
 /*  RAP Functions */
@@ -313,6 +560,22 @@ void RAP_ReadBytes(byte address, byte * data, byte count)
   SPI.endTransaction();
 }
 
+// Writes <count> (address, data) pairs from <*pairs> to arbitrary registers in one CS cycle
+void RAP_WritePairs(byte * pairs, byte count)
+{
+  SPI.beginTransaction(SPISettings(10000000, MSBFIRST, SPI_MODE1));
+
+  Assert_CS();
+  for(byte i = 0; i < count; i++)
+  {
+    SPI.transfer(WRITE_MASK | pairs[2 * i]);  // Pinnacle accepts back-to-back address/data pairs
+    SPI.transfer(pairs[2 * i + 1]);
+  }
+  DeAssert_CS();
+
+  SPI.endTransaction();
+}
+
 // Writes single-byte <data> to <address>
 void RAP_Write(byte address, byte data)
 {
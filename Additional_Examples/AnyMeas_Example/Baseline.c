@@ -0,0 +1,125 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "Baseline.h"
+
+static const char * const LEVEL_NAMES[] = { "idle", "proximity", "touch" };
+
+int16_t Baseline_median(int16_t, int16_t, int16_t);
+uint8_t Baseline_target(const baseline_t *, const baselineConfig_t *, uint16_t);
+uint16_t Baseline_threshold(const baseline_t *, const baselineConfig_t *, uint16_t);
+
+void Baseline_init(baseline_t * channel)
+{
+  memset(channel, 0, sizeof(baseline_t));
+}
+
+// Adds <sample> to <channel>. Returns true if the channel's level changed.
+bool Baseline_update(baseline_t * channel, const baselineConfig_t * config, int16_t sample)
+{
+  int16_t filtered;
+  int32_t signal;
+  uint16_t magnitude;
+  uint8_t target, previous = channel->level;
+
+  if(channel->samples == 0)
+  {
+    channel->history[0] = channel->history[1] = sample;
+    channel->baseline = (int32_t)sample * 16;
+  }
+
+  filtered = Baseline_median(channel->history[0], channel->history[1], sample);
+  channel->history[0] = channel->history[1];
+  channel->history[1] = sample;
+
+  if(channel->samples < BASELINE_SETTLE_SAMPLES)
+  {
+    channel->baseline += ((int32_t)filtered * 16 - channel->baseline) >> 1;
+    channel->samples++;
+    channel->signal = 0;
+    return false;
+  }
+
+  signal = (int32_t)filtered - ((channel->baseline + 8) >> 4);
+  if(signal > INT16_MAX) signal = INT16_MAX;
+  if(signal < -INT16_MAX) signal = -INT16_MAX;
+  channel->signal = (int16_t)signal;
+  magnitude = (uint16_t)(signal < 0 ? -signal : signal);
+
+  // debounce changes of level
+  target = Baseline_target(channel, config, magnitude);
+  if(target == channel->level)
+  {
+    channel->debounce = 0;
+  }
+  else
+  {
+    if(target != channel->pending)
+    {
+      channel->pending = target;
+      channel->debounce = 0;
+    }
+    if(++channel->debounce >= config->debounce)
+    {
+      channel->level = target;
+      channel->debounce = 0;
+    }
+  }
+
+  // only an idle channel tracks drift and noise
+  if(channel->level == BASELINE_IDLE && target == BASELINE_IDLE)
+  {
+    channel->baseline += ((int32_t)filtered * 16 - channel->baseline) >> config->driftShift;
+    channel->noise += ((int32_t)magnitude * 16 - channel->noise) >> BASELINE_NOISE_SHIFT;
+    channel->frozenFor = 0;
+  }
+  else if(config->maxFreeze != 0 && ++channel->frozenFor >= config->maxFreeze)
+  {
+    // held too long to be a finger, the baseline must have moved
+    channel->baseline = (int32_t)filtered * 16;
+    channel->signal = 0;
+    channel->level = channel->pending = BASELINE_IDLE;
+    channel->debounce = 0;
+    channel->frozenFor = 0;
+  }
+
+  return channel->level != previous;
+}
+
+const char * Baseline_levelName(uint8_t level)
+{
+  return (level <= BASELINE_TOUCH) ? LEVEL_NAMES[level] : "?";
+}
+
+int16_t Baseline_median(int16_t a, int16_t b, int16_t c)
+{
+  if(a > b)
+  {
+    if(b > c) return b;
+    return (a > c) ? c : a;
+  }
+  if(a > c) return a;
+  return (b > c) ? c : b;
+}
+
+// The level <magnitude> asks for, holding the current level through the hysteresis band
+uint8_t Baseline_target(const baseline_t * channel, const baselineConfig_t * config, uint16_t magnitude)
+{
+  uint16_t touch = Baseline_threshold(channel, config, config->touch);
+  uint16_t proximity = Baseline_threshold(channel, config, config->proximity);
+
+  if(channel->level == BASELINE_TOUCH) touch = (touch > config->hysteresis) ? touch - config->hysteresis : 0;
+  if(channel->level != BASELINE_IDLE) proximity = (proximity > config->hysteresis) ? proximity - config->hysteresis : 0;
+
+  if(magnitude >= touch) return BASELINE_TOUCH;
+  if(magnitude >= proximity) return BASELINE_PROXIMITY;
+  return BASELINE_IDLE;
+}
+
+// <threshold>, raised to noiseMultiple times the channel's noise
+uint16_t Baseline_threshold(const baseline_t * channel, const baselineConfig_t * config, uint16_t threshold)
+{
+  int32_t noisy = (channel->noise * config->noiseMultiple) >> 4;
+
+  return (noisy > threshold) ? (uint16_t)(noisy > UINT16_MAX ? UINT16_MAX : noisy) : threshold;
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Per-channel baseline tracking for AnyMeas results.
+// Each channel keeps a baseline that follows slow drift, an estimate of its noise and a level
+// (idle, proximity or touch). Baseline_update() takes one result at a time in constant time and
+// memory: the result is median-filtered over the last three, compared against the baseline, and the
+// level changes once the difference has crossed a threshold for <debounce> results in a row.
+// While a channel isn't idle its baseline is frozen, so a resting finger isn't tracked away; if it
+// stays frozen for <maxFreeze> results the baseline is re-taken instead.
+// The first BASELINE_SETTLE_SAMPLES results of a channel only seed its baseline.
+
+#ifndef BASELINE_H
+#define BASELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Levels
+#define BASELINE_IDLE             0
+#define BASELINE_PROXIMITY        1
+#define BASELINE_TOUCH            2
+
+#define BASELINE_SETTLE_SAMPLES   8
+#define BASELINE_NOISE_SHIFT      4   // noise follows 1/16 of each idle deviation
+
+typedef struct _baselineConfig
+{
+  uint16_t proximity;       // |signal| at which a channel is in proximity
+  uint16_t touch;           // |signal| at which a channel is touched
+  uint16_t hysteresis;      // a level is held until |signal| drops this far below its threshold
+  uint8_t noiseMultiple;    // thresholds are raised to at least this many times the channel's noise
+  uint8_t debounce;         // results in a row needed to change level
+  uint8_t driftShift;       // an idle baseline moves 1/2^driftShift of the way to each result
+  uint16_t maxFreeze;       // results a channel may stay out of idle before its baseline is re-taken; 0 = never
+} baselineConfig_t;
+
+typedef struct _baseline
+{
+  int32_t baseline;         // x16
+  int32_t noise;            // x16, average |signal| while idle
+  int16_t history[2];       // the previous two results, for the median
+  int16_t signal;           // last filtered result - baseline; positive or negative depending on the vector
+  uint16_t frozenFor;       // results since the channel left idle
+  uint8_t samples;          // results seen, up to BASELINE_SETTLE_SAMPLES
+  uint8_t level;
+  uint8_t pending;          // level being debounced towards
+  uint8_t debounce;         // results in a row that asked for <pending>
+} baseline_t;
+
+void Baseline_init(baseline_t *);
+bool Baseline_update(baseline_t *, const baselineConfig_t *, int16_t);
+const char * Baseline_levelName(uint8_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BASELINE_H
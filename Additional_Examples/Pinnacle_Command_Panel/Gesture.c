@@ -0,0 +1,201 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "Gesture.h"
+#include "Polar.h"
+
+static const char * const TYPE_NAMES[] = { "?", "tap", "swipe", "rotate" };
+
+void Gesture_liftOff(gesture_t *, const gestureConfig_t *, uint32_t, gestureEvent_t *, uint8_t *);
+void Gesture_follow(gesture_t *, const gestureConfig_t *, int32_t, int32_t, gestureEvent_t *, uint8_t *);
+void Gesture_flushTaps(gesture_t *, gestureEvent_t *, uint8_t *);
+void Gesture_emit(gestureEvent_t *, uint8_t *, uint8_t, uint8_t, uint8_t, int8_t);
+uint8_t Gesture_region(const gestureConfig_t *, int32_t, int32_t);
+
+// Settings for a pad reporting Pinnacle's own coordinates: quadrants around a center region,
+// 16 rotation steps to a turn
+void Gesture_initConfig(gestureConfig_t * config)
+{
+  config->xCenter = (PINNACLE_XMAX + 1) / 2;
+  config->yCenter = (PINNACLE_YMAX + 1) / 2;
+  config->centerRadius = 200;
+  config->sectors = 4;
+  config->tapMaxTravel = 80;
+  config->tapMaxMicros = 300000;
+  config->multiTapMicros = 250000;
+  config->swipeMinTravel = 400;
+  config->swipeMaxMicros = 300000;
+  config->rotateMinRadius = 300;
+  config->rotateStart = 0x0C00;   // about 17 degrees
+  config->rotateStep = 0x1000;
+}
+
+void Gesture_init(gesture_t * gesture)
+{
+  memset(gesture, 0, sizeof(gesture_t));
+}
+
+// Feeds the absolute packet <data>, read at <timestamp> (microseconds), to <gesture>. Writes the
+// events it completes to <events> (room for GESTURE_MAX_EVENTS) and returns how many.
+uint8_t Gesture_update(gesture_t * gesture, const gestureConfig_t * config, const absData_t * data, uint32_t timestamp, gestureEvent_t * events)
+{
+  bool touching = data->zValue != 0 && !data->hovering;
+  int32_t xOffset, yOffset;
+  uint16_t travel;
+  uint8_t count = Gesture_poll(gesture, config, timestamp, events);
+
+  if(!touching)
+  {
+    if(gesture->touching) Gesture_liftOff(gesture, config, timestamp, events, &count);
+    return count;
+  }
+
+  xOffset = (int32_t)data->xValue - config->xCenter;
+  yOffset = (int32_t)data->yValue - config->yCenter;
+
+  if(!gesture->touching)
+  {
+    gesture->touching = true;
+    gesture->rotating = false;
+    gesture->inRing = false;
+    gesture->rotation = 0;
+    gesture->travel = 0;
+    gesture->downAt = timestamp;
+    gesture->xDown = data->xValue;
+    gesture->yDown = data->yValue;
+    gesture->region = Gesture_region(config, xOffset, yOffset);
+  }
+
+  travel = (data->xValue > gesture->xDown) ? data->xValue - gesture->xDown : gesture->xDown - data->xValue;
+  if(travel > gesture->travel) gesture->travel = travel;
+  travel = (data->yValue > gesture->yDown) ? data->yValue - gesture->yDown : gesture->yDown - data->yValue;
+  if(travel > gesture->travel) gesture->travel = travel;
+  gesture->xLast = data->xValue;
+  gesture->yLast = data->yValue;
+
+  Gesture_follow(gesture, config, xOffset, yOffset, events, &count);
+  return count;
+}
+
+// Reports the taps held once <multiTapMicros> have passed since the last of them, without a packet.
+// Returns the number of events written to <events>.
+uint8_t Gesture_poll(gesture_t * gesture, const gestureConfig_t * config, uint32_t timestamp, gestureEvent_t * events)
+{
+  uint8_t count = 0;
+
+  if(gesture->taps && !gesture->touching && (uint32_t)(timestamp - gesture->upAt) > config->multiTapMicros)
+  {
+    Gesture_flushTaps(gesture, events, &count);
+  }
+  return count;
+}
+
+const char * Gesture_typeName(uint8_t type)
+{
+  return (type <= GESTURE_ROTATE) ? TYPE_NAMES[type] : "?";
+}
+
+// Ends the stroke of <gesture>: a tap is added to the sequence held, anything else ends that sequence
+// and may be a swipe
+void Gesture_liftOff(gesture_t * gesture, const gestureConfig_t * config, uint32_t timestamp, gestureEvent_t * events, uint8_t * count)
+{
+  uint32_t duration = timestamp - gesture->downAt;
+  int32_t xTravel, yTravel;
+  uint8_t direction;
+
+  gesture->touching = false;
+  if(gesture->rotating) return;
+
+  if(duration <= config->tapMaxMicros && gesture->travel <= config->tapMaxTravel)
+  {
+    if(gesture->taps && gesture->region != gesture->tapRegion) Gesture_flushTaps(gesture, events, count);
+
+    gesture->tapRegion = gesture->region;
+    gesture->taps++;
+    gesture->upAt = timestamp;
+    if(config->multiTapMicros == 0 || gesture->taps >= GESTURE_MAX_TAPS) Gesture_flushTaps(gesture, events, count);
+    return;
+  }
+
+  Gesture_flushTaps(gesture, events, count);
+  if(duration > config->swipeMaxMicros || gesture->travel < config->swipeMinTravel) return;
+
+  xTravel = (int32_t)gesture->xLast - gesture->xDown;
+  yTravel = (int32_t)gesture->yLast - gesture->yDown;
+  if((xTravel < 0 ? -xTravel : xTravel) >= (yTravel < 0 ? -yTravel : yTravel))
+  {
+    direction = (xTravel >= 0) ? GESTURE_RIGHT : GESTURE_LEFT;
+  }
+  else
+  {
+    direction = (yTravel >= 0) ? GESTURE_DOWN : GESTURE_UP;
+  }
+  Gesture_emit(events, count, GESTURE_SWIPE, direction, 0, 0);
+}
+
+// Adds the turn since the last packet in the ring to the rotation, and reports the whole steps of a
+// stroke that has become a rotation
+void Gesture_follow(gesture_t * gesture, const gestureConfig_t * config, int32_t xOffset, int32_t yOffset, gestureEvent_t * events, uint8_t * count)
+{
+  uint32_t minRadius = config->rotateMinRadius;
+  uint16_t angle;
+  int32_t steps;
+
+  if((uint32_t)(xOffset * xOffset + yOffset * yOffset) < minRadius * minRadius)
+  {
+    gesture->inRing = false;
+    return;
+  }
+
+  angle = Polar_angle(xOffset, yOffset, NULL);
+  if(gesture->inRing) gesture->rotation += (int16_t)(angle - gesture->angle);
+  gesture->angle = angle;
+  gesture->inRing = true;
+
+  if(!gesture->rotating)
+  {
+    if(gesture->rotation < config->rotateStart && -gesture->rotation < config->rotateStart) return;
+    gesture->rotating = true;
+    Gesture_flushTaps(gesture, events, count);
+  }
+
+  steps = gesture->rotation / config->rotateStep;
+  if(steps == 0) return;
+  if(steps > INT8_MAX) steps = INT8_MAX;
+  if(steps < -INT8_MAX) steps = -INT8_MAX;
+  gesture->rotation -= steps * config->rotateStep;
+  Gesture_emit(events, count, GESTURE_ROTATE, 0, 0, (int8_t)steps);
+}
+
+// Reports the taps held, if any
+void Gesture_flushTaps(gesture_t * gesture, gestureEvent_t * events, uint8_t * count)
+{
+  if(gesture->taps == 0) return;
+
+  Gesture_emit(events, count, GESTURE_TAP, gesture->tapRegion, gesture->taps, 0);
+  gesture->taps = 0;
+}
+
+void Gesture_emit(gestureEvent_t * events, uint8_t * count, uint8_t type, uint8_t region, uint8_t taps, int8_t steps)
+{
+  gestureEvent_t * event;
+
+  if(*count >= GESTURE_MAX_EVENTS) return;
+
+  event = &events[(*count)++];
+  event->type = type;
+  event->region = region;
+  event->taps = taps;
+  event->steps = steps;
+}
+
+// Region of the point (<xOffset>, <yOffset>) from the center
+uint8_t Gesture_region(const gestureConfig_t * config, int32_t xOffset, int32_t yOffset)
+{
+  uint32_t radius = config->centerRadius;
+
+  if((uint32_t)(xOffset * xOffset + yOffset * yOffset) < radius * radius) return GESTURE_CENTER;
+  if(config->sectors <= 1) return 1;
+
+  return (uint8_t)(1 + (((uint32_t)Polar_angle(xOffset, yOffset, NULL) * config->sectors) >> 16));
+}
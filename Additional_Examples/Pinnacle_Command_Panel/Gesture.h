@@ -0,0 +1,95 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Gesture recognition on the absolute-mode stream of a circular pad.
+// Gesture_update() takes one decoded packet at a time, in constant time and without allocating, and
+// reports:
+//  - taps, with the region of the pad they were in and how many came in a row (2 = double-tap),
+//  - swipes: a quick stroke of at least <swipeMinTravel>, with its direction,
+//  - rotation ("jog wheel"): a finger moving around the center, in steps of <rotateStep>.
+// Regions are the center (within <centerRadius>, if it isn't 0) and <sectors> equal slices around
+// it, numbered clockwise from the +X axis. A stroke that turns around the center by <rotateStart> is a
+// rotation from then on, and no longer a tap or a swipe.
+// Taps of a multi-tap sequence are held until <multiTapMicros> pass without another one; call
+// Gesture_poll() from the main loop so the last tap is reported even when no more packets arrive.
+// Angles are binary, as from Polar_angle(): 65536 to a full turn, growing clockwise.
+
+#ifndef GESTURE_H
+#define GESTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Pinnacle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Event types
+#define GESTURE_TAP       1
+#define GESTURE_SWIPE     2
+#define GESTURE_ROTATE    3
+
+// Swipe directions
+#define GESTURE_RIGHT     0
+#define GESTURE_DOWN      1
+#define GESTURE_LEFT      2
+#define GESTURE_UP        3
+
+#define GESTURE_CENTER    0     // region of the center, the sectors are 1 to <sectors>
+#define GESTURE_MAX_TAPS  3     // a sequence is reported once it gets this long
+#define GESTURE_MAX_EVENTS  2   // events one call can report
+
+typedef struct _gestureConfig
+{
+  uint16_t xCenter;           // center of the pad, in the coordinates of the packets
+  uint16_t yCenter;
+  uint16_t centerRadius;      // radius of the center region; 0 = no center region
+  uint8_t sectors;            // regions around the center
+  uint16_t tapMaxTravel;      // farthest a tap may move from where it touched down
+  uint32_t tapMaxMicros;      // longest a tap may last
+  uint32_t multiTapMicros;    // longest lift-off to touch-down gap within a sequence; 0 = taps are reported at once
+  uint16_t swipeMinTravel;
+  uint32_t swipeMaxMicros;
+  uint16_t rotateMinRadius;   // rotation is only followed this far from the center
+  uint16_t rotateStart;       // angle a stroke must turn to become a rotation
+  uint16_t rotateStep;        // angle of one reported step
+} gestureConfig_t;
+
+typedef struct _gestureEvent
+{
+  uint8_t type;
+  uint8_t region;             // GESTURE_TAP: region tapped; GESTURE_SWIPE: direction
+  uint8_t taps;               // GESTURE_TAP: taps in a row
+  int8_t steps;               // GESTURE_ROTATE: steps turned, positive = clockwise
+} gestureEvent_t;
+
+typedef struct _gesture
+{
+  uint32_t downAt;            // timestamp of the touch-down
+  uint32_t upAt;              // timestamp of the last tap's lift-off
+  int32_t rotation;           // angle turned and not yet reported
+  uint16_t xDown;
+  uint16_t yDown;
+  uint16_t xLast;
+  uint16_t yLast;
+  uint16_t travel;            // farthest the stroke got from where it touched down, per axis
+  uint16_t angle;             // around the center, at the last packet in the ring
+  uint8_t region;             // where the stroke touched down
+  uint8_t tapRegion;          // region of the taps held
+  uint8_t taps;               // taps held, see <multiTapMicros>
+  bool touching;
+  bool inRing;                // the last packet was at least <rotateMinRadius> from the center
+  bool rotating;
+} gesture_t;
+
+void Gesture_initConfig(gestureConfig_t *);
+void Gesture_init(gesture_t *);
+uint8_t Gesture_update(gesture_t *, const gestureConfig_t *, const absData_t *, uint32_t, gestureEvent_t *);
+uint8_t Gesture_poll(gesture_t *, const gestureConfig_t *, uint32_t, gestureEvent_t *);
+const char * Gesture_typeName(uint8_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GESTURE_H
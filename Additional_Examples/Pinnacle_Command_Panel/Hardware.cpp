@@ -2,6 +2,8 @@
 
 #include <Arduino.h>
 #include <SPI.h>
+#include <Wire.h>
+#include <EventResponder.h>
 #include "Hardware.h"
 
 #define CS0_PIN   10      // Chip Select pin for Sensor 0
@@ -13,44 +15,114 @@ typedef struct _sensorPort
 {
   uint8_t CS_Pin;
   uint8_t DR_Pin;
+  uint8_t bus;          // index into _spiBus
+  uint8_t i2cAddress;   // 0 for a sensor on SPI
   uint8_t sensorId;     // also the index of the sensor in the code.
 } sensorPort_t;
 
-sensorPort_t sensorList[2];
+sensorPort_t sensorList[HW_MAX_SENSORS];
+uint8_t _sensorCount = 0;
+
+// SPI ports sensors can be wired to. Teensy 3.5/3.6/4.x have two more.
+#if defined(__MK64FX512__) || defined(__MK66FX1M0__) || defined(__IMXRT1062__)
+SPIClass * _spiBus[] = { &SPI, &SPI1, &SPI2 };
+#else
+SPIClass * _spiBus[] = { &SPI };
+#endif
+#define SPI_BUS_COUNT (sizeof(_spiBus) / sizeof(_spiBus[0]))
+
+SPIClass * _activeBus = &SPI;   // bus of the transaction in progress
+
+// DR interrupt handlers, called with the id of the sensor whose DR rose
+void (*_drHandler[HW_MAX_SENSORS])(uint8_t);
 
 SPISettings _spiSettings;
 
+// Completion of DMA-driven transfers started by SPI_startTransferBytes()
+EventResponder _spiEvent;
+volatile bool _spiBusy = false;
+
+// Registers sensors 0 and 1 on the dev-kit's two sensor ports. More sensors can be added with
+// HW_addSensor() afterwards.
 void HW_init()
 {
-  // set the CS pins as output and DR pins as inputs
-  pinMode(CS0_PIN, OUTPUT);
-  pinMode(DR0_PIN, INPUT);
-  pinMode(CS1_PIN, OUTPUT);
-  pinMode(DR1_PIN, INPUT);
+  _sensorCount = 0;
+#ifdef ARM_DWT_CYCCNT
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;          // start the cycle counter used by TIMER_cycles()
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+  HW_addSensor(CS0_PIN, DR0_PIN, 0);
+  HW_addSensor(CS1_PIN, DR1_PIN, 0);
+}
+
+// Registers a sensor wired to <csPin>/<drPin> on SPI port <bus> (0 = SPI, 1 = SPI1, ...) and returns
+// its sensorId, or HW_NO_SENSOR if the list is full or the port doesn't exist on this board
+uint8_t HW_addSensor(uint8_t csPin, uint8_t drPin, uint8_t bus)
+{
+  sensorPort_t * port;
+
+  if(_sensorCount >= HW_MAX_SENSORS || bus >= SPI_BUS_COUNT) return HW_NO_SENSOR;
+
+  port = &sensorList[_sensorCount];
+  port->CS_Pin = csPin;
+  port->DR_Pin = drPin;
+  port->bus = bus;
+  port->i2cAddress = 0;
+  port->sensorId = _sensorCount;
+
+  // set the CS pin as output (deasserted) and the DR pin as input
+  pinMode(csPin, OUTPUT);
+  digitalWrite(csPin, HIGH);
+  pinMode(drPin, INPUT);
+
+  return _sensorCount++;
+}
+
+// Registers a sensor at 7-bit <i2cAddress> on Wire with its DR on <drPin>, and returns its sensorId,
+// or HW_NO_SENSOR if the list is full or another sensor already has that address
+uint8_t HW_addI2cSensor(uint8_t i2cAddress, uint8_t drPin)
+{
+  sensorPort_t * port;
+  uint8_t i;
 
-  // create sensorPort objects for the sensorList and insert them into the array
-  sensorPort_t temp;
+  if(_sensorCount >= HW_MAX_SENSORS || i2cAddress == 0) return HW_NO_SENSOR;
+  for(i = 0; i < _sensorCount; i++)
+  {
+    if(sensorList[i].i2cAddress == i2cAddress) return HW_NO_SENSOR;
+  }
 
-  temp.CS_Pin = CS0_PIN;
-  temp.DR_Pin = DR0_PIN;
-  temp.sensorId = 0;
+  port = &sensorList[_sensorCount];
+  port->CS_Pin = 0xFF;
+  port->DR_Pin = drPin;
+  port->bus = 0;
+  port->i2cAddress = i2cAddress;
+  port->sensorId = _sensorCount;
 
-  sensorList[0] = temp;
+  pinMode(drPin, INPUT);
+
+  return _sensorCount++;
+}
 
-  temp.CS_Pin = CS1_PIN;
-  temp.DR_Pin = DR1_PIN;
-  temp.sensorId = 1;
+uint8_t HW_i2cAddress(uint8_t sensorId)
+{
+  return sensorList[sensorId].i2cAddress;
+}
 
-  sensorList[1] = temp;
+uint8_t HW_sensorCount()
+{
+  return _sensorCount;
 }
 
+// I2C sensors have no CS
 void HW_assertCS(uint8_t sensorId)
 {
+  if(sensorList[sensorId].i2cAddress) return;
   digitalWriteFast(sensorList[sensorId].CS_Pin, LOW);
 }
 
 void HW_deAssertCS(uint8_t sensorId)
 {
+  if(sensorList[sensorId].i2cAddress) return;
   digitalWriteFast(sensorList[sensorId].CS_Pin, HIGH);
 }
 
@@ -59,38 +131,163 @@ bool HW_drAsserted(uint8_t sensorId)
   return digitalRead(sensorList[sensorId].DR_Pin);
 }
 
+// attachInterrupt() takes handlers without arguments, so each sensor gets a small trampoline
+#define DR_ISR(n) static void drIsr##n() { _drHandler[n](n); }
+DR_ISR(0) DR_ISR(1) DR_ISR(2) DR_ISR(3) DR_ISR(4) DR_ISR(5) DR_ISR(6) DR_ISR(7)
+
+static void (* const _drIsr[HW_MAX_SENSORS])() =
+{
+  drIsr0, drIsr1, drIsr2, drIsr3, drIsr4, drIsr5, drIsr6, drIsr7
+};
+
+// Calls <handler> from the rising edge of the sensor's DR pin. The handler may use SPI: the interrupt
+// is registered with every SPI port so it is held off while a main-loop transaction is in progress on
+// any of them (which also keeps it from switching _activeBus under that transaction).
+void HW_attachDrInterrupt(uint8_t sensorId, void (*handler)(uint8_t))
+{
+  uint8_t interrupt = digitalPinToInterrupt(sensorList[sensorId].DR_Pin);
+  uint8_t i;
+
+  _drHandler[sensorId] = handler;
+  for(i = 0; i < SPI_BUS_COUNT; i++)
+  {
+    _spiBus[i]->usingInterrupt(interrupt);
+  }
+  attachInterrupt(interrupt, _drIsr[sensorId], RISING);
+}
+
+void HW_detachDrInterrupt(uint8_t sensorId)
+{
+  uint8_t interrupt = digitalPinToInterrupt(sensorList[sensorId].DR_Pin);
+  uint8_t i;
+
+  detachInterrupt(interrupt);
+  for(i = 0; i < SPI_BUS_COUNT; i++)
+  {
+    _spiBus[i]->notUsingInterrupt(interrupt);
+  }
+}
+
 void TIMER_delayMicroseconds(uint32_t microSeconds)
 {
   delayMicroseconds(microSeconds);
 }
 
+uint32_t TIMER_micros()
+{
+  return micros();
+}
+
+// Counts CPU cycles where the core has a cycle counter (Teensy 3.x/4.x), microseconds elsewhere
+uint32_t TIMER_cycles()
+{
+#ifdef ARM_DWT_CYCCNT
+  return ARM_DWT_CYCCNT;
+#else
+  return micros();
+#endif
+}
+
+uint32_t TIMER_cyclesPerMicro()
+{
+#ifdef ARM_DWT_CYCCNT
+  return F_CPU / 1000000;
+#else
+  return 1;
+#endif
+}
+
+static void spiTransferDone(EventResponderRef event)
+{
+  _spiBusy = false;
+}
+
 void SPI_init(uint32_t bitRate, uint8_t bitOrder, uint8_t spiMode)
 {
+  uint8_t i;
+
   _spiSettings = SPISettings(bitRate, bitOrder, spiMode);
-  SPI.begin();
+  _spiEvent.attachImmediate(spiTransferDone);
+  for(i = 0; i < SPI_BUS_COUNT; i++)
+  {
+    _spiBus[i]->begin();
+  }
 }
 
 void SPI_end()
 {
-  SPI.end();
+  uint8_t i;
+
+  for(i = 0; i < SPI_BUS_COUNT; i++)
+  {
+    _spiBus[i]->end();
+  }
 }
 
-void SPI_beginTransaction()
+// Starts a transaction on the SPI port <sensorId> is wired to; the transfers that follow use that port
+void SPI_beginTransaction(uint8_t sensorId)
 {
-  SPI.beginTransaction(_spiSettings);
+  _activeBus = _spiBus[sensorList[sensorId].bus];
+  _activeBus->beginTransaction(_spiSettings);
 }
 
-void SPI_endTransaction()
+void SPI_endTransaction(uint8_t sensorId)
 {
-  SPI.endTransaction();
+  _spiBus[sensorList[sensorId].bus]->endTransaction();
 }
 
 uint8_t SPI_transfer(uint8_t data)
 {
-  return SPI.transfer(data);
+  return _activeBus->transfer(data);
 }
 
 void SPI_transferBytes(uint8_t * data, uint16_t count)
 {
-  SPI.transfer(data, count);
+  _activeBus->transfer(data, count);
+}
+
+void SPI_startTransferBytes(uint8_t * data, uint16_t count)
+{
+  _spiBusy = true;
+  _activeBus->transfer(data, data, count, _spiEvent);
+}
+
+bool SPI_transferBusy()
+{
+  return _spiBusy;
+}
+
+// Pinnacle supports Fast-mode plus, so <clock> can be up to I2C_CLOCK_FAST_PLUS if the pull-ups and
+// the bus capacitance allow it
+void I2C_init(uint32_t clock)
+{
+  Wire.begin();
+  Wire.setClock(clock);
+}
+
+void I2C_end()
+{
+  Wire.end();
+}
+
+// Writes <count> bytes to the device at <address>, then releases the bus if <stop>
+bool I2C_write(uint8_t address, const uint8_t * data, uint8_t count, bool stop)
+{
+  Wire.beginTransmission(address);
+  Wire.write(data, count);
+  return Wire.endTransmission(stop) == 0;
+}
+
+// Reads <count> bytes from the device at <address> and releases the bus. Follows an I2C_write() that
+// kept the bus with a repeated start.
+bool I2C_read(uint8_t address, uint8_t * data, uint8_t count)
+{
+  uint8_t i = 0;
+
+  Wire.requestFrom(address, count, (uint8_t)true);
+  while(Wire.available() && i < count)
+  {
+    data[i++] = Wire.read();
+  }
+  return i == count;
 }
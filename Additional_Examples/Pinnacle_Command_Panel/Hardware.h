@@ -3,6 +3,12 @@
 // Designers will need to implement these hardware-specific functions for their own processor/hardware.
 // These functions include GPIO access, a delay timer, and a communication peripheral (SPI or I2C)
 
+#ifndef HARDWARE_H
+#define HARDWARE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -31,19 +37,54 @@ extern "C" {
 #define MSBFIRST 1
 #endif
 
+#define HW_MAX_SENSORS  8       // sensors that can be registered (all buses together)
+#define HW_NO_SENSOR    0xFF
+
+// 7-bit I2C addresses of Pinnacle
+#define I2C_ADDRESS_DEFAULT     0x2A
+#define I2C_ADDRESS_ALTERNATE   0x2C    // parts ordered with the alternate address
+
+// I2C clock rates
+#define I2C_CLOCK_STANDARD      100000
+#define I2C_CLOCK_FAST          400000
+#define I2C_CLOCK_FAST_PLUS     1000000
+
+#define I2C_MAX_TRANSFER        32      // bytes one I2C_write() or I2C_read() can move
+
 void HW_init(void);
+uint8_t HW_addSensor(uint8_t, uint8_t, uint8_t);
+uint8_t HW_addI2cSensor(uint8_t, uint8_t);
+uint8_t HW_i2cAddress(uint8_t);   // 0 for a sensor on SPI
+uint8_t HW_sensorCount(void);
 void HW_assertCS(uint8_t);        // IN PROGRESS
 void HW_deAssertCS(uint8_t);      // QUEUED
 bool HW_drAsserted(uint8_t);      // QUEUED
+void HW_attachDrInterrupt(uint8_t, void (*)(uint8_t));
+void HW_detachDrInterrupt(uint8_t);
 void TIMER_delayMicroseconds(uint32_t);
+uint32_t TIMER_micros(void);
+uint32_t TIMER_cycles(void);          // free-running CPU cycle counter, for latency measurements
+uint32_t TIMER_cyclesPerMicro(void);
 
 void SPI_init(uint32_t, uint8_t, uint8_t);
 void SPI_end(void);
-void SPI_beginTransaction(void);
-void SPI_endTransaction(void);
+void SPI_beginTransaction(uint8_t);    // on the bus of the given sensor
+void SPI_endTransaction(uint8_t);
 uint8_t SPI_transfer(uint8_t);
 void SPI_transferBytes(uint8_t *, uint16_t);
+void SPI_startTransferBytes(uint8_t *, uint16_t);   // returns at once, bytes are exchanged in place
+bool SPI_transferBusy(void);                        // true until the started transfer has finished
+
+// I2C_write() with <stop> false leaves the bus claimed, so the I2C_read() that follows starts with a
+// repeated start. Both return false if no device acknowledged <address>.
+// NOTE: the I2C transfers block, don't use them from a DR interrupt handler
+void I2C_init(uint32_t);
+void I2C_end(void);
+bool I2C_write(uint8_t, const uint8_t *, uint8_t, bool);
+bool I2C_read(uint8_t, uint8_t *, uint8_t);
 
 #ifdef __cplusplus
 }
 #endif
+
+#endif // HARDWARE_H
@@ -0,0 +1,81 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "HidReport.h"
+
+uint8_t HidReport_buttons(const hidScheduler_t *);
+
+// <frameMicros> apart at the least; HID_REPORT_FRAME_US for a full-speed mouse
+void HidReport_init(hidScheduler_t * scheduler, uint32_t frameMicros)
+{
+  uint8_t i;
+
+  Pointer_init(&scheduler->pointer);
+  scheduler->wheelPending = 0;
+  for(i = 0; i < HID_REPORT_MAX_PADS; i++) scheduler->padButtons[i] = 0;
+  scheduler->pressed = 0;
+  scheduler->buttonsSent = 0;
+  scheduler->frameMicros = frameMicros;
+  scheduler->lastReportAt = 0;
+  scheduler->reported = false;
+}
+
+// Adds one relative packet of pad <padId> to the next report
+void HidReport_addPacket(hidScheduler_t * scheduler, uint8_t padId, const relData_t * data)
+{
+  int16_t wheel = scheduler->wheelPending + data->wheelCount;
+
+  if(padId >= HID_REPORT_MAX_PADS) return;
+
+  Pointer_add(&scheduler->pointer, data->xDelta, data->yDelta);
+  if(wheel > HID_REPORT_MAX_SCROLL) wheel = HID_REPORT_MAX_SCROLL;
+  if(wheel < -HID_REPORT_MAX_SCROLL) wheel = -HID_REPORT_MAX_SCROLL;
+  scheduler->wheelPending = wheel;
+
+  scheduler->padButtons[padId] = data->buttons & HID_REPORT_BUTTONS;
+  scheduler->pressed |= HidReport_buttons(scheduler) & ~scheduler->buttonsSent;
+}
+
+// Fills <report> with everything collected since the last one and returns true, if there is
+// anything to report and the last report is at least a frame older than <now> (microseconds).
+// Motion beyond a report, and scroll beyond HID_REPORT_MAX_WHEEL, stay for the next frames.
+bool HidReport_next(hidScheduler_t * scheduler, uint32_t now, hidReport_t * report)
+{
+  uint8_t buttons;
+  int16_t wheel;
+  bool moved;
+
+  if(scheduler->reported && now - scheduler->lastReportAt < scheduler->frameMicros) return false;
+
+  buttons = HidReport_buttons(scheduler) | scheduler->pressed;
+  wheel = scheduler->wheelPending;
+  if(wheel > HID_REPORT_MAX_WHEEL) wheel = HID_REPORT_MAX_WHEEL;
+  if(wheel < -HID_REPORT_MAX_WHEEL) wheel = -HID_REPORT_MAX_WHEEL;
+
+  moved = Pointer_nextReport(&scheduler->pointer, &report->xMove, &report->yMove);
+  if(!moved && wheel == 0 && buttons == scheduler->buttonsSent) return false;
+
+  if(!moved)
+  {
+    report->xMove = 0;
+    report->yMove = 0;
+  }
+  report->wheel = (int8_t)wheel;
+  report->buttons = buttons;
+
+  scheduler->wheelPending -= wheel;
+  scheduler->pressed = 0;
+  scheduler->buttonsSent = buttons;
+  scheduler->lastReportAt = now;
+  scheduler->reported = true;
+  return true;
+}
+
+// Buttons held on any pad
+uint8_t HidReport_buttons(const hidScheduler_t * scheduler)
+{
+  uint8_t buttons = 0;
+  uint8_t i;
+
+  for(i = 0; i < HID_REPORT_MAX_PADS; i++) buttons |= scheduler->padButtons[i];
+  return buttons;
+}
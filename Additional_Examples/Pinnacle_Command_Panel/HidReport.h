@@ -0,0 +1,61 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// USB mouse reports, one per frame.
+// The host polls a full-speed mouse once per 1 ms frame and takes one report each time, while the
+// pads deliver packets whenever they have them. Sending a report per packet wastes the bus when two
+// pads (or a split flick) have something in the same frame, and the sample sketches' Mouse.click()
+// on every packet with the button bit set turns one press into a click per packet.
+// HidReport_addPacket() collects the relative packets of up to HID_REPORT_MAX_PADS pads: motion goes
+// through a shared Pointer (acceleration, fractions of a pixel, large moves split), scroll counts are
+// summed, and the buttons of all pads are merged. HidReport_next() then hands out at most one report
+// per <frameMicros>, and only when something changed: motion, scroll, or a button going down or up.
+// A press that is released again before its report goes out is still reported, up for the next.
+// Nothing waits longer than a frame for its first report, see the host bench.
+
+#ifndef HID_REPORT_H
+#define HID_REPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Pinnacle.h"
+#include "Pointer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HID_REPORT_MAX_PADS   2
+#define HID_REPORT_FRAME_US   1000    // a full-speed USB frame
+#define HID_REPORT_BUTTONS    0x07    // primary, secondary and auxiliary, as in relData_t
+#define HID_REPORT_MAX_WHEEL  127
+#define HID_REPORT_MAX_SCROLL 1024    // scroll counts waiting for a report, more is dropped
+
+typedef struct _hidReport
+{
+  uint8_t buttons;          // relData_t bits: 0x01 primary (left), 0x02 secondary (right), 0x04 auxiliary
+  int8_t xMove;
+  int8_t yMove;
+  int8_t wheel;
+} hidReport_t;
+
+typedef struct _hidScheduler
+{
+  pointer_t pointer;                          // motion of all pads
+  int16_t wheelPending;
+  uint8_t padButtons[HID_REPORT_MAX_PADS];    // as of each pad's last packet
+  uint8_t pressed;                            // went down since the last report
+  uint8_t buttonsSent;
+  uint32_t frameMicros;
+  uint32_t lastReportAt;
+  bool reported;                              // <lastReportAt> is valid
+} hidScheduler_t;
+
+void HidReport_init(hidScheduler_t *, uint32_t);
+void HidReport_addPacket(hidScheduler_t *, uint8_t, const relData_t *);
+bool HidReport_next(hidScheduler_t *, uint32_t, hidReport_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HID_REPORT_H
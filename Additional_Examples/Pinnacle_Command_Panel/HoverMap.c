@@ -0,0 +1,237 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "HoverMap.h"
+
+#define ZONE_SHIFT    8           // log2(ZONESCALE)
+#define NODE_OFFSET   (ZONESCALE / 2)   // thresholds sit at the zone centers
+
+#define BLOB_MAGIC_0  'H'
+#define BLOB_MAGIC_1  'M'
+#define BLOB_VERSION  1
+
+#define LEARN_WEIGHT_LIMIT  0x000FFFFF  // keeps zSquareSum (up to 63^2 x this) within 32 bits
+
+// Clears <value> if it is negative, without a branch
+// NOTE: relies on >> of a negative int32_t being an arithmetic shift, as it is on GCC/ARM and AVR
+#define CLEAR_IF_NEGATIVE(value)  ((value) & ~((value) >> 31))
+
+void HoverMap_locate(int32_t, int32_t, uint8_t *, uint16_t *);
+uint16_t HoverMap_checksum(const uint8_t *, uint16_t);
+uint32_t HoverMap_sqrt(uint32_t);
+
+// Copies <thresholds> (one per zone, the layout of the old Z_TRESH table) into <map>
+void HoverMap_init(hoverMap_t * map, const uint8_t thresholds[HOVER_MAP_ROWS][HOVER_MAP_COLS])
+{
+  uint8_t row, col;
+
+  for(row = 0; row < HOVER_MAP_ROWS; row++)
+  {
+    for(col = 0; col < HOVER_MAP_COLS; col++)
+    {
+      map->threshold[row][col] = thresholds[row][col];
+    }
+  }
+}
+
+// Returns the interpolated threshold at (<xValue>, <yValue>) as 8.8 fixed point
+uint16_t HoverMap_threshold(const hoverMap_t * map, uint16_t xValue, uint16_t yValue)
+{
+  uint8_t col, row;
+  uint16_t xWeight, yWeight;
+  uint32_t top, bottom;
+  const uint8_t * node;
+
+  HoverMap_locate(xValue, HOVER_MAP_COLS, &col, &xWeight);
+  HoverMap_locate(yValue, HOVER_MAP_ROWS, &row, &yWeight);
+
+  node = &map->threshold[row][col];
+  top = (node[0] << ZONE_SHIFT) + (node[1] - node[0]) * (uint32_t)xWeight;
+  bottom = (node[HOVER_MAP_COLS] << ZONE_SHIFT) + (node[HOVER_MAP_COLS + 1] - node[HOVER_MAP_COLS]) * (uint32_t)xWeight;
+
+  return (uint16_t)(((top << ZONE_SHIFT) + (bottom - top) * (uint32_t)yWeight) >> ZONE_SHIFT);
+}
+
+// True if the Z of <data> is at or below the interpolated threshold at its position
+bool HoverMap_isHovering(const hoverMap_t * map, const absData_t * data)
+{
+  return ((uint32_t)data->zValue << 8) <= HoverMap_threshold(map, data->xValue, data->yValue);
+}
+
+void HoverMap_beginLearning(hoverLearn_t * learn)
+{
+  uint8_t row, col;
+
+  for(row = 0; row < HOVER_MAP_ROWS; row++)
+  {
+    for(col = 0; col < HOVER_MAP_COLS; col++)
+    {
+      learn->zSum[row][col] = 0;
+      learn->zSquareSum[row][col] = 0;
+      learn->weightSum[row][col] = 0;
+    }
+  }
+}
+
+// Records one packet of the calibration sweep (a finger hovering just above the overlay, not
+// touching). The packet's Z (and its square) counts towards the four thresholds around it with the
+// same weights the lookup uses, for the weighted mean and spread of hover Z around each node.
+// Z-idle packets are ignored.
+void HoverMap_learn(hoverLearn_t * learn, const absData_t * data)
+{
+  uint8_t col, row, i, j;
+  uint16_t xWeight, yWeight;
+  uint32_t weight;
+
+  if(data->zValue == 0) return;
+
+  HoverMap_locate(data->xValue, HOVER_MAP_COLS, &col, &xWeight);
+  HoverMap_locate(data->yValue, HOVER_MAP_ROWS, &row, &yWeight);
+
+  for(i = 0; i < 2; i++)
+  {
+    for(j = 0; j < 2; j++)
+    {
+      weight = (i ? yWeight : ZONESCALE - yWeight) * (uint32_t)(j ? xWeight : ZONESCALE - xWeight) >> ZONE_SHIFT;
+      if(learn->weightSum[row + i][col + j] > LEARN_WEIGHT_LIMIT) continue;   // plenty of samples already
+
+      learn->zSum[row + i][col + j] += data->zValue * weight;
+      learn->zSquareSum[row + i][col + j] += (uint32_t)data->zValue * data->zValue * weight;
+      learn->weightSum[row + i][col + j] += weight;
+    }
+  }
+}
+
+// Sets each threshold the sweep reached to the mean hover Z around it plus HOVER_MAP_SIGMAS standard
+// deviations. The sweep hovers at different heights, and a threshold at the mean would count the
+// upper half of them as touches; this one bounds nearly all of them, so no margin goes on top.
+// Thresholds the sweep never reached keep their value in <map>. Returns how many were learned.
+uint8_t HoverMap_finishLearning(const hoverLearn_t * learn, hoverMap_t * map)
+{
+  uint8_t row, col;
+  uint8_t learned = 0;
+  uint32_t weight, mean, meanSquare, variance, threshold;
+
+  for(row = 0; row < HOVER_MAP_ROWS; row++)
+  {
+    for(col = 0; col < HOVER_MAP_COLS; col++)
+    {
+      weight = learn->weightSum[row][col];
+      if(weight < ZONESCALE) continue;   // less than one packet's worth at the node
+
+      // 8.8 fixed point: Z^2 sums stay below 2^32, so the quotients fit with 8 and 16 fraction bits
+      mean = (uint32_t)(((uint64_t)learn->zSum[row][col] << 8) / weight);
+      meanSquare = (uint32_t)(((uint64_t)learn->zSquareSum[row][col] << 16) / weight);
+      variance = (meanSquare > mean * mean) ? meanSquare - mean * mean : 0;
+
+      threshold = (mean + HOVER_MAP_SIGMAS * HoverMap_sqrt(variance) + 0x80) >> 8;
+      map->threshold[row][col] = (threshold > 0xFF) ? 0xFF : (uint8_t)threshold;
+      learned++;
+    }
+  }
+
+  return learned;
+}
+
+// Writes <map> to <blob> (HOVER_MAP_BLOB_SIZE bytes): magic, version, dimensions, thresholds and a
+// Fletcher-16 checksum
+void HoverMap_save(const hoverMap_t * map, uint8_t * blob)
+{
+  uint16_t checksum;
+  uint8_t row, col;
+  uint8_t * next = blob + 4;
+
+  blob[0] = BLOB_MAGIC_0;
+  blob[1] = BLOB_MAGIC_1;
+  blob[2] = BLOB_VERSION;
+  blob[3] = (HOVER_MAP_ROWS << 4) | HOVER_MAP_COLS;
+
+  for(row = 0; row < HOVER_MAP_ROWS; row++)
+  {
+    for(col = 0; col < HOVER_MAP_COLS; col++)
+    {
+      *next++ = map->threshold[row][col];
+    }
+  }
+
+  checksum = HoverMap_checksum(blob, HOVER_MAP_BLOB_SIZE - 2);
+  next[0] = (uint8_t)(checksum >> 8);
+  next[1] = (uint8_t)checksum;
+}
+
+// Reads a map written by HoverMap_save(). Returns false, leaving <map> alone, if <blob> doesn't hold
+// a valid map of this size (e.g. erased EEPROM).
+bool HoverMap_load(hoverMap_t * map, const uint8_t * blob)
+{
+  uint16_t checksum = HoverMap_checksum(blob, HOVER_MAP_BLOB_SIZE - 2);
+  const uint8_t * next = blob + 4;
+  uint8_t row, col;
+
+  if(blob[0] != BLOB_MAGIC_0 || blob[1] != BLOB_MAGIC_1 || blob[2] != BLOB_VERSION) return false;
+  if(blob[3] != ((HOVER_MAP_ROWS << 4) | HOVER_MAP_COLS)) return false;
+  if(blob[HOVER_MAP_BLOB_SIZE - 2] != (uint8_t)(checksum >> 8) || blob[HOVER_MAP_BLOB_SIZE - 1] != (uint8_t)checksum) return false;
+
+  for(row = 0; row < HOVER_MAP_ROWS; row++)
+  {
+    for(col = 0; col < HOVER_MAP_COLS; col++)
+    {
+      map->threshold[row][col] = *next++;
+    }
+  }
+
+  return true;
+}
+
+// Finds the pair of nodes (<*index>, <*index> + 1) around <value> along an axis of <nodes> nodes and
+// the weight (0..ZONESCALE) of the second one. Positions outside the outer nodes are clamped to
+// them. No branches: this runs for every curved-overlay packet.
+void HoverMap_locate(int32_t value, int32_t nodes, uint8_t * index, uint16_t * weight)
+{
+  int32_t last = (nodes - 1) << ZONE_SHIFT;   // offset of the outer node
+  int32_t offset = value - NODE_OFFSET;
+  int32_t cell;
+
+  offset = CLEAR_IF_NEGATIVE(offset);
+  offset = last - CLEAR_IF_NEGATIVE(last - offset);   // clamp to the outer node
+
+  cell = (nodes - 2) - CLEAR_IF_NEGATIVE((nodes - 2) - (offset >> ZONE_SHIFT));   // last cell ends at the outer node
+  *index = (uint8_t)cell;
+  *weight = (uint16_t)(offset - (cell << ZONE_SHIFT));
+}
+
+uint16_t HoverMap_checksum(const uint8_t * data, uint16_t count)
+{
+  uint16_t sum1 = 0;
+  uint16_t sum2 = 0;
+  uint16_t i = 0;
+
+  for(; i < count; i++)
+  {
+    sum1 = (sum1 + data[i]) % 255;
+    sum2 = (sum2 + sum1) % 255;
+  }
+
+  return (sum2 << 8) | sum1;
+}
+
+// Integer square root (rounded down)
+uint32_t HoverMap_sqrt(uint32_t value)
+{
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+
+  while(bit > value) bit >>= 2;
+  while(bit != 0)
+  {
+    if(value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Hover-threshold map for curved overlays.
+// The map holds one Z threshold per 256 x 256 zone, like the hand-tuned table it replaces, but the
+// thresholds sit at the zone centers and are interpolated bilinearly in between, so the threshold
+// no longer jumps at zone boundaries. The lookup has no data-dependent branches.
+// A map can be learned from a calibration sweep (a finger hovering just above the overlay, moved
+// over the whole pad) and stored as a small checksummed blob, e.g. in EEPROM.
+
+#ifndef HOVERMAP_H
+#define HOVERMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Pinnacle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HOVER_MAP_ROWS  ROWS_Y
+#define HOVER_MAP_COLS  COLS_X
+#define HOVER_MAP_BLOB_SIZE (4 + HOVER_MAP_ROWS * HOVER_MAP_COLS + 2)   // header, thresholds, checksum
+#define HOVER_MAP_SIGMAS    2     // learned thresholds sit this many standard deviations above the mean hover Z
+
+struct _hoverMap
+{
+  uint8_t threshold[HOVER_MAP_ROWS][HOVER_MAP_COLS];  // Z at or below which a finger is hovering
+};
+typedef struct _hoverMap hoverMap_t;
+
+// Running sums of a calibration sweep
+typedef struct _hoverLearn
+{
+  uint32_t zSum[HOVER_MAP_ROWS][HOVER_MAP_COLS];       // hover Z x weight, per node
+  uint32_t zSquareSum[HOVER_MAP_ROWS][HOVER_MAP_COLS]; // hover Z^2 x weight, per node
+  uint32_t weightSum[HOVER_MAP_ROWS][HOVER_MAP_COLS];  // ZONESCALE per packet centered on the node
+} hoverLearn_t;
+
+void HoverMap_init(hoverMap_t *, const uint8_t [HOVER_MAP_ROWS][HOVER_MAP_COLS]);
+uint16_t HoverMap_threshold(const hoverMap_t *, uint16_t, uint16_t);
+bool HoverMap_isHovering(const hoverMap_t *, const absData_t *);
+void HoverMap_beginLearning(hoverLearn_t *);
+void HoverMap_learn(hoverLearn_t *, const absData_t *);
+uint8_t HoverMap_finishLearning(const hoverLearn_t *, hoverMap_t *);
+void HoverMap_save(const hoverMap_t *, uint8_t *);
+bool HoverMap_load(hoverMap_t *, const uint8_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOVERMAP_H
@@ -0,0 +1,122 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "Instrument.h"
+
+#ifdef PINNACLE_INSTRUMENT
+
+#include <string.h>
+
+typedef struct _instrumentHistogram
+{
+  uint16_t bins[INSTRUMENT_BINS];   // saturate at 0xFFFF
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+} instrumentHistogram_t;
+
+static instrumentHistogram_t _histograms[INSTRUMENT_STAGES][INSTRUMENT_MAX_SENSORS];
+
+static const char * const STAGE_NAMES[INSTRUMENT_STAGES] =
+{
+  "RAP read", "RAP write", "ERA read", "ERA write", "clear flags", "output", "DR to report",
+  "capture ISR",
+};
+
+uint8_t Instrument_bin(uint32_t);
+uint32_t Instrument_binCeiling(uint8_t);
+uint32_t Instrument_percentile(const instrumentHistogram_t *, uint8_t);
+
+// Adds one measurement of <cycles> to the histogram of <stage> for <sensorId>
+void Instrument_record(uint8_t stage, uint8_t sensorId, uint32_t cycles)
+{
+  instrumentHistogram_t * histogram;
+  uint16_t * bin;
+
+  if(stage >= INSTRUMENT_STAGES || sensorId >= INSTRUMENT_MAX_SENSORS) return;
+
+  histogram = &_histograms[stage][sensorId];
+  bin = &histogram->bins[Instrument_bin(cycles)];
+  if(*bin != 0xFFFF) (*bin)++;
+
+  if(histogram->count == 0 || cycles < histogram->min) histogram->min = cycles;
+  if(cycles > histogram->max) histogram->max = cycles;
+  histogram->count++;
+}
+
+// Fills <stats> from the histogram of <stage> for <sensorId>; all zero if nothing was recorded
+void Instrument_getStats(uint8_t stage, uint8_t sensorId, instrumentStats_t * stats)
+{
+  const instrumentHistogram_t * histogram;
+
+  memset(stats, 0, sizeof(instrumentStats_t));
+  if(stage >= INSTRUMENT_STAGES || sensorId >= INSTRUMENT_MAX_SENSORS) return;
+
+  histogram = &_histograms[stage][sensorId];
+  if(histogram->count == 0) return;
+
+  stats->count = histogram->count;
+  stats->min = histogram->min;
+  stats->p50 = Instrument_percentile(histogram, 50);
+  stats->p99 = Instrument_percentile(histogram, 99);
+  stats->max = histogram->max;
+}
+
+void Instrument_reset(void)
+{
+  memset(_histograms, 0, sizeof(_histograms));
+}
+
+const char * Instrument_stageName(uint8_t stage)
+{
+  return (stage < INSTRUMENT_STAGES) ? STAGE_NAMES[stage] : "?";
+}
+
+// Bins 0-7 hold 0-7 cycles exactly; above that each power of two is split into INSTRUMENT_SUB_BINS
+uint8_t Instrument_bin(uint32_t cycles)
+{
+  uint8_t msb = 0;
+  uint32_t bin;
+
+  if(cycles < 2 * INSTRUMENT_SUB_BINS) return (uint8_t)cycles;
+
+  while(cycles >> (msb + 1)) msb++;
+  bin = (msb - 1) * INSTRUMENT_SUB_BINS + ((cycles >> (msb - 2)) & (INSTRUMENT_SUB_BINS - 1));
+  return (bin < INSTRUMENT_BINS) ? (uint8_t)bin : INSTRUMENT_BINS - 1;
+}
+
+// The largest cycle count that falls in <bin>
+uint32_t Instrument_binCeiling(uint8_t bin)
+{
+  uint8_t shift;
+
+  if(bin < 2 * INSTRUMENT_SUB_BINS) return bin;
+
+  shift = bin / INSTRUMENT_SUB_BINS - 1;
+  return ((uint32_t)(INSTRUMENT_SUB_BINS + bin % INSTRUMENT_SUB_BINS + 1) << shift) - 1;
+}
+
+// Upper edge of the bin holding the <percent>th percentile, kept within min..max
+uint32_t Instrument_percentile(const instrumentHistogram_t * histogram, uint8_t percent)
+{
+  uint32_t total = 0, seen = 0, target, ceiling;
+  uint8_t bin;
+
+  for(bin = 0; bin < INSTRUMENT_BINS; bin++)
+  {
+    total += histogram->bins[bin];
+  }
+  target = (total * percent + 99) / 100;    // bins saturate, so rank against their own total
+
+  for(bin = 0; bin < INSTRUMENT_BINS; bin++)
+  {
+    seen += histogram->bins[bin];
+    if(seen >= target && seen != 0) break;
+  }
+
+  ceiling = Instrument_binCeiling(bin);
+  if(ceiling > histogram->max) return histogram->max;
+  if(ceiling < histogram->min) return histogram->min;
+  return ceiling;
+}
+
+#endif // PINNACLE_INSTRUMENT
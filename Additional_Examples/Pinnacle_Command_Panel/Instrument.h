@@ -0,0 +1,76 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Latency instrumentation.
+// When PINNACLE_INSTRUMENT is defined, the RAP and ERA accessors, the Status1 clear and the
+// application's output path record how many cycles (TIMER_cycles()) each call took, in a histogram
+// per stage and per sensor. Instrument_getStats() reads min/p50/p99/max back out.
+// Without PINNACLE_INSTRUMENT the INSTRUMENT_ macros expand to nothing and Instrument.c compiles to
+// an empty unit, so the instrumentation costs neither time nor memory.
+// NOTE: the capture interrupt records only into INSTRUMENT_CAPTURE, which nothing in the main loop
+// records into, so the two never update the same histogram.
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+// Uncomment to build with instrumentation (or define it on the compiler command line)
+// #define PINNACLE_INSTRUMENT
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Pinnacle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Stages
+#define INSTRUMENT_RAP_READ       0   // RAP_readBytes()
+#define INSTRUMENT_RAP_WRITE      1   // RAP_write()
+#define INSTRUMENT_ERA_READ       2   // ERA_readBytes(), ERA_readBlock()
+#define INSTRUMENT_ERA_WRITE      3   // ERA_writeByte(), ERA_writeBlock()
+#define INSTRUMENT_CLEAR_FLAGS    4   // Pinnacle_clearFlags(), including the DR settle delay
+#define INSTRUMENT_OUTPUT         5   // the application formatting and writing a report
+#define INSTRUMENT_DR_TO_REPORT   6   // packet captured to report written, recorded by the application
+#define INSTRUMENT_CAPTURE        7   // Pinnacle_captureIsr(), the packet read and Status1 clear
+#define INSTRUMENT_STAGES         8
+
+#ifndef INSTRUMENT_MAX_SENSORS
+#define INSTRUMENT_MAX_SENSORS    PINNACLE_MAX_SENSORS   // sensors with their own histograms
+#endif
+
+// Histogram bins: exact below 8 cycles, then 4 per power of two (within 12.5%), up to 2^25 cycles
+#define INSTRUMENT_OCTAVES        24
+#define INSTRUMENT_SUB_BINS       4
+#define INSTRUMENT_BINS           (INSTRUMENT_OCTAVES * INSTRUMENT_SUB_BINS)
+
+typedef struct _instrumentStats
+{
+  uint32_t count;
+  uint32_t min;       // cycles; p50 and p99 are the upper edge of their histogram bin
+  uint32_t p50;
+  uint32_t p99;
+  uint32_t max;
+} instrumentStats_t;
+
+#ifdef PINNACLE_INSTRUMENT
+
+#define INSTRUMENT_START(name)                  uint32_t name = TIMER_cycles()
+#define INSTRUMENT_STOP(name, stage, sensorId)  Instrument_record((stage), (sensorId), TIMER_cycles() - (name))
+
+void Instrument_record(uint8_t, uint8_t, uint32_t);
+void Instrument_getStats(uint8_t, uint8_t, instrumentStats_t *);
+void Instrument_reset(void);
+const char * Instrument_stageName(uint8_t);
+
+#else
+
+#define INSTRUMENT_START(name)
+#define INSTRUMENT_STOP(name, stage, sensorId)
+
+#endif // PINNACLE_INSTRUMENT
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INSTRUMENT_H
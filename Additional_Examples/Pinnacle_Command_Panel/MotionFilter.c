@@ -0,0 +1,97 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "MotionFilter.h"
+
+#define POSITION_SHIFT  4           // positions are kept in 1/16 counts
+#define ALPHA_SHIFT     15          // smoothing factors, 0 to 1 << ALPHA_SHIFT
+#define MICROS_PER_STEP 62500       // 1 second over 1 << POSITION_SHIFT: 1/16 count per us -> counts per second
+#define CUTOFF_PERIOD   15915494    // 10^8 / (2 pi): cutoff (1/100 Hz) times period (us) where r = 1
+
+int32_t MotionFilter_alpha(uint32_t, uint32_t);
+uint16_t MotionFilter_axis(motionFilterAxis_t *, const motionFilterConfig_t *, uint16_t, uint32_t, int32_t, uint16_t);
+
+// Settings for a pad reporting at 100 Hz, tuned with the host bench: 1 Hz when still, 21 Hz at
+// 2000 counts/s (a quick slide), a 5 Hz speed estimate so the prediction settles soon after the finger
+// stops, and 4 ms of prediction
+void MotionFilter_initConfig(motionFilterConfig_t * config)
+{
+  config->minCutoff = 100;
+  config->beta = 100;
+  config->speedCutoff = 500;
+  config->predictMicros = 4000;
+}
+
+void MotionFilter_init(motionFilter_t * filter)
+{
+  filter->tracking = false;
+  filter->lastAt = 0;
+}
+
+// Filters <data>, read at <timestamp> (microseconds), in place
+void MotionFilter_apply(motionFilter_t * filter, const motionFilterConfig_t * config, absData_t * data, uint32_t timestamp)
+{
+  uint32_t micros = timestamp - filter->lastAt;
+  int32_t speedAlpha;
+
+  if(data->zValue == 0)
+  {
+    filter->tracking = false;
+    return;
+  }
+
+  filter->lastAt = timestamp;
+  if(!filter->tracking || micros > MOTION_FILTER_MAX_GAP_US)
+  {
+    filter->x.position = (int32_t)data->xValue << POSITION_SHIFT;
+    filter->y.position = (int32_t)data->yValue << POSITION_SHIFT;
+    filter->x.speed = 0;
+    filter->y.speed = 0;
+    filter->tracking = true;
+    return;
+  }
+  if(micros == 0) micros = 1;
+
+  speedAlpha = MotionFilter_alpha(config->speedCutoff, micros);
+  data->xValue = MotionFilter_axis(&filter->x, config, data->xValue, micros, speedAlpha, PINNACLE_XMAX);
+  data->yValue = MotionFilter_axis(&filter->y, config, data->yValue, micros, speedAlpha, PINNACLE_YMAX);
+}
+
+// Smoothing factor of a low-pass with <cutoff> (1/100 Hz) at a sample period of <micros>:
+// r / (1 + r) with r = 2 pi cutoff period, in one division without overflow. The cutoff is limited to
+// MOTION_FILTER_MAX_CUTOFF.
+int32_t MotionFilter_alpha(uint32_t cutoff, uint32_t micros)
+{
+  uint32_t product, alpha;
+
+  if(cutoff > MOTION_FILTER_MAX_CUTOFF) cutoff = MOTION_FILTER_MAX_CUTOFF;
+  product = cutoff * micros;
+  alpha = product / ((CUTOFF_PERIOD + product + (1 << (ALPHA_SHIFT - 1))) >> ALPHA_SHIFT);
+
+  return (alpha > (1 << ALPHA_SHIFT)) ? (1 << ALPHA_SHIFT) : (int32_t)alpha;
+}
+
+// Feeds <value> to one axis and returns its output, clipped to 0..<max>: the speed estimate is
+// updated first, sets the cutoff for the position, and then pushes the output ahead
+uint16_t MotionFilter_axis(motionFilterAxis_t * axis, const motionFilterConfig_t * config, uint16_t value, uint32_t micros,
+  int32_t speedAlpha, uint16_t max)
+{
+  int32_t position = (int32_t)value << POSITION_SHIFT;
+  int32_t delta = position - axis->position;
+  int32_t speed;
+  uint32_t cutoff;
+
+  if(delta > INT16_MAX) delta = INT16_MAX;      // a 2048-count jump, so the multiply can't overflow
+  if(delta < -INT16_MAX) delta = -INT16_MAX;
+  speed = delta * MICROS_PER_STEP / (int32_t)micros;
+  if(speed > MOTION_FILTER_MAX_SPEED) speed = MOTION_FILTER_MAX_SPEED;
+  if(speed < -MOTION_FILTER_MAX_SPEED) speed = -MOTION_FILTER_MAX_SPEED;
+  axis->speed += ((speed - axis->speed) * speedAlpha) >> ALPHA_SHIFT;
+
+  cutoff = config->minCutoff + (uint32_t)config->beta * (uint32_t)(axis->speed < 0 ? -axis->speed : axis->speed) / 100;
+  axis->position += ((position - axis->position) * MotionFilter_alpha(cutoff, micros)) >> ALPHA_SHIFT;
+
+  position = axis->position + axis->speed * config->predictMicros / MICROS_PER_STEP;
+  if(position < 0) return 0;
+  position = (position + (1 << (POSITION_SHIFT - 1))) >> POSITION_SHIFT;
+  return (position > max) ? max : (uint16_t)position;
+}
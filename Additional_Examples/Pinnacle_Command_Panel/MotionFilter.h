@@ -0,0 +1,60 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Smoothing and prediction for absolute-mode data.
+// A 1-euro filter (Casiez et al.) per axis, in fixed point: a low-pass whose cutoff rises with the
+// finger's speed, so a finger holding still (or hovering over a curved overlay with the ADC
+// attenuated) loses its jitter while a moving one isn't held back. On top of that the output can
+// be pushed ahead along the filtered velocity by <predictMicros>, to win back what the filter and
+// the rest of the chain lag behind.
+// MotionFilter_apply() works in Pinnacle's own coordinates, before Transform_apply(), and costs the
+// same five divisions per packet whatever the input. A touch-down (or a gap longer than
+// MOTION_FILTER_MAX_GAP_US) restarts the filter at the raw position, so strokes don't smear into each
+// other; Z-idle packets pass untouched.
+// The settings can be tuned offline against a recorded trace with pinnacle_replay -f.
+
+#ifndef MOTION_FILTER_H
+#define MOTION_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Pinnacle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MOTION_FILTER_MAX_GAP_US  65535   // longer without a packet and the filter restarts
+#define MOTION_FILTER_MAX_SPEED   32767   // counts per second, faster is taken as this fast
+#define MOTION_FILTER_MAX_CUTOFF  10000   // 100 Hz, any cutoff above is taken as this
+
+typedef struct _motionFilterConfig
+{
+  uint16_t minCutoff;         // cutoff of a finger holding still, in 1/100 Hz
+  uint16_t beta;              // cutoff added per 100 counts/s of speed, in 1/100 Hz
+  uint16_t speedCutoff;       // cutoff of the speed estimate, in 1/100 Hz
+  uint16_t predictMicros;     // how far ahead the output is pushed; 0 = smoothing only
+} motionFilterConfig_t;
+
+typedef struct _motionFilterAxis
+{
+  int32_t position;           // filtered, in 1/16 counts
+  int32_t speed;              // filtered, in counts per second
+} motionFilterAxis_t;
+
+typedef struct _motionFilter
+{
+  motionFilterAxis_t x;
+  motionFilterAxis_t y;
+  uint32_t lastAt;            // timestamp of the last packet filtered
+  bool tracking;              // a touch is being filtered
+} motionFilter_t;
+
+void MotionFilter_initConfig(motionFilterConfig_t *);
+void MotionFilter_init(motionFilter_t *);
+void MotionFilter_apply(motionFilter_t *, const motionFilterConfig_t *, absData_t *, uint32_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOTION_FILTER_H
@@ -0,0 +1,62 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "PacketRing.h"
+
+// Keeps the compiler (and the core, where it matters) from reordering slot accesses past the
+// index update that publishes them
+#define RING_BARRIER()  __sync_synchronize()
+
+#define RING_MASK (PACKET_RING_SIZE - 1)
+
+void PacketRing_init(packetRing_t * ring)
+{
+  ring->head = 0;
+  ring->tail = 0;
+  ring->overflows = 0;
+}
+
+// Producer side. Copies <packet> into the ring; when the ring is full the new packet is dropped and
+// counted in <overflows> so the consumer never sees a slot being overwritten under it.
+bool PacketRing_push(packetRing_t * ring, const rawPacket_t * packet)
+{
+  uint16_t head = ring->head;
+
+  if((uint16_t)(head - ring->tail) >= PACKET_RING_SIZE)
+  {
+    ring->overflows++;
+    return false;
+  }
+
+  ring->slots[head & RING_MASK] = *packet;
+  RING_BARRIER();
+  ring->head = head + 1;
+
+  return true;
+}
+
+// Consumer side. Copies up to <maxCount> of the oldest packets into <*packets> and returns how many
+uint16_t PacketRing_pop(packetRing_t * ring, rawPacket_t * packets, uint16_t maxCount)
+{
+  uint16_t tail = ring->tail;
+  uint16_t available = (uint16_t)(ring->head - tail);
+  uint16_t i = 0;
+
+  if(available > maxCount) available = maxCount;
+  RING_BARRIER();
+
+  for(; i < available; i++)
+  {
+    packets[i] = ring->slots[(tail + i) & RING_MASK];
+  }
+
+  RING_BARRIER();
+  ring->tail = tail + available;
+
+  return available;
+}
+
+// Number of packets waiting to be popped
+uint16_t PacketRing_count(packetRing_t * ring)
+{
+  return (uint16_t)(ring->head - ring->tail);
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Single-producer/single-consumer ring of raw Pinnacle packets.
+// The producer is the DR interrupt (see Pinnacle_enableCapture()), the consumer is the main loop.
+// Neither side takes a lock: the producer only writes <head>, the consumer only writes <tail>.
+
+#ifndef PACKETRING_H
+#define PACKETRING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PACKET_RING_SIZE  16    // must be a power of two
+
+// A packet exactly as read from PACKET_BYTE_0..5, with its capture time and the feed mode it was read in
+typedef struct _rawPacket
+{
+  uint32_t timestamp;   // TIMER_micros() when the packet was read
+  uint8_t data[6];
+  uint8_t mode;         // RELATIVE or ABSOLUTE
+  uint8_t sensorId;
+} rawPacket_t;
+
+typedef struct _packetRing
+{
+  rawPacket_t slots[PACKET_RING_SIZE];
+  volatile uint16_t head;       // next slot to fill, written by the producer only
+  volatile uint16_t tail;       // next slot to drain, written by the consumer only
+  volatile uint32_t overflows;  // packets dropped because the ring was full
+} packetRing_t;
+
+void PacketRing_init(packetRing_t *);
+bool PacketRing_push(packetRing_t *, const rawPacket_t *);
+uint16_t PacketRing_pop(packetRing_t *, rawPacket_t *, uint16_t);
+uint16_t PacketRing_count(packetRing_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PACKETRING_H
@@ -4,44 +4,125 @@
 #include <stdbool.h>
 #include "Pinnacle.h"
 #include "Hardware.h"
+#include "PacketRing.h"
+#include "SpiQueue.h"
+#include "HoverMap.h"
+#include "Instrument.h"
+#include "Transport.h"
 
 // Masks for Cirque Register Access Protocol (RAP)
 #define WRITE_MASK  0x80
 #define READ_MASK   0xA0
 
+#define RAP_MAX_COUNT 32    // registers in the RAP address space
+
 // Values used to toggle the startup sequence of Pinnacle
 #define POWER_OFF_CMD  0x02
 #define POWER_ON_CMD   0x00
 
-#define COMP_MATRIX_ADDRESS 0x01DF
-#define COMP_MATRIX_SIZE    92      // 92 bytes (46 int16_t values)
+// ERA_CONTROL request bits
+#define ERA_CTRL_READ           0x01
+#define ERA_CTRL_WRITE          0x02
+#define ERA_CTRL_INC_ADDR_READ  0x04
+#define ERA_CTRL_INC_ADDR_WRITE 0x08
+
+#define ADC_ATTENUATION_ADDRESS 0x0187
+
+
+// Pinnacle_serviceJob() jobs and their steps
+#define JOB_ERA_READ    0
+#define JOB_ERA_WRITE   1
+#define JOB_CALIBRATE   2
+#define JOB_START       0
+#define JOB_WAIT        1     // a request has been issued, its completion is polled
+
+// Registers kept in the shadow: the configuration block, SysConfig1 through SleepTimer
+#define SHADOW_FIRST    SYS_CONFIG_1
+#define SHADOW_LAST     SLEEP_TIMER
+#define SHADOW_COUNT    (SHADOW_LAST - SHADOW_FIRST + 1)
+
+#define ERA_CACHE_SIZE  4     // extended registers remembered per sensor
 
 
 
 uint8_t _mode = ABSOLUTE;
 uint8_t _overlayMode = FLAT;
 
-// These values require tuning for optimal touch-response
-// Each element represents the Z-value below which is considered "hovering" in that XY region of the sensor.
-// The values present are not guaranteed to work for all HW configurations.
-const uint8_t Z_TRESH[ROWS_Y][COLS_X] =
+// Fast-read bookkeeping: a packet read in fast mode clears Status1 without waiting for DR to settle,
+// the settle time is instead checked (and usually already elapsed) by the next Pinnacle_available()
+bool _fastRead[PINNACLE_MAX_SENSORS];
+bool _settlePending[PINNACLE_MAX_SENSORS];
+uint32_t _clearedAt[PINNACLE_MAX_SENSORS];
+volatile bool _requestPending[PINNACLE_MAX_SENSORS];   // an asynchronous packet read is outstanding
+
+// Interrupt-driven capture: the DR handler needs to know, without touching the bus, whether the feed
+// is on and which packet layout the sensor is producing
+packetRing_t _captureRing[PINNACLE_MAX_SENSORS];
+volatile bool _feedEnabled[PINNACLE_MAX_SENSORS];
+volatile uint8_t _feedMode[PINNACLE_MAX_SENSORS];
+
+uint32_t _timeouts[PINNACLE_MAX_SENSORS];   // ERA and calibration requests Pinnacle never completed
+uint32_t _busErrors[PINNACLE_MAX_SENSORS];  // RAP transactions the transport failed
+
+// Register shadow: the configuration registers as last written to or read from each sensor, so a
+// read-modify-write costs a single write and writing a value the sensor already holds costs nothing.
+// Extended registers accessed through ERA_readCached()/ERA_writeCached() are remembered the same way.
+typedef struct _eraCacheEntry
 {
+  uint16_t address;
+  uint8_t value;
+  bool valid;
+} eraCacheEntry_t;
+
+uint8_t _shadow[PINNACLE_MAX_SENSORS][SHADOW_COUNT];
+uint16_t _shadowValid[PINNACLE_MAX_SENSORS];    // bit n set: _shadow[][n] holds the register's value
+eraCacheEntry_t _eraCache[PINNACLE_MAX_SENSORS][ERA_CACHE_SIZE];
+uint8_t _eraCacheNext[PINNACLE_MAX_SENSORS];    // entry to replace next
+uint32_t _shadowHits[PINNACLE_MAX_SENSORS];     // register and ERA accesses the shadow saved
+
+// These values require tuning for optimal touch-response, or can be learned (see HoverMap.h)
+// Each element represents the Z-value below which is considered "hovering" around the center of that
+// XY region of the sensor; between centers the thresholds are interpolated.
+// The values present are not guaranteed to work for all HW configurations.
+hoverMap_t _hoverMap =
+{{
   {0, 0,  0,  0,  0,  0, 0, 0},
   {0, 2,  3,  5,  5,  3, 2, 0},
   {0, 3,  5, 15, 15,  5, 2, 0},
   {0, 3,  5, 15, 15,  5, 3, 0},
   {0, 2,  3,  5,  5,  3, 2, 0},
   {0, 0,  0,  0,  0,  0, 0, 0},
-};
+}};
 
 void Pinnacle_getAbsolute(touchData_t *, uint8_t);
 void Pinnacle_getRelative(touchData_t *, uint8_t);
+void Pinnacle_clearFlagsDeferred(uint8_t);
+void Pinnacle_captureIsr(uint8_t);
+void Pinnacle_requestRead(spiXfer_t *);
+void Pinnacle_requestCleared(spiXfer_t *);
+uint8_t ERA_suspendFeed(uint8_t);
+void ERA_resumeFeed(uint8_t, uint8_t);
+bool ERA_waitIdle(uint8_t);
+void Pinnacle_startJob(pinnacleJob_t *, uint8_t, uint16_t, uint8_t *, uint16_t, uint8_t);
+void Pinnacle_requestEra(pinnacleJob_t *);
+uint8_t Pinnacle_endJob(pinnacleJob_t *, uint8_t);
+bool RAP_transferRead(uint8_t, uint8_t *, uint8_t, uint8_t);
+bool RAP_transferWrite(uint8_t *, uint8_t, uint8_t);
+void RAP_updateShadow(uint8_t, const uint8_t *, uint8_t, uint8_t);
+void ERA_updateCache(uint16_t, uint8_t, uint8_t);
+void ERA_cacheValue(uint16_t, uint8_t, uint8_t);
 
 void Pinnacle_init(touchData_t * touchData, uint8_t sensorId)
 {
+  uint8_t config[SHADOW_COUNT];
+
   HW_deAssertCS(sensorId);
   Pinnacle_clearFlags(sensorId);
 
+  // Load the register shadow in one read, the configuration calls below then only write
+  Pinnacle_invalidateShadow(sensorId);
+  RAP_readBytes(SHADOW_FIRST, config, SHADOW_COUNT, sensorId);
+
   // Host disables taps, secondary tap, scroll, and GlideExtend(R)
   // NOTE: these features pertain to relative mode only
   //  RAP_write(FEED_CONFIG_2, 0x1E);
@@ -53,8 +134,19 @@ void Pinnacle_init(touchData_t * touchData, uint8_t sensorId)
 }
 
 // Returns true if the data-ready signal (DR) is asserted
+// NOTE: while an asynchronous read is outstanding, and in fast-read mode, DR is ignored until it
+// has had DR_SETTLE_MICROS to deassert after the last packet was read, so a stale DR level is never
+// mistaken for a new packet
 bool Pinnacle_available(uint8_t sensorId)
 {
+  if(_requestPending[sensorId]) return false;
+
+  if(_settlePending[sensorId])
+  {
+    if((uint32_t)(TIMER_micros() - _clearedAt[sensorId]) < DR_SETTLE_MICROS) return false;
+    _settlePending[sensorId] = false;
+  }
+
   return HW_drAsserted(sensorId);
 }
 
@@ -65,6 +157,26 @@ void Pinnacle_cyclePower(uint8_t sensorId)
   RAP_write(SYS_CONFIG_1, POWER_OFF_CMD, sensorId);
   TIMER_delayMicroseconds(500);
   RAP_write(SYS_CONFIG_1, POWER_ON_CMD, sensorId);
+  Pinnacle_invalidateShadow(sensorId);    // the sensor may have come back with its defaults
+}
+
+// Forgets what the register shadow of <sensorId> holds; the next access of each register goes to
+// the sensor. Call it if the sensor may have been reset, or written to other than through Pinnacle.c.
+void Pinnacle_invalidateShadow(uint8_t sensorId)
+{
+  uint8_t i;
+
+  _shadowValid[sensorId] = 0;
+  for(i = 0; i < ERA_CACHE_SIZE; i++)
+  {
+    _eraCache[sensorId][i].valid = false;
+  }
+}
+
+// Returns the number of register and ERA accesses of <sensorId> the shadow made unnecessary
+uint32_t Pinnacle_shadowHits(uint8_t sensorId)
+{
+  return _shadowHits[sensorId];
 }
 
 
@@ -76,7 +188,7 @@ bool Pinnacle_sensorPresent(uint8_t sensorId)
   uint8_t temp = 0x00;
   RAP_write(Z_IDLE, 0x00, sensorId);
   TIMER_delayMicroseconds(500);
-  RAP_readBytes(Z_IDLE, &temp, 1, sensorId);
+  if(!RAP_readBytes(Z_IDLE, &temp, 1, sensorId)) return false;   // e.g. no I2C acknowledge
 
   return (temp == 0x00) ? true : false;
 }
@@ -101,34 +213,62 @@ void Pinnacle_getTouchData(touchData_t * touchData, uint8_t sensorId)
 // Clears Status1 register flags (SW_CC and SW_DR)
 void Pinnacle_clearFlags(uint8_t sensorId)
 {
+  INSTRUMENT_START(start);
+
   RAP_write(STATUS_1, 0x00, sensorId);
   TIMER_delayMicroseconds(50);
+
+  INSTRUMENT_STOP(start, INSTRUMENT_CLEAR_FLAGS, sensorId);
+}
+
+// Enables or disables the fast packet-read path for <sensorId>. When enabled, Pinnacle_getTouchData()
+// costs one CS cycle for the packet and one for the Status1 clear, and never busy-waits; the DR settle
+// time overlaps with whatever the caller does before it next calls Pinnacle_available().
+void Pinnacle_enableFastRead(bool fastEnable, uint8_t sensorId)
+{
+  _fastRead[sensorId] = fastEnable;
+  _settlePending[sensorId] = false;
+}
+
+// Clears Status1 flags without waiting; Pinnacle_available() ignores DR until it has settled
+void Pinnacle_clearFlagsDeferred(uint8_t sensorId)
+{
+  RAP_write(STATUS_1, 0x00, sensorId);
+  _clearedAt[sensorId] = TIMER_micros();
+  _settlePending[sensorId] = true;
+}
+
+// Clears Status1 after a packet read, using the deferred settle when fast-read is enabled
+void Pinnacle_clearPacketFlags(uint8_t sensorId)
+{
+  if(_fastRead[sensorId])
+  {
+    Pinnacle_clearFlagsDeferred(sensorId);
+  }
+  else
+  {
+    Pinnacle_clearFlags(sensorId);
+  }
 }
 
 // Changes output to absolute (x, y, z) mode
 void Pinnacle_setToAbsolute(touchData_t * touchData, uint8_t sensorId)
 {
-  uint8_t temp;
-
-  RAP_readBytes(FEED_CONFIG_1, &temp, 1, sensorId);
-  temp |= 0x02;
-  RAP_write(FEED_CONFIG_1, temp, sensorId);
+  RAP_writeCached(FEED_CONFIG_1, RAP_readCached(FEED_CONFIG_1, sensorId) | 0x02, sensorId);
 
   touchData->mode = ABSOLUTE;
+  _feedMode[sensorId] = ABSOLUTE;
 }
 
 // Changes output to relative (deltaX, deltaY, deltaScroll) mode
 void Pinnacle_setToRelative(touchData_t * touchData, uint8_t sensorId)
 {
-    uint8_t temp;
-
     if (touchData->overlayMode) Pinnacle_enableCurved(touchData, false, sensorId);   // if in curved mode, return to flat mode
 
-    RAP_readBytes(FEED_CONFIG_1, &temp, 1, sensorId);
-    temp &= ~0x02;
-    RAP_write(FEED_CONFIG_1, temp, sensorId);
+    RAP_writeCached(FEED_CONFIG_1, RAP_readCached(FEED_CONFIG_1, sensorId) & ~0x02, sensorId);
 
     touchData->mode = RELATIVE;
+    _feedMode[sensorId] = RELATIVE;
 }
 
 // Enables curved mode by changing the ADC attenuation and setting the <overlayMode>
@@ -157,36 +297,34 @@ void Pinnacle_enableCurved(touchData_t * touchData, bool curveEnable, uint8_t se
 // NOTE: Z-idle packets contains all zero values and are useful for detecting rapid taps
 void Pinnacle_setZIdleCount(uint8_t count, uint8_t sensorId)
 {
-  RAP_write(Z_IDLE, count, sensorId);
+  RAP_writeCached(Z_IDLE, count, sensorId);
 }
 
 // Enables or disables feed of touch data
 void Pinnacle_enableFeed(bool feedEnable, uint8_t sensorId)
 {
-  uint8_t temp;
+  uint8_t temp = RAP_readCached(FEED_CONFIG_1, sensorId);  // Contents of FeedConfig1 register
 
-  RAP_readBytes(FEED_CONFIG_1, &temp, 1, sensorId);  // Store contents of FeedConfig1 register
+  _feedEnabled[sensorId] = feedEnable;
 
   if(feedEnable)
   {
     temp |= 0x01;                 // Set Feed Enable bit
-    RAP_write(FEED_CONFIG_1, temp, sensorId);
   }
   else
   {
     temp &= ~0x01;                // Clear Feed Enable bit
-    RAP_write(FEED_CONFIG_1, temp, sensorId);
   }
+  RAP_writeCached(FEED_CONFIG_1, temp, sensorId);
 }
 
 // Enables vertical two-finger-scroll gesture (relative-mode only)
 void Pinnacle_enableScroll(uint8_t sensorId)
 {
-  uint8_t temp = 0;
-  RAP_readBytes(FEED_CONFIG_2, &temp, 1, sensorId);
+  uint8_t temp = RAP_readCached(FEED_CONFIG_2, sensorId);
   temp &= ~0x08;
   temp |= 0x01;
-  RAP_write(FEED_CONFIG_2, temp, sensorId);
+  RAP_writeCached(FEED_CONFIG_2, temp, sensorId);
 }
 
 // Pinnacle includes a feature that allows it to automatically detect when SPI data is
@@ -196,7 +334,7 @@ void Pinnacle_enableScroll(uint8_t sensorId)
 // in error. To disable the feature, call this function immediately after SPI is setup.
 void Pinnacle_disableAutoEdgeDetect(uint8_t sensorId)
 {
-  ERA_writeByte(0xDA, 0x81, sensorId);
+  ERA_writeCached(0xDA, 0x81, sensorId);
 }
 
 // Reads XYZ coordinate data from Pinnacle, as well as button states
@@ -206,8 +344,26 @@ void Pinnacle_getAbsolute(touchData_t * touchData, uint8_t sensorId)
   uint8_t data[6] = { 0,0,0,0,0,0 };
   RAP_readBytes(PACKET_BYTE_0, data, 6, sensorId);
 
-  Pinnacle_clearFlags(sensorId);
+  Pinnacle_clearPacketFlags(sensorId);
+
+  Pinnacle_decodeAbsolute(data, touchData);
+}
+
+// Reads X, Y, and Scroll-Wheel deltas from Pinnacle, as well as button states
+// NOTE: this function should be called immediately after DR is asserted (HIGH)
+void Pinnacle_getRelative(touchData_t * touchData, uint8_t sensorId)
+{
+  uint8_t data[4] = { 0,0,0,0 };
+  RAP_readBytes(PACKET_BYTE_0, data, 4, sensorId);
+
+  Pinnacle_clearPacketFlags(sensorId);
 
+  Pinnacle_decodeRelative(data, touchData);
+}
+
+// Decodes PACKET_BYTE_0..5 of an absolute-mode packet into <touchData.absolute>
+void Pinnacle_decodeAbsolute(const uint8_t * data, touchData_t * touchData)
+{
   touchData->absolute.buttons = data[0] & 0x1F;
 
   touchData->absolute.xValue = data[2] | ((data[4] & 0x0F) << 8);
@@ -221,21 +377,116 @@ void Pinnacle_getAbsolute(touchData_t * touchData, uint8_t sensorId)
   }
 }
 
-// Reads X, Y, and Scroll-Wheel deltas from Pinnacle, as well as button states
-// NOTE: this function should be called immediately after DR is asserted (HIGH)
-void Pinnacle_getRelative(touchData_t * touchData, uint8_t sensorId)
+// Decodes PACKET_BYTE_0..3 of a relative-mode packet into <touchData.relative>
+void Pinnacle_decodeRelative(const uint8_t * data, touchData_t * touchData)
 {
-  uint8_t data[4] = { 0,0,0,0 };
-  RAP_readBytes(PACKET_BYTE_0, data, 4, sensorId);
-
-  Pinnacle_clearFlags(sensorId);    // QUEUED
-
   touchData->relative.buttons = data[0] & 0x07;
-  touchData->relative.xDelta = (int8_t)data[1];
-  touchData->relative.yDelta = (int8_t)data[2];
+  touchData->relative.xDelta = (int16_t)(data[1] | ((data[0] & 0x10) ? 0xFF00 : 0));   // 9-bit, sign in byte 0
+  touchData->relative.yDelta = (int16_t)(data[2] | ((data[0] & 0x20) ? 0xFF00 : 0));
   touchData->relative.wheelCount = (int8_t)data[3];
 }
 
+// Decodes a captured packet according to the mode it was read in. Returns that mode (the caller's
+// <touchData.mode> is left alone, it tracks the current setting rather than the packet's).
+uint8_t Pinnacle_decodePacket(const rawPacket_t * packet, touchData_t * touchData)
+{
+  if(packet->mode == ABSOLUTE)
+  {
+    Pinnacle_decodeAbsolute(packet->data, touchData);
+  }
+  else
+  {
+    Pinnacle_decodeRelative(packet->data, touchData);
+  }
+
+  return packet->mode;
+}
+
+/*  Interrupt-driven capture  */
+// Starts (or stops) reading packets from the DR interrupt of <sensorId> into a per-sensor ring.
+// While capture is enabled, drain packets with Pinnacle_getCaptured() instead of polling
+// Pinnacle_available()/Pinnacle_getTouchData().
+// Returns false (and leaves capture off) if the sensor isn't on SPI: the I2C transfers block and
+// would break into a Wire transaction of the main loop, so I2C pads are polled with Pinnacle_pollPacket().
+bool Pinnacle_enableCapture(bool captureEnable, uint8_t sensorId)
+{
+  if(captureEnable)
+  {
+    if(Transport_get(sensorId) != &TRANSPORT_SPI) return false;
+
+    PacketRing_init(&_captureRing[sensorId]);
+    if(HW_drAsserted(sensorId))
+    {
+      Pinnacle_captureIsr(sensorId);  // DR is already high, so there will be no edge for this packet
+    }
+    HW_attachDrInterrupt(sensorId, Pinnacle_captureIsr);
+  }
+  else
+  {
+    HW_detachDrInterrupt(sensorId);
+  }
+  return true;
+}
+
+// DR rising-edge handler: reads the packet, clears Status1 (no settle wait, the next packet raises
+// a new edge) and queues the packet with its timestamp. Command-complete edges raised while the
+// feed is off only get their flags cleared.
+void Pinnacle_captureIsr(uint8_t sensorId)
+{
+  rawPacket_t packet = { 0, { 0,0,0,0,0,0 }, 0, 0 };
+  uint8_t cleared = 0x00;
+  INSTRUMENT_START(start);
+
+  // Untimed transfers: the RAP histograms belong to the main loop, this whole call is timed below
+  if(_feedEnabled[sensorId])
+  {
+    packet.timestamp = TIMER_micros();
+    packet.mode = _feedMode[sensorId];
+    packet.sensorId = sensorId;
+    RAP_transferRead(PACKET_BYTE_0, packet.data, (packet.mode == ABSOLUTE) ? 6 : 4, sensorId);
+  }
+
+  RAP_writeBytes(STATUS_1, &cleared, 1, sensorId);
+
+  if(_feedEnabled[sensorId])
+  {
+    PacketRing_push(&_captureRing[sensorId], &packet);
+  }
+
+  INSTRUMENT_STOP(start, INSTRUMENT_CAPTURE, sensorId);
+}
+
+// Polled counterpart of the capture for pads that can't be captured: if <sensorId> has a packet ready,
+// reads it into <*packet> with its timestamp, clears Status1 and returns true
+bool Pinnacle_pollPacket(rawPacket_t * packet, uint8_t sensorId)
+{
+  uint8_t i;
+
+  if(!Pinnacle_available(sensorId)) return false;
+
+  packet->timestamp = TIMER_micros();
+  packet->mode = _feedMode[sensorId];
+  packet->sensorId = sensorId;
+  for(i = 0; i < 6; i++) packet->data[i] = 0;
+  if(!RAP_readBytes(PACKET_BYTE_0, packet->data, (packet->mode == ABSOLUTE) ? 6 : 4, sensorId)) return false;
+
+  Pinnacle_clearPacketFlags(sensorId);
+  return true;
+}
+
+// Copies up to <maxCount> captured packets of <sensorId> into <*packets>, oldest first.
+// Returns the number copied.
+uint16_t Pinnacle_getCaptured(rawPacket_t * packets, uint16_t maxCount, uint8_t sensorId)
+{
+  return PacketRing_pop(&_captureRing[sensorId], packets, maxCount);
+}
+
+// Number of packets the ring of <sensorId> had to drop because the main loop fell behind
+uint32_t Pinnacle_captureOverflows(uint8_t sensorId)
+{
+  return _captureRing[sensorId].overflows;
+}
+
 // This function identifies when a finger is "hovering" so your system can choose to ignore it.
 // The sensor detects the finger in the space above the sensor. If the finger is on the surface of the sensor the Z value is highest.
 // If the finger is a few millimeters above the surface the z value is much lower.
@@ -244,49 +495,59 @@ void Pinnacle_getRelative(touchData_t * touchData, uint8_t sensorId)
 // With a curved overlay you tune the gain of the system to see a finger on the perimeter of the sensor
 // (the finger is farther away).  Unfortunately a finger near the center will be detected above the surface.
 // This code will tell you when to ignore that "hovering" finger.
-// ZVALUE_MAP[][] stores a lookup table in which you can define the Z-value and XY position that is considered "hovering". Experimentation/tuning is required.
+// _hoverMap stores a map in which you can define the Z-value and XY position that is considered "hovering". Experimentation/tuning
+// is required, or the map can be learned from a calibration sweep (see HoverMap_learn()) and set with Pinnacle_setHoverMap().
 // NOTE: Z-value output decreases to 0 as you move your finger away from the sensor, and it's maximum value is 0x63 (6-bits).
 
 void Pinnacle_applyCurvedThresh(absData_t * result)
 {
-  uint32_t zone_x, zone_y;
   //eliminate hovering
-  zone_x = result->xValue / ZONESCALE;
-  zone_y = result->yValue / ZONESCALE;
-  result->hovering = !(result->zValue > Z_TRESH[zone_y][zone_x]);
+  result->hovering = HoverMap_isHovering(&_hoverMap, result);
 }
 
-// Forces Pinnacle to re-calibrate, sometimes useful when miss-compensation
-// causes touchpad to miss real touches
-void Pinnacle_forceCalibration(uint8_t sensorId)
+// Replaces the hover-threshold map used by Pinnacle_applyCurvedThresh() (shared by all sensors)
+void Pinnacle_setHoverMap(const hoverMap_t * map)
 {
-  uint8_t CalConfig1Value = 0x00;
+  _hoverMap = *map;
+}
 
-  Pinnacle_enableFeed(false, sensorId);
-//  Pinnacle_ClearFlags();
-  RAP_readBytes(0x07, &CalConfig1Value, 1, sensorId);
-  CalConfig1Value |= 0x01;
-  RAP_write(0x07, CalConfig1Value, sensorId);
+// Returns the hover-threshold map in use
+const hoverMap_t * Pinnacle_getHoverMap(void)
+{
+  return &_hoverMap;
+}
 
-  do
-  {
-    RAP_readBytes(0x07, &CalConfig1Value, 1, sensorId);
-  }
-  while(CalConfig1Value & 0x01);
+// Forces Pinnacle to re-calibrate, sometimes useful when miss-compensation
+// causes touchpad to miss real touches. The feed is left disabled.
+// Returns false if the calibration didn't finish within CAL_TIMEOUT_MICROS.
+bool Pinnacle_forceCalibration(uint8_t sensorId)
+{
+  pinnacleJob_t job;
 
-  Pinnacle_clearFlags(sensorId);
+  Pinnacle_startCalibration(&job, sensorId);
+  while(Pinnacle_serviceJob(&job) == PINNACLE_BUSY);
+
+  return job.status == PINNACLE_DONE;
 }
 
-// Reads the 46 comp-matrix (uint16_t) values into <*results>.
+// Reads the 46 comp-matrix (uint16_t) values into <*results>. Returns false on an ERA timeout.
 // NOTE: The meaning of comp-matrix data depends on the electrode configuration
-void Pinnacle_getCompMatrix(int16_t * results, uint8_t sensorId)
+bool Pinnacle_getCompMatrix(int16_t * results, uint8_t sensorId)
 {
-  uint8_t i = 0;
   uint8_t compData[COMP_MATRIX_SIZE];
 
-  ERA_readBytes(COMP_MATRIX_ADDRESS, compData, COMP_MATRIX_SIZE, sensorId); // Get the bytes
+  if(!ERA_readBlock(COMP_MATRIX_ADDRESS, compData, COMP_MATRIX_SIZE, sensorId)) return false;  // Get the bytes
+
+  Pinnacle_decodeCompMatrix(compData, results);
+  return true;
+}
+
+// Merges the COMP_MATRIX_SIZE bytes read from the comp-matrix into 46 int16_t values
+void Pinnacle_decodeCompMatrix(const uint8_t * compData, int16_t * results)
+{
+  uint8_t i = 0;
 
-  for(; i < COMP_MATRIX_SIZE; i += 2)   // Merge the bytes into int16_t values
+  for(; i < COMP_MATRIX_SIZE; i += 2)
   {
     results[i/2] = ((int16_t)compData[i]) << 8;
     results[i/2] |= (int16_t)(compData[i+1]);
@@ -296,50 +557,293 @@ void Pinnacle_getCompMatrix(int16_t * results, uint8_t sensorId)
 // Adjusts the feedback in the ADC, effectively attenuating the finger signal
 // By default, the the signal is maximally attenuated (ADC_ATTENUATE_4X for use with thin, flat overlays)
 // For minimum attenuation, adcGain = ADC_ATTENUATE_1X. See Pinnacle.h for more details.
-void Pinnacle_setAdcAttenuation(uint8_t adcGain, uint8_t sensorId)
+// Returns false on an ERA timeout. Setting the attenuation the sensor already has costs no bus traffic.
+bool Pinnacle_setAdcAttenuation(uint8_t adcGain, uint8_t sensorId)
 {
   uint8_t temp = 0x00;
 
-  ERA_readBytes(0x0187, &temp, 1, sensorId);
+  if(!ERA_readCached(ADC_ATTENUATION_ADDRESS, &temp, sensorId)) return false;
   temp &= 0x3F; // clear top two bits
   temp |= adcGain;
-  ERA_writeByte(0x0187, temp, sensorId);
-  ERA_readBytes(0x0187, &temp, 1, sensorId);
+  return ERA_writeCached(ADC_ATTENUATION_ADDRESS, temp, sensorId);
+}
+
+// Returns the number of ERA and calibration requests of <sensorId> that timed out
+uint32_t Pinnacle_timeouts(uint8_t sensorId)
+{
+  return _timeouts[sensorId];
+}
+
+// Returns the number of RAP transactions with <sensorId> that failed on the bus, e.g. I2C NACKs
+uint32_t Pinnacle_busErrors(uint8_t sensorId)
+{
+  return _busErrors[sensorId];
+}
+
+/*  Resumable ERA transfers and calibration  */
+// A job is advanced by Pinnacle_serviceJob() one bus step at a time: each call issues at most a
+// request and a poll of its completion, and never waits. Call it from loop() (or a scheduler) until it
+// stops returning PINNACLE_BUSY; other sensors can be serviced in between. A request Pinnacle
+// doesn't complete within ERA_TIMEOUT_MICROS (CAL_TIMEOUT_MICROS for a calibration) ends the job
+// with PINNACLE_TIMEOUT, so a wedged sensor can't hang the caller.
+// NOTE: the job may not be moved, and <data> must stay valid, until the job has ended
+
+// Starts reading <count> bytes from the extended registers at <address> into <*data>
+void Pinnacle_startEraRead(pinnacleJob_t * job, uint16_t address, uint8_t * data, uint16_t count, uint8_t sensorId)
+{
+  Pinnacle_startJob(job, JOB_ERA_READ, address, data, count, sensorId);
+}
+
+// Starts writing <count> bytes from <*data> to the extended registers at <address>
+void Pinnacle_startEraWrite(pinnacleJob_t * job, uint16_t address, uint8_t * data, uint16_t count, uint8_t sensorId)
+{
+  Pinnacle_startJob(job, JOB_ERA_WRITE, address, data, count, sensorId);
+}
+
+// Starts a calibration, see Pinnacle_forceCalibration()
+void Pinnacle_startCalibration(pinnacleJob_t * job, uint8_t sensorId)
+{
+  Pinnacle_startJob(job, JOB_CALIBRATE, 0, 0, 0, sensorId);
+}
+
+// Advances <job> by one step. Returns PINNACLE_BUSY until the job has ended, then its result,
+// PINNACLE_DONE or PINNACLE_TIMEOUT (also held in <job->status>).
+uint8_t Pinnacle_serviceJob(pinnacleJob_t * job)
+{
+  uint8_t value = 0;
+  bool busy;
+
+  if(job->status != PINNACLE_BUSY) return job->status;
+
+  if(job->step == JOB_START)
+  {
+    if(job->kind == JOB_CALIBRATE)
+    {
+      Pinnacle_enableFeed(false, job->sensorId);
+      value = RAP_readCached(CAL_CONFIG_1, job->sensorId);
+      RAP_write(CAL_CONFIG_1, value | 0x01, job->sensorId);   // always written, it starts the calibration
+    }
+    else
+    {
+      job->feedConfig = ERA_suspendFeed(job->sensorId);
+      if(job->count == 0) return Pinnacle_endJob(job, PINNACLE_DONE);
+      Pinnacle_requestEra(job);
+    }
+    job->waitingSince = TIMER_micros();
+    job->step = JOB_WAIT;
+  }
+
+  // Poll the request issued by this or an earlier call; a poll that fails on the bus counts as busy
+  if(job->kind == JOB_CALIBRATE)
+  {
+    busy = !RAP_readBytes(CAL_CONFIG_1, &value, 1, job->sensorId) || (value & 0x01) != 0;
+  }
+  else
+  {
+    busy = !RAP_readBytes(ERA_CONTROL, &value, 1, job->sensorId) || value != 0x00;
+  }
+
+  if(busy)
+  {
+    if(TIMER_micros() - job->waitingSince < job->timeout) return PINNACLE_BUSY;
+    return Pinnacle_endJob(job, PINNACLE_TIMEOUT);
+  }
+
+  if(job->kind == JOB_CALIBRATE) return Pinnacle_endJob(job, PINNACLE_DONE);
+
+  if(job->kind == JOB_ERA_READ && !RAP_readBytes(ERA_VALUE, &job->data[job->done], 1, job->sensorId))
+  {
+    return Pinnacle_endJob(job, PINNACLE_TIMEOUT);
+  }
+  ERA_updateCache(job->address + job->done, job->data[job->done], job->sensorId);
+  if(++job->done == job->count) return Pinnacle_endJob(job, PINNACLE_DONE);
+
+  Pinnacle_requestEra(job);
+  job->waitingSince = TIMER_micros();
+  return PINNACLE_BUSY;
+}
+
+void Pinnacle_startJob(pinnacleJob_t * job, uint8_t kind, uint16_t address, uint8_t * data, uint16_t count, uint8_t sensorId)
+{
+  job->data = data;
+  job->address = address;
+  job->count = count;
+  job->done = 0;
+  job->timeout = (kind == JOB_CALIBRATE) ? CAL_TIMEOUT_MICROS : ERA_TIMEOUT_MICROS;
+  job->kind = kind;
+  job->step = JOB_START;
+  job->sensorId = sensorId;
+  job->status = PINNACLE_BUSY;
+}
+
+// Issues the ERA request for the next byte of <job>; the first one also loads the address, after
+// which Pinnacle advances it by itself
+void Pinnacle_requestEra(pinnacleJob_t * job)
+{
+  uint8_t request[4];
+
+  if(job->kind == JOB_ERA_READ)
+  {
+    if(job->done == 0)
+    {
+      request[0] = (uint8_t)(job->address >> 8);
+      request[1] = (uint8_t)(job->address & 0x00FF);
+      RAP_writeBytes(ERA_HIGH_BYTE, request, 2, job->sensorId);
+    }
+    RAP_write(ERA_CONTROL, ERA_CTRL_INC_ADDR_READ | ERA_CTRL_READ, job->sensorId);
+  }
+  else if(job->done == 0)
+  {
+    // ERA_VALUE, ERA_HIGH_BYTE, ERA_LOW_BYTE and ERA_CONTROL are consecutive registers, so value,
+    // address and request all go out in a single CS cycle
+    request[0] = job->data[0];
+    request[1] = (uint8_t)(job->address >> 8);
+    request[2] = (uint8_t)(job->address & 0x00FF);
+    request[3] = ERA_CTRL_INC_ADDR_WRITE | ERA_CTRL_WRITE;
+    RAP_writeBytes(ERA_VALUE, request, 4, job->sensorId);
+  }
+  else
+  {
+    request[0] = ERA_VALUE;
+    request[1] = job->data[job->done];
+    request[2] = ERA_CONTROL;
+    request[3] = ERA_CTRL_INC_ADDR_WRITE | ERA_CTRL_WRITE;
+    RAP_writePairs(request, 2, job->sensorId);
+  }
+}
+
+// Clears up after <job> and records its result
+uint8_t Pinnacle_endJob(pinnacleJob_t * job, uint8_t status)
+{
+  if(job->kind == JOB_CALIBRATE)
+  {
+    Pinnacle_clearFlagsDeferred(job->sensorId);
+  }
+  else
+  {
+    ERA_resumeFeed(job->feedConfig, job->sensorId);
+  }
+
+  if(status == PINNACLE_TIMEOUT) _timeouts[job->sensorId]++;
+  job->status = status;
+  return status;
 }
 
 /*  ERA (Extended Register Access) Functions  */
-// Reads <count> bytes from an extended register at <address> (16-bit address),
-// stores values in <*data>
-void ERA_readBytes(uint16_t address, uint8_t * data, uint16_t count, uint8_t sensorId)
+// The block functions run an ERA job (see Pinnacle_serviceJob()) to completion: the whole address
+// range is streamed with the chip's auto-increment modes, the feed is suspended and the address loaded
+// once, Status1 is cleared once at the end without a fixed delay, and the feed is put back the way it
+// was found. ERA_readBytes()/ERA_writeByte() are the original per-byte implementations, kept for
+// comparison. Every wait for Pinnacle is bounded by ERA_TIMEOUT_MICROS.
+
+// Reads <count> bytes from the extended registers starting at <address> into <*data>.
+// Returns false if Pinnacle stopped responding (see Pinnacle_startEraRead() for a non-blocking read).
+bool ERA_readBlock(uint16_t address, uint8_t * data, uint16_t count, uint8_t sensorId)
+{
+  pinnacleJob_t job;
+  INSTRUMENT_START(start);
+
+  Pinnacle_startEraRead(&job, address, data, count, sensorId);
+  while(Pinnacle_serviceJob(&job) == PINNACLE_BUSY);
+
+  INSTRUMENT_STOP(start, INSTRUMENT_ERA_READ, sensorId);
+  return job.status == PINNACLE_DONE;
+}
+
+// Writes <count> bytes from <*data> to the extended registers starting at <address>.
+// Returns false if Pinnacle stopped responding.
+bool ERA_writeBlock(uint16_t address, uint8_t * data, uint16_t count, uint8_t sensorId)
+{
+  pinnacleJob_t job;
+  INSTRUMENT_START(start);
+
+  Pinnacle_startEraWrite(&job, address, data, count, sensorId);
+  while(Pinnacle_serviceJob(&job) == PINNACLE_BUSY);
+
+  INSTRUMENT_STOP(start, INSTRUMENT_ERA_WRITE, sensorId);
+  return job.status == PINNACLE_DONE;
+}
+
+// Disables the feed (if it is enabled) for the duration of an ERA access.
+// Returns the FeedConfig1 value to hand back to ERA_resumeFeed().
+uint8_t ERA_suspendFeed(uint8_t sensorId)
+{
+  uint8_t feedConfig = RAP_readCached(FEED_CONFIG_1, sensorId);
+
+  if(feedConfig & 0x01)
+  {
+    _feedEnabled[sensorId] = false;
+    RAP_write(FEED_CONFIG_1, feedConfig & ~0x01, sensorId);
+  }
+
+  return feedConfig;
+}
+
+// Clears the command-complete flag raised by the ERA accesses and restores the feed
+void ERA_resumeFeed(uint8_t feedConfig, uint8_t sensorId)
+{
+  Pinnacle_clearFlagsDeferred(sensorId);
+  if(feedConfig & 0x01)
+  {
+    RAP_write(FEED_CONFIG_1, feedConfig, sensorId);
+    _feedEnabled[sensorId] = true;
+  }
+}
+
+// Waits for Pinnacle to finish the pending ERA request.
+// Returns false if it hasn't after ERA_TIMEOUT_MICROS.
+bool ERA_waitIdle(uint8_t sensorId)
 {
   uint8_t ERAControlValue = 0xFF;
+  uint32_t started = TIMER_micros();
+
+  for(;;)
+  {
+    if(RAP_readBytes(ERA_CONTROL, &ERAControlValue, 1, sensorId) && ERAControlValue == 0x00) return true;
+    if(TIMER_micros() - started >= ERA_TIMEOUT_MICROS) break;
+  }
+
+  _timeouts[sensorId]++;
+  return false;
+}
+
+// Reads <count> bytes from an extended register at <address> (16-bit address),
+// stores values in <*data>. Returns false, leaving the rest unread, on an ERA timeout.
+bool ERA_readBytes(uint16_t address, uint8_t * data, uint16_t count, uint8_t sensorId)
+{
   uint16_t i = 0;
+  bool completed = true;
+  INSTRUMENT_START(start);
 
   Pinnacle_enableFeed(false, sensorId); // Disable feed
 
   RAP_write(ERA_HIGH_BYTE, (uint8_t)(address >> 8), sensorId);     // Send upper byte of ERA address
   RAP_write(ERA_LOW_BYTE, (uint8_t)(address & 0x00FF), sensorId); // Send lower byte of ERA address
 
-  for(; i < count; i++)
+  for(; i < count && completed; i++)
   {
     RAP_write(ERA_CONTROL, 0x05, sensorId);  // Signal ERA-read (auto-increment) to Pinnacle
 
     // Wait for status register 0x1E to clear
-    do
+    completed = ERA_waitIdle(sensorId) && RAP_readBytes(ERA_VALUE, data + i, 1, sensorId);
+    if(completed)
     {
-      RAP_readBytes(ERA_CONTROL, &ERAControlValue, 1, sensorId);
-    } while(ERAControlValue != 0x00);
-
-    RAP_readBytes(ERA_VALUE, data + i, 1, sensorId);
+      ERA_updateCache(address + i, data[i], sensorId);
+    }
 
     Pinnacle_clearFlags(sensorId);
   }
+
+  INSTRUMENT_STOP(start, INSTRUMENT_ERA_READ, sensorId);
+  return completed;
 }
 
-// Writes a byte, <data>, to an extended register at <address> (16-bit address)
-void ERA_writeByte(uint16_t address, uint8_t data, uint8_t sensorId)
+// Writes a byte, <data>, to an extended register at <address> (16-bit address).
+// Returns false on an ERA timeout.
+bool ERA_writeByte(uint16_t address, uint8_t data, uint8_t sensorId)
 {
-  uint8_t ERAControlValue = 0xFF;
+  bool completed;
+  INSTRUMENT_START(start);
 
   Pinnacle_enableFeed(false, sensorId); // Disable feed
 
@@ -350,48 +854,313 @@ void ERA_writeByte(uint16_t address, uint8_t data, uint8_t sensorId)
 
   RAP_write(ERA_CONTROL, 0x02, sensorId);  // Signal an ERA-write to Pinnacle
 
-  // Wait for status register 0x1E to clear
-  do
-  {
-    RAP_readBytes(ERA_CONTROL, &ERAControlValue, 1, sensorId);
-  } while(ERAControlValue != 0x00);
+  completed = ERA_waitIdle(sensorId);       // Wait for status register 0x1E to clear
+  if(completed) ERA_updateCache(address, data, sensorId);
 
   Pinnacle_clearFlags(sensorId);
+
+  INSTRUMENT_STOP(start, INSTRUMENT_ERA_WRITE, sensorId);
+  return completed;
+}
+
+// Reads the extended register at <address> into <*value>, from the shadow if it has been accessed
+// through these functions before. Returns false on an ERA timeout.
+bool ERA_readCached(uint16_t address, uint8_t * value, uint8_t sensorId)
+{
+  eraCacheEntry_t * entry;
+  uint8_t i;
+
+  for(i = 0; i < ERA_CACHE_SIZE; i++)
+  {
+    entry = &_eraCache[sensorId][i];
+    if(entry->valid && entry->address == address)
+    {
+      *value = entry->value;
+      _shadowHits[sensorId]++;
+      return true;
+    }
+  }
+
+  if(!ERA_readBlock(address, value, 1, sensorId)) return false;
+
+  ERA_cacheValue(address, *value, sensorId);
+  return true;
+}
+
+// Writes <value> to the extended register at <address>, unless the shadow shows the register
+// already holds it. Returns false on an ERA timeout.
+bool ERA_writeCached(uint16_t address, uint8_t value, uint8_t sensorId)
+{
+  eraCacheEntry_t * entry;
+  uint8_t i;
+
+  for(i = 0; i < ERA_CACHE_SIZE; i++)
+  {
+    entry = &_eraCache[sensorId][i];
+    if(entry->valid && entry->address == address && entry->value == value)
+    {
+      _shadowHits[sensorId]++;
+      return true;
+    }
+  }
+
+  if(!ERA_writeBlock(address, &value, 1, sensorId)) return false;
+
+  ERA_cacheValue(address, value, sensorId);
+  return true;
+}
+
+// Remembers that the extended register at <address> holds <value>, replacing the oldest entry if
+// <address> has none
+void ERA_cacheValue(uint16_t address, uint8_t value, uint8_t sensorId)
+{
+  eraCacheEntry_t * entry;
+  uint8_t i;
+
+  for(i = 0; i < ERA_CACHE_SIZE; i++)
+  {
+    entry = &_eraCache[sensorId][i];
+    if(entry->valid && entry->address == address)
+    {
+      entry->value = value;
+      return;
+    }
+  }
+
+  entry = &_eraCache[sensorId][_eraCacheNext[sensorId]];
+  _eraCacheNext[sensorId] = (_eraCacheNext[sensorId] + 1) % ERA_CACHE_SIZE;
+  entry->address = address;
+  entry->value = value;
+  entry->valid = true;
+}
+
+// Keeps the ERA shadow entry for <address>, if there is one, in step with a transfer
+void ERA_updateCache(uint16_t address, uint8_t value, uint8_t sensorId)
+{
+  uint8_t i;
+
+  for(i = 0; i < ERA_CACHE_SIZE; i++)
+  {
+    if(_eraCache[sensorId][i].valid && _eraCache[sensorId][i].address == address)
+    {
+      _eraCache[sensorId][i].value = value;
+    }
+  }
 }
 
 /* Register Access Protocol (RAP) functions */
-// Reads <count> Pinnacle registers starting at <address>
-void RAP_readBytes(uint8_t address, uint8_t * data, uint8_t count, uint8_t sensorId)
+// Each RAP transaction is assembled in a local buffer and handed to the sensor's transport in one
+// call (see Transport.h), rather than one bus transfer per byte.
+// NOTE: Pinnacle has 32 RAP registers, so <count> is at most RAP_MAX_COUNT
+
+// Reads <count> Pinnacle registers starting at <address>.
+// Returns false, leaving <*data> as it was, if the transaction failed on the bus.
+bool RAP_readBytes(uint8_t address, uint8_t * data, uint8_t count, uint8_t sensorId)
+{
+  bool succeeded;
+  INSTRUMENT_START(start);
+
+  succeeded = RAP_transferRead(address, data, count, sensorId);
+
+  INSTRUMENT_STOP(start, INSTRUMENT_RAP_READ, sensorId);
+  return succeeded;
+}
+
+// RAP_readBytes() without the instrumentation, for the capture interrupt
+bool RAP_transferRead(uint8_t address, uint8_t * data, uint8_t count, uint8_t sensorId)
+{
+  if(count > RAP_MAX_COUNT) count = RAP_MAX_COUNT;
+
+  // Signal a RAP-read operation starting at <address>
+  if(!Transport_get(sensorId)->read(READ_MASK | address, data, count, sensorId))
+  {
+    _busErrors[sensorId]++;
+    return false;
+  }
+
+  RAP_updateShadow(address, data, count, sensorId);
+  return true;
+}
+
+// Hands <length> bytes of (command, data) pairs to the transport. If they fail on the bus, some of
+// them may still have been written, so the shadow of <sensorId> is dropped.
+bool RAP_transferWrite(uint8_t * pairs, uint8_t length, uint8_t sensorId)
 {
-  uint8_t cmdByte = READ_MASK | address;   // Form the READ command byte
+  if(Transport_get(sensorId)->write(pairs, length, sensorId)) return true;
+
+  _busErrors[sensorId]++;
+  Pinnacle_invalidateShadow(sensorId);
+  return false;
+}
+
+// Writes <count> consecutive Pinnacle registers starting at <address> in one transaction
+void RAP_writeBytes(uint8_t address, uint8_t * data, uint8_t count, uint8_t sensorId)
+{
+  uint8_t buffer[2 * RAP_MAX_COUNT];
   uint8_t i = 0;
 
-  SPI_beginTransaction();
+  if(count > RAP_MAX_COUNT) count = RAP_MAX_COUNT;
 
-  HW_assertCS(sensorId);
-  SPI_transfer(cmdByte);  // Signal a RAP-read operation starting at <address>
-  SPI_transfer(0xFC);     // Filler byte
-  SPI_transfer(0xFC);     // Filler byte
   for(; i < count; i++)
   {
-    data[i] =  SPI_transfer(0xFC);  // Each subsequent SPI transfer gets another register's contents
+    buffer[2 * i] = WRITE_MASK | (address + i);   // Pinnacle accepts back-to-back address/data pairs
+    buffer[2 * i + 1] = data[i];
   }
-  HW_deAssertCS(sensorId);
 
-  SPI_endTransaction();
+  if(RAP_transferWrite(buffer, 2 * count, sensorId))
+  {
+    RAP_updateShadow(address, data, count, sensorId);
+  }
+}
+
+// Writes <count> (address, data) pairs from <*pairs> to arbitrary registers in one transaction
+void RAP_writePairs(uint8_t * pairs, uint8_t count, uint8_t sensorId)
+{
+  uint8_t buffer[2 * RAP_MAX_COUNT];
+  uint8_t i = 0;
+
+  if(count > RAP_MAX_COUNT) count = RAP_MAX_COUNT;
+
+  for(; i < count; i++)
+  {
+    buffer[2 * i] = WRITE_MASK | pairs[2 * i];
+    buffer[2 * i + 1] = pairs[2 * i + 1];
+  }
+
+  if(!RAP_transferWrite(buffer, 2 * count, sensorId)) return;
+
+  for(i = 0; i < count; i++)
+  {
+    RAP_updateShadow(pairs[2 * i], &pairs[2 * i + 1], 1, sensorId);
+  }
 }
 
 // Writes single-byte <data> to <address>
 void RAP_write(uint8_t address, uint8_t data, uint8_t sensorId)
 {
-  uint8_t cmdByte = WRITE_MASK | address;  // Form the WRITE command byte
+  uint8_t buffer[2];
+  INSTRUMENT_START(start);
 
-  SPI_beginTransaction();
+  buffer[0] = WRITE_MASK | address;   // Signal a write to register at <address>
+  buffer[1] = data;                   // Send <value> to be written to register
 
-  HW_assertCS(sensorId);
-  SPI_transfer(cmdByte);  // Signal a write to register at <address>
-  SPI_transfer(data);    // Send <value> to be written to register
-  HW_deAssertCS(sensorId);
+  if(RAP_transferWrite(buffer, 2, sensorId))
+  {
+    RAP_updateShadow(address, &data, 1, sensorId);
+  }
+
+  INSTRUMENT_STOP(start, INSTRUMENT_RAP_WRITE, sensorId);
+}
+
+// Returns the register at <address>, from the shadow when it holds it
+uint8_t RAP_readCached(uint8_t address, uint8_t sensorId)
+{
+  uint8_t data = 0x00;
+
+  if(address >= SHADOW_FIRST && address <= SHADOW_LAST && (_shadowValid[sensorId] & (1 << (address - SHADOW_FIRST))))
+  {
+    _shadowHits[sensorId]++;
+    return _shadow[sensorId][address - SHADOW_FIRST];
+  }
+
+  RAP_readBytes(address, &data, 1, sensorId);
+  return data;
+}
+
+// Writes <data> to <address>, unless the shadow shows the register already holds it.
+// NOTE: only for registers where writing the same value again has no effect
+void RAP_writeCached(uint8_t address, uint8_t data, uint8_t sensorId)
+{
+  if(address >= SHADOW_FIRST && address <= SHADOW_LAST && (_shadowValid[sensorId] & (1 << (address - SHADOW_FIRST)))
+    && _shadow[sensorId][address - SHADOW_FIRST] == data)
+  {
+    _shadowHits[sensorId]++;
+    return;
+  }
+
+  RAP_write(address, data, sensorId);
+}
+
+// Records in the shadow the <count> registers from <address> that were just read or written
+void RAP_updateShadow(uint8_t address, const uint8_t * data, uint8_t count, uint8_t sensorId)
+{
+  uint8_t i;
+
+  if(address > SHADOW_LAST || address + count <= SHADOW_FIRST) return;   // packet reads end here
+
+  for(i = 0; i < count; i++)
+  {
+    if(address + i < SHADOW_FIRST || address + i > SHADOW_LAST) continue;
+    _shadow[sensorId][address + i - SHADOW_FIRST] = data[i];
+    _shadowValid[sensorId] |= 1 << (address + i - SHADOW_FIRST);
+  }
+}
+
+/*  Asynchronous RAP requests (see SpiQueue.h)  */
+// Queues the read of the next packet from <sensorId> and the Status1 clear that follows it, and
+// returns immediately. When the read completes, the packet is decoded into <*touchData> and
+// <callback> is called (from SpiQueue_service()). <request> must stay valid until then.
+// Returns false if the queue had no room for both transfers, or the sensor isn't on SPI.
+bool Pinnacle_requestTouchData(packetRequest_t * request, touchData_t * touchData, uint8_t sensorId, void (*callback)(packetRequest_t *))
+{
+  uint8_t count = (_feedMode[sensorId] == ABSOLUTE) ? 6 : 4;
+  uint8_t i;
+
+  if(Transport_get(sensorId) != &TRANSPORT_SPI) return false;
+  if(SpiQueue_room() < 2) return false;   // a read without its clear would leave DR set for good
+
+  request->touchData = touchData;
+  request->callback = callback;
+  request->mode = _feedMode[sensorId];
+
+  request->read.sensorId = sensorId;
+  request->read.length = count + 3;
+  request->read.buffer[0] = READ_MASK | PACKET_BYTE_0;
+  for(i = 1; i < count + 3; i++) request->read.buffer[i] = 0xFC;
+  request->read.callback = Pinnacle_requestRead;
+  request->read.context = request;
+
+  request->clear.sensorId = sensorId;
+  request->clear.length = 2;
+  request->clear.buffer[0] = WRITE_MASK | STATUS_1;
+  request->clear.buffer[1] = 0x00;
+  request->clear.callback = Pinnacle_requestCleared;
+  request->clear.context = request;
+
+  SpiQueue_submit(&request->read);
+  SpiQueue_submit(&request->clear);   // the queue is FIFO, so the clear follows the read
+
+  request->pending = true;
+  _requestPending[sensorId] = true;   // DR belongs to this request until its clear has settled
+  return true;
+}
+
+// Completion of the packet read: decode and hand the result to the requester while the Status1
+// clear is still on the bus
+void Pinnacle_requestRead(spiXfer_t * xfer)
+{
+  packetRequest_t * request = (packetRequest_t *)xfer->context;
+
+  if(request->mode == ABSOLUTE)
+  {
+    Pinnacle_decodeAbsolute(&xfer->buffer[3], request->touchData);
+  }
+  else
+  {
+    Pinnacle_decodeRelative(&xfer->buffer[3], request->touchData);
+  }
+
+  if(request->callback != 0) request->callback(request);
+}
+
+// Completion of the Status1 clear: the request is finished and may be reused, and DR is given
+// DR_SETTLE_MICROS from now before it is trusted again
+void Pinnacle_requestCleared(spiXfer_t * xfer)
+{
+  packetRequest_t * request = (packetRequest_t *)xfer->context;
 
-  SPI_endTransaction();
+  _clearedAt[xfer->sensorId] = TIMER_micros();
+  _settlePending[xfer->sensorId] = true;
+  _requestPending[xfer->sensorId] = false;
+  request->pending = false;
 }
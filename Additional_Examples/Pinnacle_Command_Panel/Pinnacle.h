@@ -1,5 +1,13 @@
 // Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
 
+#ifndef PINNACLE_H
+#define PINNACLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "PacketRing.h"
+#include "SpiQueue.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -61,9 +69,23 @@ extern "C" {
 #define RELATIVE  0
 #define ABSOLUTE  1
 
+#define PINNACLE_MAX_SENSORS  8     // number of sensors Pinnacle.c keeps per-sensor state for
+#define DR_SETTLE_MICROS      50    // time for DR to deassert after Status1 flags are cleared
+
 #define FLAT      0
 #define CURVED    1
 
+// Results of the resumable ERA transfers and calibration, see Pinnacle_serviceJob()
+#define PINNACLE_DONE       0
+#define PINNACLE_BUSY       1
+#define PINNACLE_TIMEOUT    2
+
+#define ERA_TIMEOUT_MICROS  5000      // longest Pinnacle may take to complete one ERA request
+#define CAL_TIMEOUT_MICROS  250000    // longest a calibration may take
+
+#define COMP_MATRIX_ADDRESS 0x01DF
+#define COMP_MATRIX_SIZE    92        // bytes of comp-matrix data (46 int16_t values)
+
 // Custom types make a convenient way to store and access measurements
 typedef struct _absData
 {
@@ -77,8 +99,8 @@ typedef struct _absData
 typedef struct _relData
 {
   uint8_t buttons;
-  int8_t xDelta;
-  int8_t yDelta;
+  int16_t xDelta;         // 9 bits, -256 to 255
+  int16_t yDelta;
   int8_t wheelCount;
 } relData_t;
 
@@ -90,6 +112,35 @@ typedef struct _touchData
   uint8_t overlayMode;
 } touchData_t;
 
+// An asynchronous packet read, see Pinnacle_requestTouchData()
+typedef struct _packetRequest
+{
+  spiXfer_t read;
+  spiXfer_t clear;
+  touchData_t * touchData;
+  void (*callback)(struct _packetRequest *);
+  uint8_t mode;
+  volatile bool pending;      // true until both transfers are done and the request may be reused
+} packetRequest_t;
+
+// An ERA transfer or calibration in progress, see Pinnacle_serviceJob()
+typedef struct _pinnacleJob
+{
+  uint8_t * data;
+  uint16_t address;
+  uint16_t count;
+  uint16_t done;            // bytes transferred so far
+  uint32_t waitingSince;    // TIMER_micros() when the request being polled was issued
+  uint32_t timeout;         // microseconds a single request may take
+  uint8_t kind;
+  uint8_t step;
+  uint8_t feedConfig;       // FeedConfig1 before an ERA transfer, restored at its end
+  uint8_t sensorId;
+  uint8_t status;           // PINNACLE_BUSY until the job has ended
+} pinnacleJob_t;
+
+struct _hoverMap;   // see HoverMap.h
+
 // Higher-level functions demonstrate usage of Pinnacle
 void Pinnacle_init(touchData_t *, uint8_t);
 bool Pinnacle_available(uint8_t);
@@ -97,24 +148,61 @@ void Pinnacle_cyclePower(uint8_t);
 bool Pinnacle_sensorPresent(uint8_t);
 void Pinnacle_getTouchData(touchData_t *, uint8_t);
 void Pinnacle_applyCurvedThresh(absData_t *);
+void Pinnacle_setHoverMap(const struct _hoverMap *);
+const struct _hoverMap * Pinnacle_getHoverMap(void);
 void Pinnacle_clearFlags(uint8_t);
+void Pinnacle_clearPacketFlags(uint8_t);
+void Pinnacle_enableFastRead(bool, uint8_t);
 void Pinnacle_setToAbsolute(touchData_t *, uint8_t);
 void Pinnacle_setToRelative(touchData_t *, uint8_t);
 void Pinnacle_enableCurved(touchData_t *, bool, uint8_t);
 void Pinnacle_setZIdleCount(uint8_t, uint8_t);
 void Pinnacle_enableFeed(bool, uint8_t);
 void Pinnacle_enableScroll(uint8_t);
-void Pinnacle_forceCalibration(uint8_t);
-void Pinnacle_getCompMatrix(int16_t *, uint8_t);
+bool Pinnacle_forceCalibration(uint8_t);
+bool Pinnacle_getCompMatrix(int16_t *, uint8_t);
+void Pinnacle_decodeCompMatrix(const uint8_t *, int16_t *);
 bool Pinnacle_sensorPresent(uint8_t);
-void Pinnacle_setAdcAttenuation(uint8_t, uint8_t);
+bool Pinnacle_setAdcAttenuation(uint8_t, uint8_t);
+uint32_t Pinnacle_timeouts(uint8_t);
+uint32_t Pinnacle_busErrors(uint8_t);
+void Pinnacle_invalidateShadow(uint8_t);
+uint32_t Pinnacle_shadowHits(uint8_t);
+void Pinnacle_decodeAbsolute(const uint8_t *, touchData_t *);
+void Pinnacle_decodeRelative(const uint8_t *, touchData_t *);
+uint8_t Pinnacle_decodePacket(const rawPacket_t *, touchData_t *);
+
+// Interrupt-driven capture of packets into a per-sensor ring (SPI pads), or polled reads of them
+bool Pinnacle_enableCapture(bool, uint8_t);
+uint16_t Pinnacle_getCaptured(rawPacket_t *, uint16_t, uint8_t);
+bool Pinnacle_pollPacket(rawPacket_t *, uint8_t);
+uint32_t Pinnacle_captureOverflows(uint8_t);
+
+// Non-blocking packet reads through the SPI transaction queue
+bool Pinnacle_requestTouchData(packetRequest_t *, touchData_t *, uint8_t, void (*)(packetRequest_t *));
+
+// Resumable, timeout-bounded ERA transfers and calibration
+void Pinnacle_startEraRead(pinnacleJob_t *, uint16_t, uint8_t *, uint16_t, uint8_t);
+void Pinnacle_startEraWrite(pinnacleJob_t *, uint16_t, uint8_t *, uint16_t, uint8_t);
+void Pinnacle_startCalibration(pinnacleJob_t *, uint8_t);
+uint8_t Pinnacle_serviceJob(pinnacleJob_t *);
 
 // Low-level register access for Pinnacle
-void RAP_readBytes(uint8_t, uint8_t *, uint8_t, uint8_t);
+bool RAP_readBytes(uint8_t, uint8_t *, uint8_t, uint8_t);
 void RAP_write(uint8_t, uint8_t, uint8_t);
-void ERA_readBytes(uint16_t, uint8_t *, uint16_t, uint8_t);
-void ERA_writeByte(uint16_t, uint8_t, uint8_t);
+void RAP_writeBytes(uint8_t, uint8_t *, uint8_t, uint8_t);
+void RAP_writePairs(uint8_t *, uint8_t, uint8_t);
+uint8_t RAP_readCached(uint8_t, uint8_t);
+void RAP_writeCached(uint8_t, uint8_t, uint8_t);
+bool ERA_readBlock(uint16_t, uint8_t *, uint16_t, uint8_t);
+bool ERA_writeBlock(uint16_t, uint8_t *, uint16_t, uint8_t);
+bool ERA_readBytes(uint16_t, uint8_t *, uint16_t, uint8_t);
+bool ERA_writeByte(uint16_t, uint8_t, uint8_t);
+bool ERA_readCached(uint16_t, uint8_t *, uint8_t);
+bool ERA_writeCached(uint16_t, uint8_t, uint8_t);
 
 #ifdef __cplusplus
 }
 #endif
+
+#endif // PINNACLE_H
@@ -0,0 +1,142 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Compile-time configured front-end to the Pinnacle C API (C++11).
+// A pad whose overlay and packet mode never change can be described by its type:
+//
+//    Pinnacle<PinnacleSpi<0>, PinnacleFlat, PinnacleAbsolute> pad0;
+//    absData_t data;
+//    pad0.begin();
+//    if(pad0.available()) pad0.read(&data);
+//
+// read() resolves the packet size, decoding and overlay handling from the template arguments, so
+// the per-packet path of a flat absolute pad has no mode dispatch and no curved-threshold branch
+// (compare Pinnacle_getTouchData(), which checks touchData->mode and ->overlayMode on every packet).
+// Pads that switch modes at run-time, like the Command Panel's, keep using the C API.
+
+#ifndef PINNACLE_HPP
+#define PINNACLE_HPP
+
+#include "Pinnacle.h"
+
+/*  Bus: how a pad is reached  */
+// A pad registered as <SensorId> through HW_init() / HW_addSensor()
+template<uint8_t SensorId>
+struct PinnacleSpi
+{
+  static const uint8_t sensorId = SensorId;
+
+  static void readRegisters(uint8_t address, uint8_t * data, uint8_t count)
+  {
+    RAP_readBytes(address, data, count, SensorId);
+  }
+
+  static void writeRegister(uint8_t address, uint8_t data)
+  {
+    RAP_write(address, data, SensorId);
+  }
+};
+
+/*  Overlay: attenuation and hover handling  */
+struct PinnacleFlat
+{
+  static const uint8_t overlayMode = FLAT;
+  static const uint8_t attenuation = ADC_ATTENUATE_4X;
+
+  static void filter(absData_t *) {}
+  static void filter(relData_t *) {}
+};
+
+// Thick (curved) overlays need more gain, and a finger hovering over the middle of the pad is
+// flagged with the Z-threshold map (see Pinnacle_applyCurvedThresh())
+struct PinnacleCurved
+{
+  static const uint8_t overlayMode = CURVED;
+  static const uint8_t attenuation = ADC_ATTENUATE_2X;
+
+  static void filter(absData_t * data)
+  {
+    Pinnacle_applyCurvedThresh(data);
+  }
+};
+
+/*  Mode: packet layout  */
+struct PinnacleAbsolute
+{
+  typedef absData_t data_t;
+  static const uint8_t mode = ABSOLUTE;
+  static const uint8_t packetSize = 6;
+
+  // Same layout as Pinnacle_decodeAbsolute(), without the overlay check
+  static void decode(const uint8_t * data, absData_t * result)
+  {
+    result->buttons = data[0] & 0x1F;
+    result->xValue = data[2] | ((data[4] & 0x0F) << 8);
+    result->yValue = data[3] | ((data[4] & 0xF0) << 4);
+    result->zValue = data[5] & 0x3F;
+  }
+};
+
+struct PinnacleRelative
+{
+  typedef relData_t data_t;
+  static const uint8_t mode = RELATIVE;
+  static const uint8_t packetSize = 4;
+
+  static void decode(const uint8_t * data, relData_t * result)
+  {
+    result->buttons = data[0] & 0x07;
+    result->xDelta = (int16_t)(data[1] | ((data[0] & 0x10) ? 0xFF00 : 0));   // 9-bit, sign in byte 0
+    result->yDelta = (int16_t)(data[2] | ((data[0] & 0x20) ? 0xFF00 : 0));
+    result->wheelCount = (int8_t)data[3];
+  }
+};
+
+template<class Bus, class Overlay, class Mode, uint8_t ZIdleCount = 5>
+class Pinnacle
+{
+  static_assert(Mode::mode == ABSOLUTE || Overlay::overlayMode == FLAT,
+    "the curved-overlay threshold needs absolute packets");
+
+public:
+  typedef typename Mode::data_t data_t;
+
+  // Pinnacle_init() followed by this pad's mode, Z-idle count and overlay settings.
+  // <fastRead> defers the DR settle time as Pinnacle_enableFastRead() does.
+  void begin(bool fastRead = false)
+  {
+    touchData_t touchData = touchData_t();
+
+    Pinnacle_init(&touchData, Bus::sensorId);
+    if(ZIdleCount != 5) Pinnacle_setZIdleCount(ZIdleCount, Bus::sensorId);
+    if(Mode::mode == RELATIVE) Pinnacle_setToRelative(&touchData, Bus::sensorId);
+
+    if(Overlay::overlayMode == CURVED)
+    {
+      Pinnacle_setAdcAttenuation(Overlay::attenuation, Bus::sensorId);
+      Pinnacle_forceCalibration(Bus::sensorId);     // Adjust comp matrix after changing ADC data
+      Pinnacle_enableFeed(true, Bus::sensorId);     // Reenable feed after calibration
+    }
+
+    Pinnacle_enableFastRead(fastRead, Bus::sensorId);
+  }
+
+  bool available()
+  {
+    return Pinnacle_available(Bus::sensorId);
+  }
+
+  // Reads, decodes and filters one packet
+  // NOTE: call this once available() returns true
+  void read(data_t * data)
+  {
+    uint8_t packet[Mode::packetSize];
+
+    Bus::readRegisters(PACKET_BYTE_0, packet, Mode::packetSize);
+    Pinnacle_clearPacketFlags(Bus::sensorId);
+
+    Mode::decode(packet, data);
+    Overlay::filter(data);
+  }
+};
+
+#endif // PINNACLE_HPP
@@ -2,7 +2,17 @@
 
 #include "Hardware.h"
 #include "Pinnacle.h"
+#include "HoverMap.h"
+#include "Trace.h"
+#include "Telemetry.h"
+#include "TextFormat.h"
+#include "Instrument.h"
+#include "Profile.h"
+#include "Gesture.h"
+#include "Polar.h"
+#include "MotionFilter.h"
 #include <string.h>
+#include <EEPROM.h>
 
 // ___ Interfacing to Touchpads Based on Cirque's Pinnacle (1CA027) ASIC ___
 // This demonstration application is built to work with a Teensy 3.2 but can easily be adapted to
@@ -24,18 +34,58 @@
 #define LED0_PIN 21
 #define LED1_PIN 20
 #define SENSOR_0 0
-#define SENSOR_1 1
+
+#define HOVER_LEARN_MS        10000   // length of the hover-map calibration sweep
+#define HOVER_MAP_EEPROM_ADDR 0       // where the learned hover map is kept
+
+#define TELEMETRY_BATCH       8       // reports per telemetry frame (one 64-byte USB packet)
+#define TELEMETRY_MAX_AGE_US  20000   // a partial frame is sent once its oldest report is this old
+
+#define LINE_CAPACITY   (PINNACLE_MAX_SENSORS * 32)   // one text line, a column per sensor
+#define LOOP_BUCKETS    16                            // loop-period histogram, powers of two in us
+
+// Loop-period statistics, printed and reset by the 'j' command
+typedef struct _loopStats
+{
+  uint32_t lastStart;
+  uint32_t count;
+  uint32_t total;
+  uint32_t minPeriod;
+  uint32_t maxPeriod;
+  uint32_t buckets[LOOP_BUCKETS];   // bucket n counts periods of 2^n to 2^(n+1)-1 us
+} loopStats_t;
 
 // Struct to manage unique sensor attributes.
 typedef struct _senFlag
 {
   bool senSel;
   touchData_t touchData;
+  uint32_t capturedAt;    // TIMER_micros() when the packet in <touchData> was read
+  bool captured;          // packets come from the DR interrupt; false for I2C pads, which are polled
 } senFlag_t;
 
-senFlag_t senData[2];
-
-
+senFlag_t senData[PINNACLE_MAX_SENSORS];
+bool traceEnabled = false;    // stream binary trace records (Trace.h) instead of text columns
+bool telemetryEnabled = false;  // stream binary telemetry frames (Telemetry.h) instead of text columns
+telemetry_t telemetry;
+char lineStorage[LINE_CAPACITY];
+textFormat_t line;              // every line of touch data is built here, nothing is allocated
+loopStats_t loopStats;
+pinnacleJob_t job;              // calibration or comp-matrix read started by a command, run by loop()
+uint8_t jobCommand = 0;         // the command that started <job>, 0 while none is running
+uint8_t compBytes[COMP_MATRIX_SIZE];
+pinnacleProfile_t profile;      // tuning copied to every sensor by the 'p' command
+profileApply_t profileApply;
+const uint16_t tuningAddresses[] = { 0x0187, 0x0149, 0x0168 };  // ADC attenuation, X and Y WideZMin
+const uint8_t ledPins[] = { LED0_PIN, LED1_PIN };   // sensors without an LED just aren't shown
+bool gesturesEnabled = false;   // print the gestures of absolute-mode sensors instead of text columns
+gesture_t gestures[PINNACLE_MAX_SENSORS];
+gestureConfig_t gestureConfig;
+bool polarEnabled = false;      // print absolute data as angle (degrees) and radius instead of X and Y
+polar_t polar;
+bool filterEnabled = false;     // smooth absolute data (MotionFilter.h) before it is output
+motionFilter_t filters[PINNACLE_MAX_SENSORS];
+motionFilterConfig_t filterConfig;
 
 // setup() gets called once at power-up, sets up serial debug output and Cirque's Pinnacle ASIC.
 void setup()
@@ -46,25 +96,50 @@ void setup()
 
   senFlag_t tempFlag;
   touchData_t tempTouch;
+  uint32_t started;
+  uint8_t i;
 
   tempFlag.senSel = true;
   tempFlag.touchData = tempTouch;
 
-  senData[0] = tempFlag;
-  senData[1] = tempFlag;
+  for(i = 0; i < PINNACLE_MAX_SENSORS; i++)
+  {
+    senData[i] = tempFlag;
+  }
 
   pinMode(LED0_PIN, OUTPUT);
   pinMode(LED1_PIN, OUTPUT);
 
     // Initialize Hardware variables and SPI communication before initializing Pinnacle
-  HW_init();
+  HW_init();      // Sensors 0 and 1 on the dev-kit's sensor ports
+  // More pads get the next sensorIds, e.g.: HW_addSensor(CS_PIN, DR_PIN, 0);  (bus 1 = SPI1, ...)
+  // or, for pads on I2C: HW_addI2cSensor(I2C_ADDRESS_DEFAULT, DR_PIN);  with I2C_init(I2C_CLOCK_FAST);
   SPI_init(1000000, MSBFIRST, SPI_MODE1);
   delay(100);
+  started = micros();
   cyclePower();   // Cycle the power on Pinnacle to refresh registers.
 
-  Pinnacle_init(&senData[SENSOR_0].touchData, SENSOR_0);
-  Pinnacle_init(&senData[SENSOR_1].touchData, SENSOR_1);
+  for(i = 0; i < HW_sensorCount(); i++)
+  {
+    Pinnacle_init(&senData[i].touchData, i);
+    // Packets of SPI pads are read from the DR interrupt into a ring, so printing below can't make
+    // us miss any; I2C transfers block and can't run from the interrupt, those pads are polled, with
+    // the fast read so each poll doesn't wait out the DR settle time
+    senData[i].captured = Pinnacle_enableCapture(true, i);
+    if(!senData[i].captured) Pinnacle_enableFastRead(true, i);
+  }
 
+  Serial.print("Sensors ready in ");
+  Serial.print(micros() - started);
+  Serial.println(" us");
+
+  loadHoverMap();
+  Telemetry_init(&telemetry, TELEMETRY_BATCH, TELEMETRY_MAX_AGE_US, writeTelemetry);
+  TextFormat_init(&line, lineStorage, sizeof(lineStorage));
+  Gesture_initConfig(&gestureConfig);
+  Polar_init(&polar, 1024);
+  MotionFilter_initConfig(&filterConfig);
+  resetLoopStats();
   printInstructions();
 }
 
@@ -73,53 +148,89 @@ void loop()
 {
   uint8_t rxByte, i;
   uint8_t sensorId = 0;
-  int16_t compData[46];
-  String printData = "";
-
-  // Fetch and format touch data for display for both sensors.
-  if(Pinnacle_available(SENSOR_0) && senData[SENSOR_0].senSel)
+  rawPacket_t packet;
+  uint8_t record[TRACE_MAX_RECORD];
+  gestureEvent_t events[GESTURE_MAX_EVENTS];
+  uint8_t emptyColumns = 0;   // selected sensors without data since the last printed column
+  uint8_t reported = 0;       // sensors with a column in <line>, a bit per sensorId
+
+  trackLoopPeriod();
+  TextFormat_clear(&line);
+
+  // Fetch and format touch data for display for every sensor, one column per sensor.
+  // Packets of a deselected sensor are still drained so they don't go stale in its ring.
+  for(i = 0; i < HW_sensorCount(); i++)
   {
-    Pinnacle_getTouchData(&senData[SENSOR_0].touchData, SENSOR_0);
-    printData += "SENS_0 ";
-    toStringTouchData(senData[SENSOR_0].touchData, &printData);
-    digitalWrite(LED0_PIN, LOW);
-  }
-  else
-  {
-    digitalWrite(LED0_PIN, HIGH);
+    if(getPacket(&packet, i) && senData[i].senSel)
+    {
+      if(traceEnabled)
+      {
+        Serial.write(record, Trace_encode(&packet, record));
+        continue;
+      }
+      Pinnacle_decodePacket(&packet, &senData[i].touchData);
+      senData[i].capturedAt = packet.timestamp;
+      if(filterEnabled && packet.mode == ABSOLUTE)
+      {
+        MotionFilter_apply(&filters[i], &filterConfig, &senData[i].touchData.absolute, packet.timestamp);
+      }
+      if(telemetryEnabled)
+      {
+        if(packet.mode == ABSOLUTE) Telemetry_addAbsolute(&telemetry, &senData[i].touchData.absolute, i, packet.timestamp);
+        else Telemetry_addRelative(&telemetry, &senData[i].touchData.relative, i, packet.timestamp);
+        continue;
+      }
+      if(gesturesEnabled && packet.mode == ABSOLUTE)
+      {
+        printGestures(events, Gesture_update(&gestures[i], &gestureConfig, &senData[i].touchData.absolute, packet.timestamp, events), i);
+        continue;
+      }
+      TextFormat_appendRepeat(&line, '\t', emptyColumns * 5);
+      emptyColumns = 0;
+      if(line.length != 0) TextFormat_appendChar(&line, '\t');
+      TextFormat_appendString(&line, "SENS_");
+      TextFormat_appendUnsigned(&line, i);
+      TextFormat_appendChar(&line, ' ');
+      toStringTouchData(&senData[i].touchData, &line);
+      reported |= 1 << i;
+      if(i < sizeof(ledPins)) digitalWrite(ledPins[i], LOW);
+    }
+    else
+    {
+      if(senData[i].senSel) emptyColumns++;
+      if(i < sizeof(ledPins)) digitalWrite(ledPins[i], HIGH);
+      if(gesturesEnabled) printGestures(events, Gesture_poll(&gestures[i], &gestureConfig, micros(), events), i);
+    }
   }
 
-  if(Pinnacle_available(SENSOR_1) && senData[SENSOR_1].senSel)
-  {
-    Pinnacle_getTouchData(&senData[SENSOR_1].touchData, SENSOR_1);
-    printData += (senData[SENSOR_1].senSel && printData.length() == 0) ? "\t\t\t\t\tSENS_1 " :
-      (senData[SENSOR_0].senSel) ? "\tSENS_1 " :
-      "SENS_1 ";
-    toStringTouchData(senData[SENSOR_1].touchData, &printData);
-    digitalWrite(LED1_PIN, LOW);
-  }
-  else
-  {
-    digitalWrite(LED1_PIN, HIGH);
-  }
+  if(telemetryEnabled) Telemetry_service(&telemetry, micros());
+  if(jobCommand != 0) serviceJob();     // one step at a time, so the other sensors keep being read
 
   // If the there is touch data to display, push it to the serial monitor
-  if (printData.length() != 0)
+  if (line.length != 0)
   {
     // append button data to display string (4 = Button 1, 2 = Button 3, 1 = Button 2)
-    printData.concat(String((senData[SENSOR_0].touchData.mode == ABSOLUTE) ? senData[SENSOR_0].touchData.absolute.buttons : senData[SENSOR_0].touchData.relative.buttons));
-    Serial.println(printData);
+    TextFormat_appendUnsigned(&line, (senData[SENSOR_0].touchData.mode == ABSOLUTE) ? senData[SENSOR_0].touchData.absolute.buttons : senData[SENSOR_0].touchData.relative.buttons);
+    INSTRUMENT_START(written);
+    Serial.println(line.data);
+#ifdef PINNACLE_INSTRUMENT
+    recordReport(reported, TIMER_cycles() - written);
+#endif
   }
 
   if(Serial.available())
   {
     rxByte = Serial.read();
-    if (rxByte != 'l') sensorId = getSensorSelect();  // Select sensor of action
+    if (rxByte != 'l' && rxByte != 't' && rxByte != 'b' && rxByte != 'j' && rxByte != 'i' && rxByte != 'x' && rxByte != 'o' && rxByte != 'n') sensorId = getSensorSelect();  // Select sensor of action
 
     if (sensorId == 0xFF)
     {
       Serial.println("ERROR: Invalid sensor...");
     }
+    else if (jobCommand != 0 && isSensorCommand(rxByte))
+    {
+      Serial.println("ERROR: Busy with the previous command...");
+    }
     else
     {
 
@@ -130,11 +241,16 @@ void loop()
           Serial.println("Set to absolute-mode...");
           Serial.println("X\tY\tZ\tButtons");
           break;
+        case 'b':
+          Telemetry_flush(&telemetry);
+          telemetryEnabled = !telemetryEnabled;
+          traceEnabled = false;
+          Serial.println(telemetryEnabled ? "Telemetry started..." : "Telemetry stopped...");
+          break;
         case 'c':
           Serial.println("Forcing a calibration...");
-          Pinnacle_forceCalibration(sensorId);
-          Pinnacle_enableFeed(true, sensorId);      // Reenable feed after calibration
-          Serial.println("Calibration complete...");
+          Pinnacle_startCalibration(&job, sensorId);
+          jobCommand = rxByte;
           break;
         case 'd':
           Pinnacle_enableFeed(false, sensorId);
@@ -146,29 +262,48 @@ void loop()
           break;
         case 'f':
           Pinnacle_enableCurved(&senData[sensorId].touchData, true, sensorId);
-          Pinnacle_forceCalibration(sensorId);      // Adjust comp matrix after changing ADC data
-          Pinnacle_enableFeed(true, sensorId);      // Reenable feed after calibration
-          Serial.println("Curved Mode enabled...");
+          Pinnacle_startCalibration(&job, sensorId);    // Adjust comp matrix after changing ADC data
+          jobCommand = rxByte;
           break;
         case 'g':
           Pinnacle_enableCurved(&senData[sensorId].touchData, false, sensorId);
-          Pinnacle_forceCalibration(sensorId);      // Adjust comp matrix after changing ADC data
-          Pinnacle_enableFeed(true, sensorId);      // Reenable feed after calibration
-          Serial.println("Curved Mode disabled...");
+          Pinnacle_startCalibration(&job, sensorId);    // Adjust comp matrix after changing ADC data
+          jobCommand = rxByte;
+          break;
+        case 'h':
+          learnHoverMap(sensorId);
+          break;
+        case 'i':
+          printInstrumentStats();
+          break;
+        case 'j':
+          printLoopStats();
+          resetLoopStats();
           break;
         case 'm':
           Serial.println("Reading comp-matrix...");
-          Pinnacle_getCompMatrix(compData, sensorId);
-          Pinnacle_enableFeed(true, sensorId);      // Reenable feed after fetching
-          Serial.println("Comp-matrix values:");
-          for(i = 0; i < 46; i++)
-          {
-            Serial.println(compData[i], DEC);
-          }
+          Pinnacle_startEraRead(&job, COMP_MATRIX_ADDRESS, compBytes, COMP_MATRIX_SIZE, sensorId);
+          jobCommand = rxByte;
           break;
         case 'l':
           printInstructions();
           break;
+        case 'n':
+          filterEnabled = !filterEnabled;
+          for(i = 0; i < PINNACLE_MAX_SENSORS; i++)
+          {
+            MotionFilter_init(&filters[i]);
+          }
+          Serial.println(filterEnabled ? "Motion filter on..." : "Motion filter off...");
+          break;
+        case 'o':
+          polarEnabled = !polarEnabled;
+          Serial.println(polarEnabled ? "Polar output on..." : "Polar output off...");
+          if(polarEnabled) Serial.println("Angle\tRadius\tZ\tButtons");
+          break;
+        case 'p':
+          copyTuning(sensorId);
+          break;
         case 'r':
           Pinnacle_setToRelative(&senData[sensorId].touchData, sensorId);
           Serial.println("Set to relative-mode...");
@@ -176,7 +311,23 @@ void loop()
           break;
         case 's':
           senData[sensorId].senSel = !senData[sensorId].senSel;
-          Serial.println(Sensor_toString(sensorId));
+          TextFormat_clear(&line);
+          Sensor_toString(sensorId, &line);
+          Serial.println(line.data);
+          break;
+        case 't':
+          Telemetry_flush(&telemetry);
+          telemetryEnabled = false;
+          traceEnabled = !traceEnabled;
+          Serial.println(traceEnabled ? "Trace started..." : "Trace stopped...");
+          break;
+        case 'x':
+          gesturesEnabled = !gesturesEnabled;
+          for(i = 0; i < PINNACLE_MAX_SENSORS; i++)
+          {
+            Gesture_init(&gestures[i]);
+          }
+          Serial.println(gesturesEnabled ? "Gestures started..." : "Gestures stopped...");
           break;
         default:
           Serial.println("ERROR: Invalid command...");
@@ -187,54 +338,275 @@ void loop()
 }
 
 
-/* toStringTouchData(touchData_t, String*)*/
-// Appends touch data to string passed in by reference
-void toStringTouchData(touchData_t touchData, String * str)
+// True for the commands that talk to a sensor. None of them may run while a job is in progress: they
+// would move the ERA address, the feed or the mode under the job, or block its steps (learnHoverMap()).
+// The others only change what the panel prints.
+bool isSensorCommand(uint8_t command)
 {
-  if(touchData.mode == ABSOLUTE)
+  return command != 0 && strchr("acdefghmpr", command) != NULL;
+}
+
+// Takes the next packet of <sensorId>, from its capture ring or, for a polled pad, from the pad itself
+bool getPacket(rawPacket_t * packet, uint8_t sensorId)
+{
+  if(senData[sensorId].captured) return Pinnacle_getCaptured(packet, 1, sensorId) != 0;
+  return Pinnacle_pollPacket(packet, sensorId);
+}
+
+/* toStringTouchData(const touchData_t*, textFormat_t*)*/
+// Appends touch data to the text passed in by reference
+void toStringTouchData(const touchData_t * touchData, textFormat_t * text)
+{
+  polarData_t polarData;
+
+  if(touchData->mode == ABSOLUTE && polarEnabled)
   {
-    str->concat(touchData.absolute.xValue);
-    str->concat('\t');
-    str->concat(touchData.absolute.yValue);
-    str->concat('\t');
-    str->concat(touchData.absolute.zValue);
+    Polar_apply(&polar, &touchData->absolute, &polarData);
+    TextFormat_appendUnsigned(text, (((uint32_t)polarData.angle * 360 + 0x8000) >> 16) % 360);
+    TextFormat_appendChar(text, '\t');
+    TextFormat_appendUnsigned(text, polarData.radius);
+    TextFormat_appendChar(text, '\t');
+    TextFormat_appendUnsigned(text, polarData.zValue);
+    TextFormat_appendString(text, (touchData->overlayMode == 0) ? "\t" :
+        (polarData.hovering) ? " - h\t" :
+        " - v\t");
+  }
+  else if(touchData->mode == ABSOLUTE)
+  {
+    TextFormat_appendUnsigned(text, touchData->absolute.xValue);
+    TextFormat_appendChar(text, '\t');
+    TextFormat_appendUnsigned(text, touchData->absolute.yValue);
+    TextFormat_appendChar(text, '\t');
+    TextFormat_appendUnsigned(text, touchData->absolute.zValue);
 
     // If in curved overlay mode, print the hovering status.
-    (touchData.overlayMode == 0) ? str->concat('\t') :
-        (touchData.absolute.hovering) ? str->concat(" - h\t") :
-        str->concat(" - v\t");
+    TextFormat_appendString(text, (touchData->overlayMode == 0) ? "\t" :
+        (touchData->absolute.hovering) ? " - h\t" :
+        " - v\t");
   }
   else
   {
-    str->concat(touchData.relative.xDelta);
-    str->concat('\t');
-    str->concat(touchData.relative.yDelta);
-    str->concat('\t');
-    str->concat(touchData.relative.wheelCount);
-    str->concat('\t');
+    TextFormat_appendSigned(text, touchData->relative.xDelta);
+    TextFormat_appendChar(text, '\t');
+    TextFormat_appendSigned(text, touchData->relative.yDelta);
+    TextFormat_appendChar(text, '\t');
+    TextFormat_appendSigned(text, touchData->relative.wheelCount);
+    TextFormat_appendChar(text, '\t');
   }
 }
 
+/* printGestures(const gestureEvent_t*, uint8_t, uint8_t) */
+// Prints the <count> gesture events of <sensorId>, one line each, e.g. "SENS_0 tap 1 x2" (a double-tap
+// in sector 1), "SENS_0 swipe 2" (left) or "SENS_0 rotate -3" (three steps counter-clockwise)
+void printGestures(const gestureEvent_t * events, uint8_t count, uint8_t sensorId)
+{
+  char storage[32];
+  textFormat_t text;    // not <line>, that may hold other sensors' columns
+  uint8_t i;
+
+  TextFormat_init(&text, storage, sizeof(storage));
+
+  for(i = 0; i < count; i++)
+  {
+    TextFormat_clear(&text);
+    TextFormat_appendString(&text, "SENS_");
+    TextFormat_appendUnsigned(&text, sensorId);
+    TextFormat_appendChar(&text, ' ');
+    TextFormat_appendString(&text, Gesture_typeName(events[i].type));
+    TextFormat_appendChar(&text, ' ');
+    if(events[i].type == GESTURE_ROTATE)
+    {
+      TextFormat_appendSigned(&text, events[i].steps);
+    }
+    else
+    {
+      TextFormat_appendUnsigned(&text, events[i].region);
+    }
+    if(events[i].type == GESTURE_TAP)
+    {
+      TextFormat_appendString(&text, " x");
+      TextFormat_appendUnsigned(&text, events[i].taps);
+    }
+    Serial.println(text.data);
+  }
+}
+
+/* learnHoverMap(uint8_t) */
+// Learns the hover thresholds from a sweep of <sensorId> in absolute mode: for HOVER_LEARN_MS, hold a
+// finger just above the overlay (not touching) and move it over the whole sensor. The new map is used
+// by every sensor and saved to EEPROM. Other sensors' packets are dropped during the sweep.
+void learnHoverMap(uint8_t sensorId)
+{
+  hoverLearn_t learn;
+  hoverMap_t map = *Pinnacle_getHoverMap();   // nodes the sweep misses keep their current threshold
+  touchData_t touchData = senData[sensorId].touchData;
+  rawPacket_t packet;
+  uint8_t blob[HOVER_MAP_BLOB_SIZE];
+  uint32_t started;
+  uint16_t i;
+  uint8_t learned;
+
+  if(touchData.mode != ABSOLUTE)
+  {
+    Serial.println("ERROR: Hover map needs absolute mode...");
+    return;
+  }
+
+  Serial.println("Hover over the whole sensor without touching it...");
+  HoverMap_beginLearning(&learn);
+  started = millis();
+  while(millis() - started < HOVER_LEARN_MS)
+  {
+    if(getPacket(&packet, sensorId) && Pinnacle_decodePacket(&packet, &touchData) == ABSOLUTE)
+    {
+      HoverMap_learn(&learn, &touchData.absolute);
+    }
+  }
+
+  learned = HoverMap_finishLearning(&learn, &map);
+  Pinnacle_setHoverMap(&map);
+
+  HoverMap_save(&map, blob);
+  for(i = 0; i < HOVER_MAP_BLOB_SIZE; i++)
+  {
+    EEPROM.update(HOVER_MAP_EEPROM_ADDR + i, blob[i]);
+  }
+
+  Serial.print("Hover map learned and saved, nodes updated: ");
+  Serial.print(learned);
+  Serial.print(" of ");
+  Serial.println(HOVER_MAP_ROWS * HOVER_MAP_COLS);
+}
+
+/* loadHoverMap() */
+// Replaces the default hover map with the one saved by learnHoverMap(), if EEPROM holds a valid one
+void loadHoverMap()
+{
+  hoverMap_t map;
+  uint8_t blob[HOVER_MAP_BLOB_SIZE];
+  uint16_t i;
+
+  for(i = 0; i < HOVER_MAP_BLOB_SIZE; i++)
+  {
+    blob[i] = EEPROM.read(HOVER_MAP_EEPROM_ADDR + i);
+  }
+
+  if(HoverMap_load(&map, blob))
+  {
+    Pinnacle_setHoverMap(&map);
+    Serial.println("Hover map loaded from EEPROM...");
+  }
+}
+
+/* serviceJob() */
+// Advances the calibration or comp-matrix read started by the c, f, g or m command and reports its
+// result once it has ended. A sensor that stops responding ends it with an error instead of a hang.
+void serviceJob()
+{
+  int16_t compData[COMP_MATRIX_SIZE / 2];
+  uint8_t i;
+
+  if(jobCommand == 'p')
+  {
+    if(Profile_serviceApply(&profileApply) == PINNACLE_BUSY) return;
+
+    Serial.println((profileApply.status == PINNACLE_DONE) ? "Tuning copied..." :
+      "ERROR: A sensor stopped responding...");
+    jobCommand = 0;
+    return;
+  }
+
+  if(Pinnacle_serviceJob(&job) == PINNACLE_BUSY) return;
+
+  Pinnacle_enableFeed(true, job.sensorId);      // Reenable feed after calibration or fetching
+  if(job.status == PINNACLE_TIMEOUT)
+  {
+    TextFormat_clear(&line);
+    TextFormat_appendString(&line, "ERROR: Sensor ");
+    TextFormat_appendUnsigned(&line, job.sensorId);
+    TextFormat_appendString(&line, " stopped responding...");
+    Serial.println(line.data);
+  }
+  else if(jobCommand == 'm')
+  {
+    Pinnacle_decodeCompMatrix(compBytes, compData);
+    Serial.println("Comp-matrix values:");
+    for(i = 0; i < COMP_MATRIX_SIZE / 2; i++)
+    {
+      Serial.println(compData[i], DEC);
+    }
+  }
+  else
+  {
+    Serial.println((jobCommand == 'c') ? "Calibration complete..." :
+      (jobCommand == 'f') ? "Curved Mode enabled..." : "Curved Mode disabled...");
+  }
+  jobCommand = 0;
+}
+
+/* copyTuning(uint8_t) */
+// Captures the registers and ADC/edge tuning of <sensorId> and starts applying them to every sensor,
+// in parallel; serviceJob() reports when they are done
+void copyTuning(uint8_t sensorId)
+{
+  uint8_t sensorIds[PINNACLE_MAX_SENSORS];
+  uint8_t i;
+
+  if(!Profile_capture(&profile, tuningAddresses, sizeof(tuningAddresses) / sizeof(tuningAddresses[0]), true, sensorId))
+  {
+    Serial.println("ERROR: Sensor stopped responding...");
+    return;
+  }
+
+  for(i = 0; i < HW_sensorCount(); i++)
+  {
+    sensorIds[i] = i;
+  }
+  Serial.println("Copying tuning...");
+  Profile_startApply(&profileApply, &profile, sensorIds, HW_sensorCount());
+  jobCommand = 'p';
+}
+
+/* writeTelemetry(const uint8_t*, uint16_t) */
+// Sends one telemetry frame in a single write
+void writeTelemetry(const uint8_t * frame, uint16_t length)
+{
+  Serial.write(frame, length);
+}
+
 /* cyclePower() */
-// This function cycles power for both Pinnacle devices
+// This function cycles power for every Pinnacle device
 void cyclePower()
 {
-  Pinnacle_cyclePower(SENSOR_0);
-  Pinnacle_cyclePower(SENSOR_1);
+  uint8_t i;
+
+  for(i = 0; i < HW_sensorCount(); i++)
+  {
+    Pinnacle_cyclePower(i);
+  }
 }
 
 void printInstructions()
 {
   Serial.println("Commands:");
   Serial.println("a - set to absolute mode");
+  Serial.println("b - start/stop binary telemetry");
   Serial.println("c - force sensor to recalibrate");
   Serial.println("d - disable the feed");
   Serial.println("e - enable the feed");
   Serial.println("f - enable curved overlay");
   Serial.println("g - disable curved overlay");
+  Serial.println("h - learn the curved-overlay hover map (10 s sweep)");
+  Serial.println("i - print and reset latency statistics (PINNACLE_INSTRUMENT builds)");
+  Serial.println("j - print and reset loop-period statistics");
   Serial.println("m - get comp-matrix data");
+  Serial.println("n - start/stop smoothing absolute data (motion filter)");
+  Serial.println("o - switch absolute output between X/Y and angle/radius");
+  Serial.println("p - copy the sensor's tuning to every sensor, and recalibrate them");
   Serial.println("r - set to relative mode");
   Serial.println("s - toggle enable/disable sensor");
+  Serial.println("t - start/stop the binary packet trace");
+  Serial.println("x - start/stop printing gestures (absolute mode)");
   Serial.println("l - list these commands again\n");
 }
 
@@ -244,27 +616,146 @@ uint8_t getSensorSelect()
   uint8_t val = 0xFF;
   uint8_t returnVal = 0xFF;
 
-  Serial.println("Select sensor (0 or 1): ");
+  Serial.print("Select sensor (0 to ");
+  Serial.print(HW_sensorCount() - 1);
+  Serial.println("): ");
 
   // wait until a selection has been entered.
   while (Serial.available() <= 0);
   val = Serial.read();
 
-  returnVal = (val == '0') ? 0x00 :
-    (val == '1') ? 0x01 :
+  returnVal = (val >= '0' && val < '0' + HW_sensorCount()) ? (val - '0') :
     0xFF;                             // Fail State
 
   return returnVal;
 }
 
 // Function to generate sensor enable status string.
-String Sensor_toString(uint8_t sensorId)
+void Sensor_toString(uint8_t sensorId, textFormat_t * text)
+{
+  TextFormat_appendString(text, "Sensor ");
+  TextFormat_appendUnsigned(text, sensorId);
+  TextFormat_appendString(text, " - ");
+  TextFormat_appendString(text, (senData[sensorId].senSel) ? "Enabled" : "Disabled");
+}
+
+/* trackLoopPeriod() */
+// Adds the time since the previous call to the loop-period statistics
+void trackLoopPeriod()
+{
+  uint32_t now = micros();
+  uint32_t period = now - loopStats.lastStart;
+  uint8_t bucket = 0;
+
+  loopStats.lastStart = now;
+  if(loopStats.count++ == 0) return;    // the first call only marks the start
+
+  loopStats.total += period;
+  if(period < loopStats.minPeriod) loopStats.minPeriod = period;
+  if(period > loopStats.maxPeriod) loopStats.maxPeriod = period;
+
+  while((period >>= 1) != 0 && bucket < LOOP_BUCKETS - 1) bucket++;
+  loopStats.buckets[bucket]++;
+}
+
+void resetLoopStats()
+{
+  memset(&loopStats, 0, sizeof(loopStats));
+  loopStats.minPeriod = 0xFFFFFFFF;
+  loopStats.lastStart = micros();
+}
+
+/* printLoopStats() */
+// Prints the minimum, average and maximum loop period and the non-empty histogram buckets
+void printLoopStats()
+{
+  uint8_t i;
+
+  if(loopStats.count < 2)
+  {
+    Serial.println("No loop periods measured...");
+    return;
+  }
+
+  TextFormat_clear(&line);
+  TextFormat_appendString(&line, "Loop period us: min ");
+  TextFormat_appendUnsigned(&line, loopStats.minPeriod);
+  TextFormat_appendString(&line, " avg ");
+  TextFormat_appendUnsigned(&line, loopStats.total / (loopStats.count - 1));
+  TextFormat_appendString(&line, " max ");
+  TextFormat_appendUnsigned(&line, loopStats.maxPeriod);
+  Serial.println(line.data);
+
+  for(i = 0; i < LOOP_BUCKETS; i++)
+  {
+    if(loopStats.buckets[i] == 0) continue;
+    TextFormat_clear(&line);
+    TextFormat_appendString(&line, "  >= ");
+    TextFormat_appendUnsigned(&line, 1UL << i);
+    TextFormat_appendString(&line, " us\t");
+    TextFormat_appendUnsigned(&line, loopStats.buckets[i]);
+    Serial.println(line.data);
+  }
+}
+
+/* printInstrumentStats() */
+// Prints the latency histograms of every stage and sensor that recorded anything, then resets them
+void printInstrumentStats()
+{
+#ifdef PINNACLE_INSTRUMENT
+  instrumentStats_t stats;
+  uint8_t stage, sensorId;
+
+  TextFormat_clear(&line);
+  TextFormat_appendString(&line, "Latency in cycles (");
+  TextFormat_appendUnsigned(&line, TIMER_cyclesPerMicro());
+  TextFormat_appendString(&line, " per us): stage, sensor, count, min, p50, p99, max");
+  Serial.println(line.data);
+
+  for(stage = 0; stage < INSTRUMENT_STAGES; stage++)
+  {
+    for(sensorId = 0; sensorId < INSTRUMENT_MAX_SENSORS; sensorId++)
+    {
+      Instrument_getStats(stage, sensorId, &stats);
+      if(stats.count == 0) continue;
+
+      TextFormat_clear(&line);
+      TextFormat_appendString(&line, Instrument_stageName(stage));
+      TextFormat_appendString(&line, "\tSENS_");
+      TextFormat_appendUnsigned(&line, sensorId);
+      TextFormat_appendChar(&line, '\t');
+      TextFormat_appendUnsigned(&line, stats.count);
+      TextFormat_appendChar(&line, '\t');
+      TextFormat_appendUnsigned(&line, stats.min);
+      TextFormat_appendChar(&line, '\t');
+      TextFormat_appendUnsigned(&line, stats.p50);
+      TextFormat_appendChar(&line, '\t');
+      TextFormat_appendUnsigned(&line, stats.p99);
+      TextFormat_appendChar(&line, '\t');
+      TextFormat_appendUnsigned(&line, stats.max);
+      Serial.println(line.data);
+    }
+  }
+  Instrument_reset();
+#else
+  Serial.println("Latency statistics need PINNACLE_INSTRUMENT (see Instrument.h)...");
+#endif
+}
+
+#ifdef PINNACLE_INSTRUMENT
+/* recordReport(uint8_t, uint32_t) */
+// Records the write of a text line, <writeCycles> long, for every sensor in <reported>, and the time
+// from each of their packets being captured to the line being written
+void recordReport(uint8_t reported, uint32_t writeCycles)
 {
-  String dispStr = "";
-  dispStr = "Sensor ";
-  dispStr += String(sensorId);
-  dispStr += " - ";
-  dispStr += (senData[sensorId].senSel) ? "Enabled" : "Disabled";
+  uint32_t now = TIMER_micros();
+  uint8_t i;
 
-  return dispStr;
+  for(i = 0; i < HW_sensorCount(); i++)
+  {
+    if(!(reported & (1 << i))) continue;
+    Instrument_record(INSTRUMENT_OUTPUT, i, writeCycles);
+    Instrument_record(INSTRUMENT_DR_TO_REPORT, i, (now - senData[i].capturedAt) * TIMER_cyclesPerMicro());
+  }
 }
+#endif
@@ -0,0 +1,85 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "Pointer.h"
+
+#define PENDING_LIMIT ((int32_t)POINTER_MAX_PENDING << POINTER_GAIN_SHIFT)
+
+// Half a pixel per count for fine work, 1:1 at a moderate pace, up to 3 pixels per count for flicks
+static const pointerPoint_t DEFAULT_CURVE[] =
+{
+  { 2,  POINTER_GAIN_ONE / 2 },
+  { 6,  POINTER_GAIN_ONE },
+  { 20, 2 * POINTER_GAIN_ONE },
+  { 40, 3 * POINTER_GAIN_ONE },
+};
+
+int32_t Pointer_clip(int32_t);
+
+void Pointer_init(pointer_t * pointer)
+{
+  Pointer_setCurve(pointer, DEFAULT_CURVE, sizeof(DEFAULT_CURVE) / sizeof(DEFAULT_CURVE[0]));
+  pointer->xPending = 0;
+  pointer->yPending = 0;
+}
+
+// Fills the gain table of <pointer> from the <count> points of <curve>, in order of speed: the gain of
+// the first point below it, straight lines between the points and the gain of the last above it
+void Pointer_setCurve(pointer_t * pointer, const pointerPoint_t * curve, uint8_t count)
+{
+  uint8_t speed;
+  uint8_t i = 0;
+  int32_t span;
+
+  for(speed = 0; speed < POINTER_CURVE_SIZE; speed++)
+  {
+    while(i < count && curve[i].speed <= speed) i++;
+
+    if(i == 0) pointer->gain[speed] = count ? curve[0].gain : POINTER_GAIN_ONE;
+    else if(i == count) pointer->gain[speed] = curve[count - 1].gain;
+    else
+    {
+      span = curve[i].speed - curve[i - 1].speed;
+      pointer->gain[speed] = (uint16_t)(curve[i - 1].gain +
+        ((int32_t)curve[i].gain - curve[i - 1].gain) * (speed - curve[i - 1].speed) / span);
+    }
+  }
+}
+
+// Adds the deltas of one packet, scaled by the gain for their speed, to the motion waiting for a report
+void Pointer_add(pointer_t * pointer, int16_t xDelta, int16_t yDelta)
+{
+  uint16_t xSize = (xDelta < 0) ? -xDelta : xDelta;
+  uint16_t ySize = (yDelta < 0) ? -yDelta : yDelta;
+  uint16_t speed = (xSize > ySize) ? xSize + ySize / 2 : ySize + xSize / 2;
+  uint16_t gain = pointer->gain[(speed < POINTER_CURVE_SIZE) ? speed : POINTER_CURVE_SIZE - 1];
+
+  pointer->xPending = Pointer_clip(pointer->xPending + (int32_t)xDelta * gain);
+  pointer->yPending = Pointer_clip(pointer->yPending + (int32_t)yDelta * gain);
+}
+
+// Takes the next report, up to POINTER_MAX_REPORT per axis, out of the motion waiting. Returns false
+// (and leaves <*xMove> and <*yMove> alone) while there isn't a whole pixel to report. Fractions stay
+// for later, rounded towards zero so that a finger resting still doesn't make the pointer jitter.
+bool Pointer_nextReport(pointer_t * pointer, int8_t * xMove, int8_t * yMove)
+{
+  int32_t x = pointer->xPending / POINTER_GAIN_ONE;
+  int32_t y = pointer->yPending / POINTER_GAIN_ONE;
+
+  if(x == 0 && y == 0) return false;
+
+  if(x > POINTER_MAX_REPORT) x = POINTER_MAX_REPORT;
+  if(x < -POINTER_MAX_REPORT) x = -POINTER_MAX_REPORT;
+  if(y > POINTER_MAX_REPORT) y = POINTER_MAX_REPORT;
+  if(y < -POINTER_MAX_REPORT) y = -POINTER_MAX_REPORT;
+
+  pointer->xPending -= x * POINTER_GAIN_ONE;
+  pointer->yPending -= y * POINTER_GAIN_ONE;
+  *xMove = (int8_t)x;
+  *yMove = (int8_t)y;
+  return true;
+}
+
+int32_t Pointer_clip(int32_t pending)
+{
+  return (pending > PENDING_LIMIT) ? PENDING_LIMIT : (pending < -PENDING_LIMIT) ? -PENDING_LIMIT : pending;
+}
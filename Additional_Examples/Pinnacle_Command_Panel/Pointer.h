@@ -0,0 +1,53 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Relative motion for a USB mouse.
+// Passing Pinnacle's relative deltas straight to Mouse.move() loses both ends: a slow finger moves
+// less than a pixel per packet and a gain below 1 rounds it away, while a fast one moves more than
+// the 127 an HID report holds and is clipped (or, cast to int8_t, wraps around).
+// Pointer_add() takes the deltas of one packet, scales them by an acceleration curve and keeps the
+// fractions of a pixel for the next packet, so nothing is lost at any gain. Pointer_nextReport() then
+// hands the motion out in reports of at most POINTER_MAX_REPORT per axis; call it once per USB frame
+// (or per loop()) and a large move is spread over the following reports instead of being clipped.
+// The curve is a table of POINTER_CURVE_SIZE gains, one per speed in counts per packet, built once by
+// Pointer_setCurve() from a few points; no floating point.
+
+#ifndef POINTER_H
+#define POINTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POINTER_GAIN_SHIFT  8       // gains are in 1/256 pixel per count
+#define POINTER_GAIN_ONE    (1 << POINTER_GAIN_SHIFT)
+#define POINTER_CURVE_SIZE  64      // speeds 0 to 63 counts per packet, faster uses the last gain
+#define POINTER_MAX_REPORT  127
+#define POINTER_MAX_PENDING 1024    // pixels per axis waiting for a report, more is dropped
+
+// A point of the acceleration curve
+typedef struct _pointerPoint
+{
+  uint8_t speed;          // counts per packet (the larger delta plus half the smaller)
+  uint16_t gain;          // 1/256 pixel per count
+} pointerPoint_t;
+
+typedef struct _pointer
+{
+  uint16_t gain[POINTER_CURVE_SIZE];
+  int32_t xPending;       // in 1/256 pixel: what the reports haven't carried yet
+  int32_t yPending;
+} pointer_t;
+
+void Pointer_init(pointer_t *);
+void Pointer_setCurve(pointer_t *, const pointerPoint_t *, uint8_t);
+void Pointer_add(pointer_t *, int16_t, int16_t);
+bool Pointer_nextReport(pointer_t *, int8_t *, int8_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POINTER_H
@@ -0,0 +1,112 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "Polar.h"
+
+#define RATIO_SHIFT   14    // smaller / larger offset, 0 to 1 << RATIO_SHIFT
+#define INDEX_SHIFT   (RATIO_SHIFT - 5)
+#define SECANT_SHIFT  14
+#define FRACTION_BITS 4     // of the round offsets handed to Polar_angle()
+
+// atan(i / 32) for i = 0 to 32, in quarters of a binary angle
+static const uint16_t ATAN_TABLE[33] =
+{
+  0, 1303, 2604, 3900, 5188, 6467, 7733, 8985, 10221, 11439, 12637, 13814, 14968, 16100, 17206, 18288,
+  19344, 20374, 21378, 22355, 23306, 24230, 25128, 26001, 26848, 27670, 28467, 29241, 29991, 30718, 31423, 32106,
+  32768
+};
+
+// sqrt(1 + (i / 32)^2) for i = 0 to 32, times 1 << SECANT_SHIFT
+static const uint16_t SECANT_TABLE[33] =
+{
+  16384, 16392, 16416, 16456, 16512, 16583, 16670, 16771, 16888, 17020, 17165, 17325, 17498, 17684, 17883, 18095,
+  18318, 18552, 18798, 19054, 19321, 19597, 19882, 20177, 20480, 20791, 21110, 21437, 21771, 22111, 22458, 22811,
+  23170
+};
+
+uint32_t Polar_factor(uint16_t, uint16_t);
+uint32_t Polar_scale(int32_t, uint32_t);
+
+// Sets up <polar> to center the reachable window and scale both axes so that its edges are <radius>
+// (up to POLAR_MAX_RADIUS) from the center
+void Polar_init(polar_t * polar, uint16_t radius)
+{
+  if(radius > POLAR_MAX_RADIUS) radius = POLAR_MAX_RADIUS;
+
+  polar->xCenter = (PINNACLE_X_LOWER + PINNACLE_X_UPPER + 1) / 2;
+  polar->yCenter = (PINNACLE_Y_LOWER + PINNACLE_Y_UPPER + 1) / 2;
+  polar->xFactor = Polar_factor(radius, PINNACLE_X_RANGE);
+  polar->yFactor = Polar_factor(radius, PINNACLE_Y_RANGE);
+}
+
+// Converts one packet. Z-idle packets (x = y = 0) come out at angle 0 and radius 0.
+void Polar_apply(const polar_t * polar, const absData_t * data, polarData_t * output)
+{
+  int32_t xOffset = 0;
+  int32_t yOffset = 0;
+  uint32_t radius = 0;
+
+  if(data->xValue != 0 || data->yValue != 0)
+  {
+    xOffset = (int32_t)Polar_scale((int32_t)data->xValue - polar->xCenter, polar->xFactor);
+    yOffset = (int32_t)Polar_scale((int32_t)data->yValue - polar->yCenter, polar->yFactor);
+    if(data->xValue < polar->xCenter) xOffset = -xOffset;
+    if(data->yValue < polar->yCenter) yOffset = -yOffset;
+  }
+
+  output->angle = Polar_angle(xOffset, yOffset, &radius);
+  radius = (radius + (1 << (FRACTION_BITS - 1))) >> FRACTION_BITS;
+  output->radius = (radius > 0xFFFF) ? 0xFFFF : (uint16_t)radius;
+  output->zValue = data->zValue;
+  output->buttons = data->buttons;
+  output->hovering = data->hovering;
+}
+
+// Binary angle of (<xOffset>, <yOffset>) from the +X axis. Also writes the distance from the origin to
+// <*magnitude>, unless it is NULL. Offsets are limited to +/-131071.
+uint16_t Polar_angle(int32_t xOffset, int32_t yOffset, uint32_t * magnitude)
+{
+  uint32_t xSize = (xOffset < 0) ? -xOffset : xOffset;
+  uint32_t ySize = (yOffset < 0) ? -yOffset : yOffset;
+  uint32_t larger, ratio, index, fraction, angle;
+
+  larger = (xSize >= ySize) ? xSize : ySize;
+  if(larger == 0)
+  {
+    if(magnitude) *magnitude = 0;
+    return 0;
+  }
+
+  ratio = (((xSize >= ySize) ? ySize : xSize) << RATIO_SHIFT) / larger;
+  index = ratio >> INDEX_SHIFT;
+  fraction = ratio & ((1 << INDEX_SHIFT) - 1);
+
+  angle = ATAN_TABLE[index];
+  if(magnitude) *magnitude = larger * SECANT_TABLE[index];
+  if(fraction)
+  {
+    angle += ((ATAN_TABLE[index + 1] - ATAN_TABLE[index]) * fraction) >> INDEX_SHIFT;
+    if(magnitude) *magnitude += larger * (((SECANT_TABLE[index + 1] - SECANT_TABLE[index]) * fraction) >> INDEX_SHIFT);
+  }
+  if(magnitude) *magnitude = (*magnitude + (1 << (SECANT_SHIFT - 1))) >> SECANT_SHIFT;
+  angle = (angle + 2) >> 2;
+
+  if(ySize > xSize) angle = 0x4000 - angle;
+  if(xOffset < 0) angle = 0x8000 - angle;
+  if(yOffset < 0) angle = 0x10000 - angle;
+
+  return (uint16_t)angle;
+}
+
+// Factor that scales half of <range> to <radius>, rounded
+uint32_t Polar_factor(uint16_t radius, uint16_t range)
+{
+  return (uint32_t)((((uint64_t)radius << (POLAR_SHIFT + 1)) + range / 2) / range);
+}
+
+// |<offset>| times <factor>, rounded to 1 / 2^FRACTION_BITS
+uint32_t Polar_scale(int32_t offset, uint32_t factor)
+{
+  uint32_t size = (offset < 0) ? -offset : offset;
+
+  return (size * factor + (1 << (POLAR_SHIFT - FRACTION_BITS - 1))) >> (POLAR_SHIFT - FRACTION_BITS);
+}
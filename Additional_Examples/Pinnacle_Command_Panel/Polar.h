@@ -0,0 +1,55 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Polar output for circular pads (TM0XX0XX).
+// A round sensor still reports X/Y counts over a rectangle, and the reachable window is wider in X
+// counts than in Y, so a circle drawn on the pad comes out as an ellipse. Polar_init() works out a
+// multiply-shift factor per axis that makes the window round, with <radius> at its edge; Polar_apply()
+// then gives each packet an angle and a distance from the center, ready for dials and circular
+// scrolling.
+// Angle and distance come out of one division: the arctangent of the smaller offset over the larger
+// and sqrt(1 + ratio^2) are interpolated from two 33-entry tables, then folded into the right octant.
+// No floating point: against atan2() and hypot() the angle is within 0.05 degree (from 1/16 of <radius>
+// out, nearer the center a count of X or Y is worth degrees anyway) and the radius within one count,
+// see the host bench.
+// Angles are binary: 65536 to a full turn, 0 along +X, growing clockwise (Y grows downwards on the pad).
+
+#ifndef POLAR_H
+#define POLAR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Pinnacle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POLAR_SHIFT       16
+#define POLAR_MAX_RADIUS  4096    // largest <radius> Polar_init() takes
+
+typedef struct _polar
+{
+  uint32_t xFactor;     // round offset = (offset * xFactor) >> POLAR_SHIFT
+  uint32_t yFactor;
+  uint16_t xCenter;
+  uint16_t yCenter;
+} polar_t;
+
+typedef struct _polarData
+{
+  uint16_t angle;
+  uint16_t radius;      // <radius> of Polar_init() at the edge of the reachable window
+  uint8_t zValue;
+  uint8_t buttons;
+  bool hovering;
+} polarData_t;
+
+void Polar_init(polar_t *, uint16_t);
+void Polar_apply(const polar_t *, const absData_t *, polarData_t *);
+uint16_t Polar_angle(int32_t, int32_t, uint32_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POLAR_H
@@ -0,0 +1,155 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "Profile.h"
+
+#define PROFILE_READ_COUNT  (SLEEP_TIMER - SYS_CONFIG_1 + 1)
+
+void Profile_startStep(profileApply_t *, uint8_t);
+void Profile_finish(profileApply_t *, uint8_t);
+
+// Captures the configuration of <sensorId> into <profile>: its configuration registers, and the
+// <eraCount> extended registers listed in <eraAddresses>. Returns false on an ERA timeout.
+bool Profile_capture(pinnacleProfile_t * profile, const uint16_t * eraAddresses, uint8_t eraCount, bool calibrate, uint8_t sensorId)
+{
+  uint8_t registers[PROFILE_READ_COUNT];
+  uint8_t i, address;
+
+  RAP_readBytes(SYS_CONFIG_1, registers, PROFILE_READ_COUNT, sensorId);
+
+  profile->rapCount = 0;
+  for(i = 0; i < PROFILE_READ_COUNT; i++)
+  {
+    address = SYS_CONFIG_1 + i;
+    if(address == FEED_CONFIG_1) continue;
+
+    if(address == SYS_CONFIG_1) registers[i] &= ~0x03;    // leave out the reset and shutdown commands
+    if(address == CAL_CONFIG_1) registers[i] &= ~0x01;    // and the calibrate command
+
+    profile->rap[profile->rapCount].address = address;
+    profile->rap[profile->rapCount].value = registers[i];
+    profile->rapCount++;
+  }
+
+  if(eraCount > PROFILE_MAX_ERA) eraCount = PROFILE_MAX_ERA;
+  for(i = 0; i < eraCount; i++)
+  {
+    profile->era[i].address = eraAddresses[i];
+    if(!ERA_readCached(eraAddresses[i], &profile->era[i].value, sensorId)) return false;
+  }
+  profile->eraCount = eraCount;
+  profile->calibrate = calibrate;
+
+  return true;
+}
+
+// Starts applying <profile> to the <count> sensors in <sensorIds>: writes their registers right away
+// and starts the first ERA write (or the calibration) of each. The feed is off until a sensor is
+// done, then put back the way it was found.
+// NOTE: <profile> and <apply> must stay valid until Profile_serviceApply() stops returning PINNACLE_BUSY
+void Profile_startApply(profileApply_t * apply, const pinnacleProfile_t * profile, const uint8_t * sensorIds, uint8_t count)
+{
+  uint8_t pairs[2 * PROFILE_MAX_RAP];
+  uint8_t i, j, sensorId;
+
+  if(count > PINNACLE_MAX_SENSORS) count = PINNACLE_MAX_SENSORS;
+
+  apply->profile = profile;
+  apply->count = count;
+  apply->feedEnabled = 0;
+  apply->finished = 0;
+  apply->timedOut = 0;
+  apply->status = PINNACLE_BUSY;
+
+  for(j = 0; j < profile->rapCount; j++)
+  {
+    pairs[2 * j] = (uint8_t)profile->rap[j].address;
+    pairs[2 * j + 1] = profile->rap[j].value;
+  }
+
+  for(i = 0; i < count; i++)
+  {
+    sensorId = sensorIds[i];
+    apply->sensorIds[i] = sensorId;
+
+    if(RAP_readCached(FEED_CONFIG_1, sensorId) & 0x01) apply->feedEnabled |= 1 << i;
+    Pinnacle_enableFeed(false, sensorId);
+    RAP_writePairs(pairs, profile->rapCount, sensorId);
+
+    apply->step[i] = 0;
+    Profile_startStep(apply, i);
+  }
+
+  Profile_serviceApply(apply);
+}
+
+// Advances every sensor of <apply> by one step. Returns PINNACLE_BUSY until all of them are done, then
+// PINNACLE_DONE, or PINNACLE_TIMEOUT if any of them stopped responding (the others are still set up).
+uint8_t Profile_serviceApply(profileApply_t * apply)
+{
+  uint8_t i;
+
+  if(apply->status != PINNACLE_BUSY) return apply->status;
+
+  for(i = 0; i < apply->count; i++)
+  {
+    if(apply->finished & (1 << i)) continue;
+    if(Pinnacle_serviceJob(&apply->jobs[i]) == PINNACLE_BUSY) continue;
+
+    if(apply->jobs[i].status == PINNACLE_TIMEOUT)
+    {
+      apply->timedOut |= 1 << i;
+      Profile_finish(apply, i);
+    }
+    else
+    {
+      apply->step[i]++;
+      Profile_startStep(apply, i);
+    }
+  }
+
+  if(apply->finished != (uint8_t)((1 << apply->count) - 1)) return PINNACLE_BUSY;
+
+  apply->status = apply->timedOut ? PINNACLE_TIMEOUT : PINNACLE_DONE;
+  return apply->status;
+}
+
+// Applies <profile> to the <count> sensors in <sensorIds> and waits until they are all done.
+// Returns PINNACLE_DONE, or PINNACLE_TIMEOUT if any sensor stopped responding.
+uint8_t Profile_apply(const pinnacleProfile_t * profile, const uint8_t * sensorIds, uint8_t count)
+{
+  profileApply_t apply;
+
+  Profile_startApply(&apply, profile, sensorIds, count);
+  while(Profile_serviceApply(&apply) == PINNACLE_BUSY);
+
+  return apply.status;
+}
+
+// Starts the job for the step entry <index> of <apply> has reached, or finishes it
+void Profile_startStep(profileApply_t * apply, uint8_t index)
+{
+  const pinnacleProfile_t * profile = apply->profile;
+  uint8_t step = apply->step[index];
+  uint8_t sensorId = apply->sensorIds[index];
+
+  if(step < profile->eraCount)
+  {
+    // a write job only reads its data
+    Pinnacle_startEraWrite(&apply->jobs[index], profile->era[step].address, (uint8_t *)&profile->era[step].value, 1, sensorId);
+  }
+  else if(step == profile->eraCount && profile->calibrate)
+  {
+    Pinnacle_startCalibration(&apply->jobs[index], sensorId);
+  }
+  else
+  {
+    Profile_finish(apply, index);
+  }
+}
+
+// Marks entry <index> of <apply> as done with and puts its feed back
+void Profile_finish(profileApply_t * apply, uint8_t index)
+{
+  apply->finished |= 1 << index;
+  if(apply->feedEnabled & (1 << index)) Pinnacle_enableFeed(true, apply->sensorIds[index]);
+}
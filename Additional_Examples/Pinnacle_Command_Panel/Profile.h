@@ -0,0 +1,67 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Configuration profiles.
+// A profile lists the configuration registers and extended (ERA) registers that make up a sensor's
+// tuning, e.g. the ADC attenuation and edge sensitivity of a curved overlay, and whether the sensor
+// is calibrated afterwards. It can be written out as a constant, or captured from a sensor that has
+// been tuned by hand with Profile_capture().
+// Profile_startApply() sets up any number of sensors at once: each sensor's registers go out in a
+// single CS cycle, and its ERA writes and calibration run as jobs (see Pinnacle_serviceJob()) that
+// Profile_serviceApply() interleaves across the sensors, so their busy times overlap instead of
+// adding up.
+// NOTE: FeedConfig1 (feed enable and packet mode) isn't part of a profile, it stays with
+// Pinnacle_enableFeed() and Pinnacle_setToAbsolute()/Pinnacle_setToRelative()
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Pinnacle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PROFILE_MAX_RAP   10    // SysConfig1 and FeedConfig2 through SleepTimer
+#define PROFILE_MAX_ERA   8
+
+typedef struct _profileEntry
+{
+  uint16_t address;
+  uint8_t value;
+} profileEntry_t;
+
+typedef struct _pinnacleProfile
+{
+  profileEntry_t rap[PROFILE_MAX_RAP];
+  profileEntry_t era[PROFILE_MAX_ERA];
+  uint8_t rapCount;
+  uint8_t eraCount;
+  bool calibrate;           // calibrate once the registers are written
+} pinnacleProfile_t;
+
+// A profile being applied, see Profile_serviceApply()
+typedef struct _profileApply
+{
+  const pinnacleProfile_t * profile;
+  pinnacleJob_t jobs[PINNACLE_MAX_SENSORS];
+  uint8_t sensorIds[PINNACLE_MAX_SENSORS];
+  uint8_t step[PINNACLE_MAX_SENSORS];   // ERA entry being written, then eraCount while calibrating
+  uint8_t count;
+  uint8_t feedEnabled;      // sensors whose feed was on, a bit per entry of <sensorIds>
+  uint8_t finished;         // sensors done with, a bit per entry of <sensorIds>
+  uint8_t timedOut;         // sensors that stopped responding, a bit per entry of <sensorIds>
+  uint8_t status;           // PINNACLE_BUSY, then PINNACLE_TIMEOUT if any sensor timed out, else PINNACLE_DONE
+} profileApply_t;
+
+bool Profile_capture(pinnacleProfile_t *, const uint16_t *, uint8_t, bool, uint8_t);
+void Profile_startApply(profileApply_t *, const pinnacleProfile_t *, const uint8_t *, uint8_t);
+uint8_t Profile_serviceApply(profileApply_t *);
+uint8_t Profile_apply(const pinnacleProfile_t *, const uint8_t *, uint8_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PROFILE_H
@@ -0,0 +1,166 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "SensorManager.h"
+#include "Hardware.h"
+
+typedef struct _managedSensor
+{
+  uint8_t sensorId;
+  touchData_t * touchData;  // where this sensor's packets are decoded to
+  bool ready;               // DR has been seen and the packet not read yet
+  uint32_t readyAt;         // TIMER_micros() when DR was first seen
+  sensorStats_t stats;
+} managedSensor_t;
+
+managedSensor_t _managed[HW_MAX_SENSORS];
+uint8_t _managedCount = 0;
+uint8_t _nextSlot = 0;      // round-robin position: the slot that gets first pick on the next service
+
+managedSensor_t * SensorManager_find(uint8_t);
+
+void SensorManager_init()
+{
+  _managedCount = 0;
+  _nextSlot = 0;
+}
+
+// Adds <sensorId> (already set up with Pinnacle_init()) to the polling rotation. Its packets are
+// decoded into <*touchData>. Returns false if the rotation is full.
+bool SensorManager_add(uint8_t sensorId, touchData_t * touchData)
+{
+  managedSensor_t * sensor;
+
+  if(_managedCount >= HW_MAX_SENSORS) return false;
+
+  sensor = &_managed[_managedCount++];
+  sensor->sensorId = sensorId;
+  sensor->touchData = touchData;
+  sensor->ready = false;
+  sensor->stats.packets = 0;
+  sensor->stats.latencyTotal = 0;
+  sensor->stats.latencyMax = 0;
+  sensor->stats.since = TIMER_micros();
+
+  return true;
+}
+
+uint8_t SensorManager_count()
+{
+  return _managedCount;
+}
+
+// Checks DR on every sensor in the rotation and reads one packet from the first ready sensor at or
+// after the round-robin position. Returns the sensorId that was read, or SENSOR_NONE.
+// NOTE: all sensors are checked (not just up to the one read) so each one's latency is timed from
+// the first service that saw its DR, even while it waits for its turn.
+uint8_t SensorManager_service()
+{
+  uint32_t now = TIMER_micros();
+  uint32_t latency;
+  managedSensor_t * sensor;
+  managedSensor_t * chosen = 0;
+  uint8_t chosenSlot = 0;
+  uint8_t slot = _nextSlot;
+  uint8_t i;
+
+  for(i = 0; i < _managedCount; i++, slot++)
+  {
+    if(slot >= _managedCount) slot = 0;
+    sensor = &_managed[slot];
+
+    if(!sensor->ready)
+    {
+      if(!Pinnacle_available(sensor->sensorId)) continue;
+      sensor->ready = true;
+      sensor->readyAt = now;
+    }
+
+    if(chosen == 0)
+    {
+      chosen = sensor;
+      chosenSlot = slot;
+    }
+  }
+
+  if(chosen == 0) return SENSOR_NONE;
+
+  Pinnacle_getTouchData(chosen->touchData, chosen->sensorId);
+  chosen->ready = false;
+
+  latency = TIMER_micros() - chosen->readyAt;
+  chosen->stats.packets++;
+  chosen->stats.latencyTotal += latency;
+  if(latency > chosen->stats.latencyMax) chosen->stats.latencyMax = latency;
+
+  _nextSlot = chosenSlot + 1;
+  if(_nextSlot >= _managedCount) _nextSlot = 0;
+
+  return chosen->sensorId;
+}
+
+// Copies the stats of <sensorId> into <*stats> (all zero if it isn't in the rotation)
+void SensorManager_getStats(uint8_t sensorId, sensorStats_t * stats)
+{
+  managedSensor_t * sensor = SensorManager_find(sensorId);
+
+  if(sensor != 0)
+  {
+    *stats = sensor->stats;
+  }
+  else
+  {
+    stats->packets = 0;
+    stats->latencyTotal = 0;
+    stats->latencyMax = 0;
+    stats->since = TIMER_micros();
+  }
+}
+
+// Packets read from <sensorId> per second since the stats were reset
+uint32_t SensorManager_packetsPerSecond(uint8_t sensorId)
+{
+  managedSensor_t * sensor = SensorManager_find(sensorId);
+  uint32_t elapsed;
+
+  if(sensor == 0) return 0;
+
+  elapsed = TIMER_micros() - sensor->stats.since;
+  if(elapsed == 0) return 0;
+
+  return (uint32_t)(((uint64_t)sensor->stats.packets * 1000000) / elapsed);
+}
+
+// Average DR-seen-to-read latency of <sensorId> in microseconds
+uint32_t SensorManager_averageLatency(uint8_t sensorId)
+{
+  managedSensor_t * sensor = SensorManager_find(sensorId);
+
+  if(sensor == 0 || sensor->stats.packets == 0) return 0;
+
+  return sensor->stats.latencyTotal / sensor->stats.packets;
+}
+
+void SensorManager_resetStats()
+{
+  uint32_t now = TIMER_micros();
+  uint8_t i;
+
+  for(i = 0; i < _managedCount; i++)
+  {
+    _managed[i].stats.packets = 0;
+    _managed[i].stats.latencyTotal = 0;
+    _managed[i].stats.latencyMax = 0;
+    _managed[i].stats.since = now;
+  }
+}
+
+managedSensor_t * SensorManager_find(uint8_t sensorId)
+{
+  uint8_t i;
+
+  for(i = 0; i < _managedCount; i++)
+  {
+    if(_managed[i].sensorId == sensorId) return &_managed[i];
+  }
+  return 0;
+}
@@ -0,0 +1,42 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Polls any number of Pinnacle sensors (registered with HW_init() / HW_addSensor()) from one loop.
+// Each call to SensorManager_service() reads one packet from the next sensor, in round-robin order,
+// whose DR is asserted, so a busy pad can't starve the others. Per-sensor packet counts and the
+// latency from DR first being seen to the packet being read are kept for tuning.
+
+#ifndef SENSORMANAGER_H
+#define SENSORMANAGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Pinnacle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SENSOR_NONE 0xFF
+
+typedef struct _sensorStats
+{
+  uint32_t packets;         // packets read since the stats were reset
+  uint32_t latencyTotal;    // sum of the DR-seen-to-read latencies (microseconds)
+  uint32_t latencyMax;      // worst latency (microseconds)
+  uint32_t since;           // TIMER_micros() when the stats were reset
+} sensorStats_t;
+
+void SensorManager_init(void);
+bool SensorManager_add(uint8_t, touchData_t *);
+uint8_t SensorManager_count(void);
+uint8_t SensorManager_service(void);
+void SensorManager_getStats(uint8_t, sensorStats_t *);
+uint32_t SensorManager_packetsPerSecond(uint8_t);
+uint32_t SensorManager_averageLatency(uint8_t);
+void SensorManager_resetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SENSORMANAGER_H
@@ -0,0 +1,93 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <stddef.h>
+#include "SpiQueue.h"
+#include "Hardware.h"
+
+#define QUEUE_MASK (SPI_QUEUE_DEPTH - 1)
+
+spiXfer_t * _queue[SPI_QUEUE_DEPTH];
+uint8_t _queueHead = 0;     // next free entry
+uint8_t _queueTail = 0;     // oldest waiting entry
+spiXfer_t * _inFlight = NULL;
+
+void SpiQueue_startNext(void);
+
+void SpiQueue_init(void)
+{
+  _queueHead = 0;
+  _queueTail = 0;
+  _inFlight = NULL;
+}
+
+// Adds <xfer> to the end of the queue and starts it if the bus is free.
+// Returns false if the queue is full (the descriptor is not queued).
+bool SpiQueue_submit(spiXfer_t * xfer)
+{
+  if((uint8_t)(_queueHead - _queueTail) >= SPI_QUEUE_DEPTH) return false;
+
+  _queue[_queueHead & QUEUE_MASK] = xfer;
+  _queueHead++;
+
+  SpiQueue_startNext();
+  return true;
+}
+
+// Starts the oldest queued transfer if the bus is free
+void SpiQueue_startNext(void)
+{
+  if(_inFlight != NULL || _queueTail == _queueHead) return;
+
+  _inFlight = _queue[_queueTail & QUEUE_MASK];
+  _queueTail++;
+
+  SPI_beginTransaction(_inFlight->sensorId);
+  HW_assertCS(_inFlight->sensorId);
+  SPI_startTransferBytes(_inFlight->buffer, _inFlight->length);
+}
+
+// Retires the transfer in flight if the hardware has finished it, starts the next queued transfer
+// and only then runs the finished transfer's callback, so the callback's work overlaps with the
+// next transfer. Never waits for the bus.
+void SpiQueue_service(void)
+{
+  spiXfer_t * done;
+
+  if(_inFlight != NULL)
+  {
+    if(SPI_transferBusy()) return;
+
+    done = _inFlight;
+    _inFlight = NULL;
+    HW_deAssertCS(done->sensorId);
+    SPI_endTransaction(done->sensorId);
+
+    SpiQueue_startNext();
+    if(done->callback != NULL) done->callback(done);   // may submit more transfers
+  }
+  else
+  {
+    SpiQueue_startNext();
+  }
+}
+
+// Services the queue until every submitted transfer (including any submitted by callbacks) is done
+void SpiQueue_flush(void)
+{
+  while(!SpiQueue_idle())
+  {
+    SpiQueue_service();
+  }
+}
+
+// True when nothing is in flight or waiting
+bool SpiQueue_idle(void)
+{
+  return (_inFlight == NULL) && (_queueTail == _queueHead);
+}
+
+// Number of transfers that can be submitted before the queue is full
+uint8_t SpiQueue_room(void)
+{
+  return SPI_QUEUE_DEPTH - (uint8_t)(_queueHead - _queueTail);
+}
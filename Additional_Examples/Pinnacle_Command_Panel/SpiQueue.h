@@ -0,0 +1,47 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Non-blocking SPI transaction queue.
+// Each transfer is described by an spiXfer_t (which sensor's CS to assert, and the bytes to clock
+// out, replaced in place by the bytes clocked in). Descriptors are owned by the caller and must stay
+// valid until their callback runs. SpiQueue_service() is called from the main loop: it retires the
+// transfer in flight once the hardware reports it finished and starts the next one, so the CPU is
+// free while bytes are on the bus.
+// NOTE: the queue is not interrupt-safe; submit and service from the main loop only, and don't mix
+// it with the blocking RAP_ functions while transfers are outstanding.
+
+#ifndef SPIQUEUE_H
+#define SPIQUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPI_QUEUE_DEPTH   8     // must be a power of two
+#define SPI_XFER_MAX      12    // command byte, two filler bytes and a full 6-byte packet fit
+
+typedef struct _spiXfer spiXfer_t;
+
+struct _spiXfer
+{
+  uint8_t sensorId;                 // CS to assert for this transfer
+  uint8_t length;                   // number of bytes in <buffer> to clock
+  uint8_t buffer[SPI_XFER_MAX];     // bytes to send; holds the received bytes on completion
+  void (*callback)(spiXfer_t *);    // called from SpiQueue_service() when the transfer is done
+  void * context;                   // for the callback's use
+};
+
+void SpiQueue_init(void);
+bool SpiQueue_submit(spiXfer_t *);
+void SpiQueue_service(void);
+void SpiQueue_flush(void);
+bool SpiQueue_idle(void);
+uint8_t SpiQueue_room(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SPIQUEUE_H
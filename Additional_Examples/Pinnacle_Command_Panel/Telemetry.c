@@ -0,0 +1,174 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "Telemetry.h"
+
+void Telemetry_add(telemetry_t *, uint8_t, uint16_t, uint16_t, uint8_t, uint8_t, uint32_t);
+void Telemetry_drop(telemetryReader_t *);
+
+// Sets up <telemetry> to send frames of <batch> records (1..TELEMETRY_MAX_BATCH) through <write>.
+// A partial frame is sent by Telemetry_service() once its oldest record is <maxAge> microseconds old.
+void Telemetry_init(telemetry_t * telemetry, uint8_t batch, uint32_t maxAge, void (*write)(const uint8_t *, uint16_t))
+{
+  telemetry->batch = (batch == 0) ? 1 : (batch > TELEMETRY_MAX_BATCH) ? TELEMETRY_MAX_BATCH : batch;
+  telemetry->count = 0;
+  telemetry->sequence = 0;
+  telemetry->maxAge = maxAge;
+  telemetry->firstAt = 0;
+  telemetry->write = write;
+}
+
+// Adds an absolute report of <sensorId>; <now> is the current time in microseconds
+void Telemetry_addAbsolute(telemetry_t * telemetry, const absData_t * data, uint8_t sensorId, uint32_t now)
+{
+  uint8_t info = (sensorId & TELEMETRY_SENSOR) | (data->hovering ? TELEMETRY_HOVERING : 0);
+
+  Telemetry_add(telemetry, info, data->xValue, data->yValue, (uint8_t)data->zValue, data->buttons, now);
+}
+
+// Adds a relative report of <sensorId>; <now> is the current time in microseconds
+void Telemetry_addRelative(telemetry_t * telemetry, const relData_t * data, uint8_t sensorId, uint32_t now)
+{
+  uint8_t info = (sensorId & TELEMETRY_SENSOR) | TELEMETRY_RELATIVE;
+
+  Telemetry_add(telemetry, info, (uint16_t)(int16_t)data->xDelta, (uint16_t)(int16_t)data->yDelta,
+    (uint8_t)data->wheelCount, data->buttons, now);
+}
+
+// Sends the partial frame if its oldest record has waited too long; call it once per loop
+void Telemetry_service(telemetry_t * telemetry, uint32_t now)
+{
+  if(telemetry->count != 0 && telemetry->maxAge != 0 && now - telemetry->firstAt >= telemetry->maxAge)
+  {
+    Telemetry_flush(telemetry);
+  }
+}
+
+// Sends the records collected so far, if any
+void Telemetry_flush(telemetry_t * telemetry)
+{
+  uint16_t length = TELEMETRY_HEADER_SIZE + telemetry->count * TELEMETRY_RECORD_SIZE;
+  uint16_t crc;
+
+  if(telemetry->count == 0) return;
+
+  telemetry->frame[0] = TELEMETRY_SYNC_0;
+  telemetry->frame[1] = TELEMETRY_SYNC_1;
+  telemetry->frame[2] = telemetry->count;
+  telemetry->frame[3] = (uint8_t)(telemetry->sequence - telemetry->count);
+  telemetry->frame[4] = (uint8_t)((uint16_t)(telemetry->sequence - telemetry->count) >> 8);
+
+  crc = Telemetry_crc(&telemetry->frame[2], length - 2);
+  telemetry->frame[length] = (uint8_t)(crc >> 8);
+  telemetry->frame[length + 1] = (uint8_t)crc;
+
+  telemetry->write(telemetry->frame, length + TELEMETRY_CRC_SIZE);
+  telemetry->count = 0;
+}
+
+// CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF)
+uint16_t Telemetry_crc(const uint8_t * data, uint16_t count)
+{
+  uint16_t crc = 0xFFFF;
+  uint8_t bit;
+
+  while(count--)
+  {
+    crc ^= (uint16_t)*data++ << 8;
+    for(bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+void Telemetry_initReader(telemetryReader_t * reader)
+{
+  memset(reader, 0, sizeof(telemetryReader_t));
+}
+
+// Feeds one byte of the stream to <reader>. Returns true when the byte completes a valid frame; its
+// records are then in <reader->records>.
+bool Telemetry_feed(telemetryReader_t * reader, uint8_t data)
+{
+  uint16_t length, crc, i;
+  uint8_t * record;
+
+  reader->buffer[reader->length++] = data;
+
+  for(;;)
+  {
+    if(reader->length == 0) return false;
+    if(reader->buffer[0] != TELEMETRY_SYNC_0 || (reader->length > 1 && reader->buffer[1] != TELEMETRY_SYNC_1))
+    {
+      Telemetry_drop(reader);
+      continue;
+    }
+    if(reader->length < 3) return false;
+
+    if(reader->buffer[2] == 0 || reader->buffer[2] > TELEMETRY_MAX_BATCH)
+    {
+      Telemetry_drop(reader);
+      continue;
+    }
+    length = TELEMETRY_FRAME_SIZE(reader->buffer[2]);
+    if(reader->length < length) return false;
+
+    crc = Telemetry_crc(&reader->buffer[2], length - 2 - TELEMETRY_CRC_SIZE);
+    if(reader->buffer[length - 2] != (uint8_t)(crc >> 8) || reader->buffer[length - 1] != (uint8_t)crc)
+    {
+      reader->crcErrors++;
+      Telemetry_drop(reader);
+      continue;
+    }
+    break;
+  }
+
+  reader->count = reader->buffer[2];
+  for(i = 0; i < reader->count; i++)
+  {
+    record = &reader->buffer[TELEMETRY_HEADER_SIZE + i * TELEMETRY_RECORD_SIZE];
+    reader->records[i].sequence = (uint16_t)(reader->buffer[3] | (reader->buffer[4] << 8)) + i;
+    reader->records[i].info = record[0];
+    reader->records[i].xValue = (int16_t)(record[1] | (record[2] << 8));
+    reader->records[i].yValue = (int16_t)(record[3] | (record[4] << 8));
+    reader->records[i].zValue = (int8_t)record[5];
+    reader->records[i].buttons = record[6];
+  }
+
+  if(reader->synced) reader->lost += (uint16_t)(reader->records[0].sequence - reader->expected);
+  reader->expected = reader->records[0].sequence + reader->count;
+  reader->synced = true;
+  reader->frames++;
+  reader->length = 0;
+  return true;
+}
+
+// Appends one record, sending the frame when it is full
+void Telemetry_add(telemetry_t * telemetry, uint8_t info, uint16_t xValue, uint16_t yValue, uint8_t zValue,
+  uint8_t buttons, uint32_t now)
+{
+  uint8_t * record = &telemetry->frame[TELEMETRY_HEADER_SIZE + telemetry->count * TELEMETRY_RECORD_SIZE];
+
+  if(telemetry->count == 0) telemetry->firstAt = now;
+
+  record[0] = info;
+  record[1] = (uint8_t)xValue;
+  record[2] = (uint8_t)(xValue >> 8);
+  record[3] = (uint8_t)yValue;
+  record[4] = (uint8_t)(yValue >> 8);
+  record[5] = zValue;
+  record[6] = buttons;
+
+  telemetry->count++;
+  telemetry->sequence++;
+  if(telemetry->count >= telemetry->batch) Telemetry_flush(telemetry);
+}
+
+// Discards the first buffered byte
+void Telemetry_drop(telemetryReader_t * reader)
+{
+  memmove(reader->buffer, reader->buffer + 1, --reader->length);
+  reader->skipped++;
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Binary telemetry: decoded reports, batched into checksummed frames.
+// Sending a report as text costs 20-30 bytes and several print calls; a telemetry record is 7 bytes,
+// and <batch> records go out in one write. With the default batch of 8 a frame is 63 bytes, so it
+// fits one USB full-speed packet.
+//   frame:   TELEMETRY_SYNC_0, TELEMETRY_SYNC_1, record count, sequence number of the first record
+//            (16 bits, little-endian), the records, CRC-16/CCITT (big-endian) over count..last record
+//   record:  info (sensorId in the low 3 bits, TELEMETRY_ flags), X, Y (16 bits each, little-endian;
+//            xDelta/yDelta for relative reports), Z (wheelCount for relative reports), buttons
+// Records are numbered consecutively, so the receiver can count the reports it missed.
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Pinnacle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_SYNC_0      0xC5
+#define TELEMETRY_SYNC_1      0x3A
+#define TELEMETRY_HEADER_SIZE 5
+#define TELEMETRY_RECORD_SIZE 7
+#define TELEMETRY_CRC_SIZE    2
+#define TELEMETRY_MAX_BATCH   16
+#define TELEMETRY_FRAME_SIZE(records) (TELEMETRY_HEADER_SIZE + (records) * TELEMETRY_RECORD_SIZE + TELEMETRY_CRC_SIZE)
+
+// Record info flags
+#define TELEMETRY_SENSOR      0x07
+#define TELEMETRY_HOVERING    0x08
+#define TELEMETRY_RELATIVE    0x10
+
+typedef struct _telemetryRecord
+{
+  uint16_t sequence;
+  uint8_t info;
+  int16_t xValue;     // absolute reports hold unsigned values; read them as uint16_t
+  int16_t yValue;
+  int8_t zValue;
+  uint8_t buttons;
+} telemetryRecord_t;
+
+// Sender side: collects records and hands each full frame to <write> in one call
+typedef struct _telemetry
+{
+  uint8_t frame[TELEMETRY_FRAME_SIZE(TELEMETRY_MAX_BATCH)];
+  uint8_t count;          // records in the frame being built
+  uint8_t batch;          // records per frame
+  uint16_t sequence;      // number of the next record
+  uint32_t maxAge;        // microseconds a record may wait for its frame to fill (0 = no limit)
+  uint32_t firstAt;       // when the oldest record of the frame was added
+  void (*write)(const uint8_t *, uint16_t);
+} telemetry_t;
+
+// Receiver side: reassembles frames from a byte stream
+typedef struct _telemetryReader
+{
+  uint8_t buffer[TELEMETRY_FRAME_SIZE(TELEMETRY_MAX_BATCH)];
+  uint8_t length;                                   // bytes of the current frame received so far
+  telemetryRecord_t records[TELEMETRY_MAX_BATCH];   // records of the last complete frame
+  uint8_t count;
+  bool synced;            // a frame has been received, <expected> is valid
+  uint16_t expected;      // sequence number the next record should carry
+  uint32_t frames;
+  uint32_t lost;          // records missing between frames
+  uint32_t crcErrors;     // frame candidates dropped because the CRC didn't match
+  uint32_t skipped;       // bytes dropped while looking for a frame
+} telemetryReader_t;
+
+void Telemetry_init(telemetry_t *, uint8_t, uint32_t, void (*)(const uint8_t *, uint16_t));
+void Telemetry_addAbsolute(telemetry_t *, const absData_t *, uint8_t, uint32_t);
+void Telemetry_addRelative(telemetry_t *, const relData_t *, uint8_t, uint32_t);
+void Telemetry_service(telemetry_t *, uint32_t);
+void Telemetry_flush(telemetry_t *);
+uint16_t Telemetry_crc(const uint8_t *, uint16_t);
+void Telemetry_initReader(telemetryReader_t *);
+bool Telemetry_feed(telemetryReader_t *, uint8_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_H
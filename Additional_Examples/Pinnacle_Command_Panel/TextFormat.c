@@ -0,0 +1,105 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "TextFormat.h"
+
+// "00" through "99"
+static const char DIGIT_PAIRS[201] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+// Uses <storage> (<capacity> bytes, at least 1) as the buffer of <text>
+void TextFormat_init(textFormat_t * text, char * storage, uint16_t capacity)
+{
+  text->data = storage;
+  text->capacity = capacity;
+  TextFormat_clear(text);
+}
+
+void TextFormat_clear(textFormat_t * text)
+{
+  text->length = 0;
+  text->overflow = false;
+  text->data[0] = '\0';
+}
+
+void TextFormat_appendChar(textFormat_t * text, char character)
+{
+  if(text->length + 1 >= text->capacity)
+  {
+    text->overflow = true;
+    return;
+  }
+  text->data[text->length++] = character;
+  text->data[text->length] = '\0';
+}
+
+// Appends <count> copies of <character>
+void TextFormat_appendRepeat(textFormat_t * text, char character, uint16_t count)
+{
+  while(count--)
+  {
+    TextFormat_appendChar(text, character);
+  }
+}
+
+void TextFormat_appendString(textFormat_t * text, const char * string)
+{
+  while(*string != '\0' && text->length + 1 < text->capacity)
+  {
+    text->data[text->length++] = *string++;
+  }
+  text->data[text->length] = '\0';
+  if(*string != '\0') text->overflow = true;
+}
+
+// Appends <value> in decimal
+void TextFormat_appendUnsigned(textFormat_t * text, uint32_t value)
+{
+  char digits[10];
+  uint8_t count = 0;
+  uint8_t pair;
+
+  // fill <digits> from the end, two at a time
+  while(value >= 100)
+  {
+    pair = (uint8_t)(value % 100);
+    value /= 100;
+    digits[9 - count++] = DIGIT_PAIRS[pair * 2 + 1];
+    digits[9 - count++] = DIGIT_PAIRS[pair * 2];
+  }
+  if(value >= 10)
+  {
+    digits[9 - count++] = DIGIT_PAIRS[value * 2 + 1];
+    digits[9 - count++] = DIGIT_PAIRS[value * 2];
+  }
+  else
+  {
+    digits[9 - count++] = (char)('0' + value);
+  }
+
+  if(text->length + count >= text->capacity)
+  {
+    text->overflow = true;
+    return;     // a cut-off number would be misleading, leave it out
+  }
+  for(pair = 10 - count; pair < 10; pair++)
+  {
+    text->data[text->length++] = digits[pair];
+  }
+  text->data[text->length] = '\0';
+}
+
+// Appends <value> in decimal, with a '-' if negative
+void TextFormat_appendSigned(textFormat_t * text, int32_t value)
+{
+  if(value < 0)
+  {
+    TextFormat_appendChar(text, '-');
+    TextFormat_appendUnsigned(text, 0 - (uint32_t)value);
+  }
+  else
+  {
+    TextFormat_appendUnsigned(text, (uint32_t)value);
+  }
+}
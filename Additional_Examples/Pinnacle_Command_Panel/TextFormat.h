@@ -0,0 +1,38 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Fixed-capacity text formatting into a caller-owned buffer.
+// Nothing is allocated: text that doesn't fit is cut off and <overflow> is set, and the buffer is
+// always NUL-terminated so it can be handed straight to Serial.print(). Integers are converted two
+// digits at a time from a lookup table instead of one division per digit.
+
+#ifndef TEXTFORMAT_H
+#define TEXTFORMAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _textFormat
+{
+  char * data;
+  uint16_t capacity;    // size of <data>, including the terminating NUL
+  uint16_t length;
+  bool overflow;        // something was cut off since the last TextFormat_clear()
+} textFormat_t;
+
+void TextFormat_init(textFormat_t *, char *, uint16_t);
+void TextFormat_clear(textFormat_t *);
+void TextFormat_appendChar(textFormat_t *, char);
+void TextFormat_appendRepeat(textFormat_t *, char, uint16_t);
+void TextFormat_appendString(textFormat_t *, const char *);
+void TextFormat_appendUnsigned(textFormat_t *, uint32_t);
+void TextFormat_appendSigned(textFormat_t *, int32_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TEXTFORMAT_H
@@ -0,0 +1,104 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "Trace.h"
+#include "Pinnacle.h"
+
+uint8_t Trace_recordSize(uint8_t);
+void Trace_drop(traceReader_t *);
+
+// Writes <packet> to <record> (TRACE_MAX_RECORD bytes). Returns the record's size.
+uint8_t Trace_encode(const rawPacket_t * packet, uint8_t * record)
+{
+  uint8_t info = (packet->sensorId & TRACE_INFO_SENSOR) | ((packet->mode == ABSOLUTE) ? TRACE_INFO_ABSOLUTE : 0);
+  uint8_t size = Trace_recordSize(info);
+  uint8_t sum = 0;
+  uint8_t i;
+
+  record[0] = TRACE_SYNC;
+  record[1] = info;
+  record[2] = (uint8_t)packet->timestamp;
+  record[3] = (uint8_t)(packet->timestamp >> 8);
+  record[4] = (uint8_t)(packet->timestamp >> 16);
+  record[5] = (uint8_t)(packet->timestamp >> 24);
+  memcpy(&record[6], packet->data, size - 7);
+
+  for(i = 0; i < size - 1; i++)
+  {
+    sum += record[i];
+  }
+  record[size - 1] = (uint8_t)(0 - sum);
+
+  return size;
+}
+
+void Trace_initReader(traceReader_t * reader)
+{
+  reader->count = 0;
+  reader->records = 0;
+  reader->skipped = 0;
+}
+
+// Feeds one byte of the stream to <reader>. Returns true, with the packet in <*packet>, when the byte
+// completes a valid record.
+bool Trace_feed(traceReader_t * reader, uint8_t data, rawPacket_t * packet)
+{
+  uint8_t size, sum, i;
+
+  reader->buffer[reader->count++] = data;
+
+  for(;;)
+  {
+    if(reader->count == 0) return false;
+    if(reader->buffer[0] != TRACE_SYNC)
+    {
+      Trace_drop(reader);
+      continue;
+    }
+    if(reader->count < 2) return false;
+
+    size = Trace_recordSize(reader->buffer[1]);
+    if(size == 0)
+    {
+      Trace_drop(reader);   // not a record after all, look for the next sync byte
+      continue;
+    }
+    if(reader->count < size) return false;
+
+    for(sum = 0, i = 0; i < size; i++)
+    {
+      sum += reader->buffer[i];
+    }
+    if(sum != 0)
+    {
+      Trace_drop(reader);
+      continue;
+    }
+    break;
+  }
+
+  memset(packet, 0, sizeof(rawPacket_t));
+  packet->sensorId = reader->buffer[1] & TRACE_INFO_SENSOR;
+  packet->mode = (reader->buffer[1] & TRACE_INFO_ABSOLUTE) ? ABSOLUTE : RELATIVE;
+  packet->timestamp = reader->buffer[2] | ((uint32_t)reader->buffer[3] << 8) |
+    ((uint32_t)reader->buffer[4] << 16) | ((uint32_t)reader->buffer[5] << 24);
+  memcpy(packet->data, &reader->buffer[6], size - 7);
+
+  reader->count = 0;
+  reader->records++;
+  return true;
+}
+
+// Size of a record with <info> as its second byte, or 0 if <info> is not valid
+uint8_t Trace_recordSize(uint8_t info)
+{
+  if(info & ~(TRACE_INFO_ABSOLUTE | TRACE_INFO_SENSOR)) return 0;
+  return (info & TRACE_INFO_ABSOLUTE) ? TRACE_ABSOLUTE_SIZE : TRACE_RELATIVE_SIZE;
+}
+
+// Discards the first buffered byte
+void Trace_drop(traceReader_t * reader)
+{
+  memmove(reader->buffer, reader->buffer + 1, --reader->count);
+  reader->skipped++;
+}
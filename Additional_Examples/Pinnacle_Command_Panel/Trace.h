@@ -0,0 +1,48 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Binary packet trace.
+// Each captured packet (see PacketRing.h) is written as one self-contained record:
+//   byte 0      TRACE_SYNC
+//   byte 1      info: TRACE_INFO_ABSOLUTE if read in absolute mode, sensorId in the low 3 bits
+//   bytes 2-5   timestamp, TIMER_micros() at capture, little-endian
+//   bytes 6-    PACKET_BYTE_0..5 (absolute) or PACKET_BYTE_0..3 (relative), as read from the chip
+//   last byte   checksum: all bytes of the record add up to 0 (mod 256)
+// Records can be interleaved with text on the same serial port: text is 7-bit ASCII and never holds
+// TRACE_SYNC, and the reader drops anything that doesn't form a valid record.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "PacketRing.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_SYNC            0xA5
+#define TRACE_INFO_ABSOLUTE   0x80
+#define TRACE_INFO_SENSOR     0x07
+#define TRACE_ABSOLUTE_SIZE   13
+#define TRACE_RELATIVE_SIZE   11
+#define TRACE_MAX_RECORD      TRACE_ABSOLUTE_SIZE
+
+// Reassembles records from a byte stream
+typedef struct _traceReader
+{
+  uint8_t buffer[TRACE_MAX_RECORD];
+  uint8_t count;        // bytes of the current record received so far
+  uint32_t records;     // valid records read
+  uint32_t skipped;     // bytes dropped while looking for a valid record
+} traceReader_t;
+
+uint8_t Trace_encode(const rawPacket_t *, uint8_t *);
+void Trace_initReader(traceReader_t *);
+bool Trace_feed(traceReader_t *, uint8_t, rawPacket_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_H
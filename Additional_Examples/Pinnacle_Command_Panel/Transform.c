@@ -0,0 +1,87 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "Transform.h"
+
+#define MAX_SHIFT 24
+
+uint8_t Transform_factor(uint16_t, uint16_t, uint32_t *);
+
+// Sets up <transform> to scale the reachable window to 0..<xResolution> x 0..<yResolution> (the same
+// range ScaleData() produces) and then apply <orientation> (TRANSFORM_ flags).
+// NOTE: with TRANSFORM_SWAP_XY the pad's Y axis is scaled to <xResolution> and its X to <yResolution>
+void Transform_init(transform_t * transform, uint16_t xResolution, uint16_t yResolution, uint8_t orientation)
+{
+  bool swap = (orientation & TRANSFORM_SWAP_XY) != 0;
+
+  transform->xResolution = xResolution;
+  transform->yResolution = yResolution;
+  transform->orientation = orientation;
+
+  transform->xShift = Transform_factor(xResolution, swap ? PINNACLE_Y_RANGE : PINNACLE_X_RANGE, &transform->xFactor);
+  transform->yShift = Transform_factor(yResolution, swap ? PINNACLE_X_RANGE : PINNACLE_Y_RANGE, &transform->yFactor);
+}
+
+// Clips, scales and orients one packet in place. Z-idle packets (x = y = 0) come out at the origin
+// corner, as they do from ScaleData().
+void Transform_apply(const transform_t * transform, absData_t * data)
+{
+  uint32_t xOffset = data->xValue;
+  uint32_t yOffset = data->yValue;
+  uint32_t temp;
+
+  // clip to the reachable window and translate to a (0, 0) reference
+  xOffset = (xOffset < PINNACLE_X_LOWER) ? 0 :
+    (xOffset > PINNACLE_X_UPPER) ? PINNACLE_X_RANGE :
+    xOffset - PINNACLE_X_LOWER;
+  yOffset = (yOffset < PINNACLE_Y_LOWER) ? 0 :
+    (yOffset > PINNACLE_Y_UPPER) ? PINNACLE_Y_RANGE :
+    yOffset - PINNACLE_Y_LOWER;
+
+  if(transform->orientation & TRANSFORM_SWAP_XY)
+  {
+    temp = xOffset;
+    xOffset = yOffset;
+    yOffset = temp;
+  }
+
+  xOffset = (xOffset * transform->xFactor) >> transform->xShift;
+  yOffset = (yOffset * transform->yFactor) >> transform->yShift;
+
+  if(transform->orientation & TRANSFORM_INVERT_X) xOffset = transform->xResolution - xOffset;
+  if(transform->orientation & TRANSFORM_INVERT_Y) yOffset = transform->yResolution - yOffset;
+
+  data->xValue = (uint16_t)xOffset;
+  data->yValue = (uint16_t)yOffset;
+}
+
+// Transforms <count> packets, e.g. everything drained from the capture ring in one pass
+void Transform_applyBatch(const transform_t * transform, absData_t * data, uint16_t count)
+{
+  uint16_t i = 0;
+
+  for(; i < count; i++)
+  {
+    Transform_apply(transform, &data[i]);
+  }
+}
+
+// Finds the largest shift (up to MAX_SHIFT) for which <range> * factor still fits in 32 bits, where
+// factor = ceil(<resolution> * 2^shift / <range>), so every in-window offset can be scaled with one
+// 32-bit multiply. Returns the shift, the factor goes to <*factor>.
+// NOTE: the result is guaranteed to match the division when <range>^2 < 2^shift (resolutions up to
+// about 1024) and does in practice up to 4096 (see the host bench); at larger resolutions a few
+// offsets come out one count high.
+uint8_t Transform_factor(uint16_t resolution, uint16_t range, uint32_t * factor)
+{
+  uint8_t shift = MAX_SHIFT;
+  uint64_t candidate;
+
+  for(;; shift--)
+  {
+    candidate = (((uint64_t)resolution << shift) + range - 1) / range;
+    if(candidate * range <= 0xFFFFFFFFULL || shift == 0) break;
+  }
+
+  *factor = (uint32_t)candidate;
+  return shift;
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Coordinate scaling and orientation for absolute-mode data.
+// Transform_init() works out, once, a multiply-shift factor per axis that maps the "reachable"
+// window (PINNACLE_X_LOWER..PINNACLE_X_UPPER, PINNACLE_Y_LOWER..PINNACLE_Y_UPPER) onto
+// 0..xResolution and 0..yResolution, so scaling a packet costs two multiplies instead of the two
+// 32-bit divisions ScaleData() does. Parts without a hardware divider (Cortex-M0, AVR) gain the most.
+// Rotation and mirroring are applied in software after scaling, so the FeedConfig1 X/Y invert bits
+// can stay clear and the same transform can be reused whatever the chip is set to.
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Pinnacle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Orientation flags, applied in this order: swap axes, then mirror
+#define TRANSFORM_SWAP_XY   0x01
+#define TRANSFORM_INVERT_X  0x02
+#define TRANSFORM_INVERT_Y  0x04
+
+// Clockwise rotations of the pad, in terms of the flags above
+#define TRANSFORM_ROTATE_0    0x00
+#define TRANSFORM_ROTATE_90   (TRANSFORM_SWAP_XY | TRANSFORM_INVERT_X)
+#define TRANSFORM_ROTATE_180  (TRANSFORM_INVERT_X | TRANSFORM_INVERT_Y)
+#define TRANSFORM_ROTATE_270  (TRANSFORM_SWAP_XY | TRANSFORM_INVERT_Y)
+
+typedef struct _transform
+{
+  uint32_t xFactor;     // output X = (source offset * xFactor) >> shift
+  uint32_t yFactor;
+  uint16_t xResolution;
+  uint16_t yResolution;
+  uint8_t xShift;
+  uint8_t yShift;
+  uint8_t orientation;
+} transform_t;
+
+void Transform_init(transform_t *, uint16_t, uint16_t, uint8_t);
+void Transform_apply(const transform_t *, absData_t *);
+void Transform_applyBatch(const transform_t *, absData_t *, uint16_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRANSFORM_H
@@ -0,0 +1,93 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "Transport.h"
+#include "Hardware.h"
+
+bool Transport_spiRead(uint8_t, uint8_t *, uint8_t, uint8_t);
+bool Transport_spiWrite(uint8_t *, uint8_t, uint8_t);
+bool Transport_i2cRead(uint8_t, uint8_t *, uint8_t, uint8_t);
+bool Transport_i2cWrite(uint8_t *, uint8_t, uint8_t);
+
+const pinnacleTransport_t TRANSPORT_SPI = { "SPI", Transport_spiRead, Transport_spiWrite };
+const pinnacleTransport_t TRANSPORT_I2C = { "I2C", Transport_i2cRead, Transport_i2cWrite };
+
+// Transports installed with Transport_set(); 0 = the one the sensor was registered for
+const pinnacleTransport_t * _transport[HW_MAX_SENSORS];
+
+const pinnacleTransport_t * Transport_get(uint8_t sensorId)
+{
+  if(_transport[sensorId]) return _transport[sensorId];
+  return HW_i2cAddress(sensorId) ? &TRANSPORT_I2C : &TRANSPORT_SPI;
+}
+
+// Makes <sensorId> use <transport>, or the transport it was registered for if <transport> is 0
+void Transport_set(uint8_t sensorId, const pinnacleTransport_t * transport)
+{
+  _transport[sensorId] = transport;
+}
+
+// The command and the registers are clocked with a single SPI_transferBytes() call: two filler
+// bytes follow the command, then each filler byte gets another register's contents
+bool Transport_spiRead(uint8_t command, uint8_t * data, uint8_t count, uint8_t sensorId)
+{
+  uint8_t buffer[3 + TRANSPORT_MAX_READ];
+  uint8_t i;
+
+  buffer[0] = command;
+  for(i = 1; i < count + 3; i++)
+  {
+    buffer[i] = 0xFC;
+  }
+
+  SPI_beginTransaction(sensorId);
+
+  HW_assertCS(sensorId);
+  SPI_transferBytes(buffer, count + 3);
+  HW_deAssertCS(sensorId);
+
+  SPI_endTransaction(sensorId);
+
+  for(i = 0; i < count; i++)
+  {
+    data[i] = buffer[i + 3];
+  }
+  return true;
+}
+
+// All pairs go out in one CS cycle
+bool Transport_spiWrite(uint8_t * pairs, uint8_t length, uint8_t sensorId)
+{
+  SPI_beginTransaction(sensorId);
+
+  HW_assertCS(sensorId);
+  SPI_transferBytes(pairs, length);
+  HW_deAssertCS(sensorId);
+
+  SPI_endTransaction(sensorId);
+  return true;
+}
+
+// The registers follow the command after a repeated start, without filler bytes. A command that
+// isn't acknowledged has released the bus, so no read follows it.
+bool Transport_i2cRead(uint8_t command, uint8_t * data, uint8_t count, uint8_t sensorId)
+{
+  uint8_t i2cAddress = HW_i2cAddress(sensorId);
+
+  if(!I2C_write(i2cAddress, &command, 1, false)) return false;
+  return I2C_read(i2cAddress, data, count);
+}
+
+// The pairs go out in as few transfers as I2C_MAX_TRANSFER allows (it is even, so a pair is never split).
+// Stops at the first transfer that fails.
+bool Transport_i2cWrite(uint8_t * pairs, uint8_t length, uint8_t sensorId)
+{
+  uint8_t i2cAddress = HW_i2cAddress(sensorId);
+  uint8_t sent, chunk;
+
+  for(sent = 0; sent < length; sent += chunk)
+  {
+    chunk = (length - sent > I2C_MAX_TRANSFER) ? I2C_MAX_TRANSFER : length - sent;
+    if(!I2C_write(i2cAddress, &pairs[sent], chunk, true)) return false;
+  }
+  return true;
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// RAP transports.
+// A transport moves RAP transactions between the host and a sensor: a read is a command byte
+// followed by <count> registers, a write is a run of (command, data) pairs. Pinnacle.c builds the
+// transactions and hands them to the transport of the sensor, so the burst reads, the register
+// shadow and the batched ERA accesses above this layer work the same on every bus.
+// A sensor registered with HW_addSensor() uses TRANSPORT_SPI, one registered with
+// HW_addI2cSensor() TRANSPORT_I2C. Transport_set() installs any other pinnacleTransport_t, e.g.
+// for a bus Hardware.h doesn't cover.
+// Both calls return false if the transaction failed, e.g. an I2C pad didn't acknowledge; a failed
+// read leaves <data> as it was. SPI has no acknowledge, its transactions always succeed.
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRANSPORT_MAX_READ    32    // registers in the RAP address space
+
+typedef struct _pinnacleTransport
+{
+  const char * name;
+  bool (*read)(uint8_t, uint8_t *, uint8_t, uint8_t);   // command byte, data, count, sensorId
+  bool (*write)(uint8_t *, uint8_t, uint8_t);           // (command, data) pairs, bytes, sensorId
+} pinnacleTransport_t;
+
+extern const pinnacleTransport_t TRANSPORT_SPI;
+extern const pinnacleTransport_t TRANSPORT_I2C;
+
+const pinnacleTransport_t * Transport_get(uint8_t);
+void Transport_set(uint8_t, const pinnacleTransport_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRANSPORT_H
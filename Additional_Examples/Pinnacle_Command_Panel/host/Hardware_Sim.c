@@ -0,0 +1,603 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "Hardware.h"
+#include "Pinnacle.h"
+#include "Hardware_Sim.h"
+
+// STATUS_1 flags
+#define SW_DR   0x04
+#define SW_CC   0x08
+
+// ERA_CONTROL bits
+#define ERA_READ        0x01
+#define ERA_WRITE       0x02
+#define ERA_INC_READ    0x04
+#define ERA_INC_WRITE   0x08
+
+#define NO_SENSOR 0xFF
+
+// RAP decoder phases for the byte stream inside one CS assertion
+typedef enum
+{
+  PHASE_COMMAND,
+  PHASE_READ_FILLER,
+  PHASE_READ_DATA,
+  PHASE_WRITE_DATA,
+} rapPhase_t;
+
+typedef struct _simSensor
+{
+  uint8_t registers[32];
+  uint8_t era[0x10000];
+  uint64_t eraDoneAt;       // ERA_CONTROL reads back non-zero until this time
+  uint64_t calDoneAt;       // CAL_CONFIG_1 bit 0 reads back set until this time
+  uint64_t drReleaseAt;     // DR pin stays asserted until this time after a clear
+  bool eraBusy;
+  bool calBusy;
+  bool stalled;             // ERA and calibration requests never complete, see SIM_stall()
+  bool unplugged;           // doesn't acknowledge its I2C address, see SIM_unplug()
+  uint8_t i2cRegister;      // where the next I2C read starts, set by the last command byte
+} simSensor_t;
+
+static simSensor_t _sensors[SIM_MAX_SENSORS];
+static uint8_t _sensorCount = 0;      // simulated chips
+static uint8_t _registered = 0;       // chips wired up through HW_init() / HW_addSensor()
+static uint8_t _i2cAddress[SIM_MAX_SENSORS];    // 0 for a chip on SPI
+
+static uint64_t _now = 0;
+static uint64_t _asyncDoneAt = 0;   // end of the transfer started by SPI_startTransferBytes()
+static uint32_t _byteNanos = 8000;  // 1 MHz until SPI_init is called
+static uint32_t _i2cBitNanos = 10000;   // 100 kHz until I2C_init is called
+static bool _i2cClaimed = false;        // an I2C_write() kept the bus for a repeated start
+static simCounters_t _counters;
+
+static void (*_drHandler[SIM_MAX_SENSORS])(uint8_t);
+
+static uint8_t _selected = NO_SENSOR;
+static rapPhase_t _phase = PHASE_COMMAND;
+static uint8_t _address = 0;
+static uint8_t _fillerCount = 0;
+
+// Retires any ERA or calibration request whose busy time has elapsed
+static void SIM_update(simSensor_t * sensor)
+{
+  if(sensor->stalled) return;
+
+  if(sensor->eraBusy && _now >= sensor->eraDoneAt)
+  {
+    sensor->eraBusy = false;
+    sensor->registers[ERA_CONTROL] = 0x00;
+    sensor->registers[STATUS_1] |= SW_CC;
+  }
+
+  if(sensor->calBusy && _now >= sensor->calDoneAt)
+  {
+    sensor->calBusy = false;
+    sensor->registers[CAL_CONFIG_1] &= ~0x01;
+    sensor->registers[STATUS_1] |= SW_CC;
+  }
+}
+
+// Executes the ERA operation requested through ERA_CONTROL
+static void SIM_startEra(simSensor_t * sensor, uint8_t control)
+{
+  uint16_t address = ((uint16_t)sensor->registers[ERA_HIGH_BYTE] << 8) | sensor->registers[ERA_LOW_BYTE];
+
+  if(control & ERA_READ)
+  {
+    sensor->registers[ERA_VALUE] = sensor->era[address];
+    if(control & ERA_INC_READ) address++;
+  }
+  else if(control & ERA_WRITE)
+  {
+    sensor->era[address] = sensor->registers[ERA_VALUE];
+    if(control & ERA_INC_WRITE) address++;
+  }
+
+  sensor->registers[ERA_HIGH_BYTE] = (uint8_t)(address >> 8);
+  sensor->registers[ERA_LOW_BYTE] = (uint8_t)(address & 0x00FF);
+  sensor->registers[ERA_CONTROL] = control;
+  sensor->eraBusy = true;
+  sensor->eraDoneAt = _now + SIM_ERA_BUSY_NS;
+}
+
+static void SIM_writeRegister(simSensor_t * sensor, uint8_t address, uint8_t value)
+{
+  _counters.registerWrites++;
+  SIM_update(sensor);
+
+  switch(address)
+  {
+    case STATUS_1:
+      if(sensor->registers[STATUS_1] & ~value & (SW_DR | SW_CC))
+      {
+        sensor->drReleaseAt = _now + SIM_DR_SETTLE_NS;
+      }
+      sensor->registers[STATUS_1] = value;
+      break;
+    case ERA_CONTROL:
+      SIM_startEra(sensor, value);
+      break;
+    case CAL_CONFIG_1:
+      sensor->registers[CAL_CONFIG_1] = value;
+      if(value & 0x01)
+      {
+        sensor->calBusy = true;
+        sensor->calDoneAt = _now + SIM_CAL_BUSY_NS;
+      }
+      break;
+    case FIRMWARE_ID:
+    case FIRMWARE_VERSION:
+      break;  // read-only
+    default:
+      sensor->registers[address] = value;
+      break;
+  }
+}
+
+static uint8_t SIM_readRegister(simSensor_t * sensor, uint8_t address)
+{
+  _counters.registerReads++;
+  SIM_update(sensor);
+  return sensor->registers[address];
+}
+
+// Restores every simulated sensor to its power-on state and clears the clock and counters
+void SIM_reset(uint8_t sensorCount)
+{
+  uint8_t i;
+  uint16_t j;
+
+  memset(_sensors, 0, sizeof(_sensors));
+  memset(_drHandler, 0, sizeof(_drHandler));
+  memset(_i2cAddress, 0, sizeof(_i2cAddress));
+  _sensorCount = (sensorCount > SIM_MAX_SENSORS) ? SIM_MAX_SENSORS : sensorCount;
+  _registered = 0;
+
+  for(i = 0; i < _sensorCount; i++)
+  {
+    _sensors[i].registers[FIRMWARE_ID] = 0x07;
+    _sensors[i].registers[FIRMWARE_VERSION] = 0x3A;
+    _sensors[i].registers[STATUS_1] = SW_CC;
+    _sensors[i].registers[SAMPLE_RATE] = 0x64;
+    _sensors[i].registers[Z_IDLE] = 0x1E;
+
+    _sensors[i].era[0x0187] = ADC_ATTENUATE_4X;
+    for(j = 0; j < 92; j++)
+    {
+      _sensors[i].era[0x01DF + j] = (uint8_t)(j * 7 + i);   // recognisable comp-matrix contents
+    }
+  }
+
+  _now = 0;
+  _asyncDoneAt = 0;
+  _selected = NO_SENSOR;
+  _phase = PHASE_COMMAND;
+  _i2cClaimed = false;
+  memset(&_counters, 0, sizeof(_counters));
+}
+
+// Latches a raw 6-byte packet into PACKET_BYTE_0..5 and raises SW_DR, as the chip does at the end
+// of a sample. Returns false (packet discarded) while the feed is disabled.
+bool SIM_pushPacket(uint8_t sensorId, const uint8_t * packet)
+{
+  simSensor_t * sensor;
+  bool drWasAsserted;
+
+  if(sensorId >= _registered) return false;
+  sensor = &_sensors[sensorId];
+
+  SIM_update(sensor);
+  if(!(sensor->registers[FEED_CONFIG_1] & 0x01)) return false;
+
+  if(sensor->registers[STATUS_1] & SW_DR) _counters.packetsOverwritten++;
+
+  drWasAsserted = HW_drAsserted(sensorId);
+  memcpy(&sensor->registers[PACKET_BYTE_0], packet, 6);
+  sensor->registers[STATUS_1] |= SW_DR;
+
+  // A rising DR edge runs the attached handler, as the pin interrupt would on the target
+  if(!drWasAsserted && _drHandler[sensorId] && _selected == NO_SENSOR)
+  {
+    _drHandler[sensorId](sensorId);
+  }
+  return true;
+}
+
+// Encodes an absolute-mode packet the way Pinnacle_getAbsolute() expects to decode it
+bool SIM_pushAbsolute(uint8_t sensorId, uint16_t xValue, uint16_t yValue, uint8_t zValue, uint8_t buttons)
+{
+  uint8_t packet[6];
+
+  packet[0] = buttons & 0x3F;
+  packet[1] = 0x00;
+  packet[2] = (uint8_t)(xValue & 0x00FF);
+  packet[3] = (uint8_t)(yValue & 0x00FF);
+  packet[4] = (uint8_t)(((xValue >> 8) & 0x0F) | ((yValue >> 4) & 0xF0));
+  packet[5] = zValue & 0x3F;
+
+  return SIM_pushPacket(sensorId, packet);
+}
+
+// Encodes a relative-mode packet the way Pinnacle_getRelative() expects to decode it
+// Deltas are 9 bits (-256 to 255), with the sign bits in byte 0.
+bool SIM_pushRelative(uint8_t sensorId, int16_t xDelta, int16_t yDelta, int8_t wheelCount, uint8_t buttons)
+{
+  uint8_t packet[6] = { 0,0,0,0,0,0 };
+
+  packet[0] = (buttons & 0x07) | ((xDelta < 0) ? 0x10 : 0) | ((yDelta < 0) ? 0x20 : 0);
+  packet[1] = (uint8_t)xDelta;
+  packet[2] = (uint8_t)yDelta;
+  packet[3] = (uint8_t)wheelCount;
+
+  return SIM_pushPacket(sensorId, packet);
+}
+
+uint8_t SIM_peekRegister(uint8_t sensorId, uint8_t address)
+{
+  SIM_update(&_sensors[sensorId]);
+  return _sensors[sensorId].registers[address & 0x1F];
+}
+
+void SIM_pokeRegister(uint8_t sensorId, uint8_t address, uint8_t value)
+{
+  _sensors[sensorId].registers[address & 0x1F] = value;
+}
+
+uint8_t SIM_peekEra(uint8_t sensorId, uint16_t address)
+{
+  return _sensors[sensorId].era[address];
+}
+
+void SIM_pokeEra(uint8_t sensorId, uint16_t address, uint8_t value)
+{
+  _sensors[sensorId].era[address] = value;
+}
+
+// Makes a sensor stop completing ERA and calibration requests, like a wedged chip, or recover
+void SIM_stall(uint8_t sensorId, bool stalled)
+{
+  _sensors[sensorId].stalled = stalled;
+}
+
+// Makes an I2C sensor stop acknowledging its address, like a pad whose cable came off, or come back
+void SIM_unplug(uint8_t sensorId, bool unplugged)
+{
+  _sensors[sensorId].unplugged = unplugged;
+}
+
+// Moves the virtual clock forward, e.g. to model time spent outside of the Pinnacle driver
+void SIM_advance(uint32_t nanoSeconds)
+{
+  _now += nanoSeconds;
+}
+
+uint64_t SIM_nanos(void)
+{
+  return _now;
+}
+
+void SIM_getCounters(simCounters_t * counters)
+{
+  *counters = _counters;
+}
+
+void SIM_clearCounters(void)
+{
+  memset(&_counters, 0, sizeof(_counters));
+}
+
+/*  Hardware.h implementation  */
+// Wires up sensors 0 and 1, like the dev-kit's two sensor ports
+void HW_init(void)
+{
+  _selected = NO_SENSOR;
+  _registered = 0;
+  memset(_i2cAddress, 0, sizeof(_i2cAddress));
+  HW_addSensor(10, 9, 0);
+  HW_addSensor(8, 7, 0);
+}
+
+// Pins are not modelled; sensors get the simulated chips in order. All buses share the one virtual
+// clock, which matches blocking transfers (the CPU waits on each bus in turn).
+uint8_t HW_addSensor(uint8_t csPin, uint8_t drPin, uint8_t bus)
+{
+  (void)csPin;
+  (void)drPin;
+  (void)bus;
+  if(_registered >= _sensorCount || _registered >= HW_MAX_SENSORS) return HW_NO_SENSOR;
+
+  return _registered++;
+}
+
+// I2C sensors get the next simulated chip too, answering at <i2cAddress>
+uint8_t HW_addI2cSensor(uint8_t i2cAddress, uint8_t drPin)
+{
+  uint8_t i;
+
+  (void)drPin;
+  if(_registered >= _sensorCount || _registered >= HW_MAX_SENSORS || i2cAddress == 0) return HW_NO_SENSOR;
+  for(i = 0; i < _registered; i++)
+  {
+    if(_i2cAddress[i] == i2cAddress) return HW_NO_SENSOR;
+  }
+
+  _i2cAddress[_registered] = i2cAddress;
+  return _registered++;
+}
+
+uint8_t HW_i2cAddress(uint8_t sensorId)
+{
+  return (sensorId < _registered) ? _i2cAddress[sensorId] : 0;
+}
+
+uint8_t HW_sensorCount(void)
+{
+  return _registered;
+}
+
+void HW_assertCS(uint8_t sensorId)
+{
+  _selected = (sensorId < _registered) ? sensorId : NO_SENSOR;
+  _phase = PHASE_COMMAND;
+  _counters.transactions++;
+}
+
+void HW_deAssertCS(uint8_t sensorId)
+{
+  (void)sensorId;
+  _selected = NO_SENSOR;
+}
+
+bool HW_drAsserted(uint8_t sensorId)
+{
+  simSensor_t * sensor;
+
+  if(sensorId >= _registered) return false;
+  sensor = &_sensors[sensorId];
+
+  SIM_update(sensor);
+  return (sensor->registers[STATUS_1] & (SW_DR | SW_CC)) || (_now < sensor->drReleaseAt);
+}
+
+void HW_attachDrInterrupt(uint8_t sensorId, void (*handler)(uint8_t))
+{
+  _drHandler[sensorId] = handler;
+}
+
+void HW_detachDrInterrupt(uint8_t sensorId)
+{
+  _drHandler[sensorId] = 0;
+}
+
+void TIMER_delayMicroseconds(uint32_t microSeconds)
+{
+  _now += (uint64_t)microSeconds * 1000;
+  _counters.delayNanos += (uint64_t)microSeconds * 1000;
+}
+
+uint32_t TIMER_micros(void)
+{
+  return (uint32_t)(_now / 1000);
+}
+
+// A cycle is a nanosecond of virtual time, so measurements are the same on every run
+uint32_t TIMER_cycles(void)
+{
+  return (uint32_t)_now;
+}
+
+uint32_t TIMER_cyclesPerMicro(void)
+{
+  return 1000;
+}
+
+void SPI_init(uint32_t bitRate, uint8_t bitOrder, uint8_t spiMode)
+{
+  (void)bitOrder;
+  (void)spiMode;
+  _byteNanos = (uint32_t)(8000000000ULL / bitRate);
+}
+
+void SPI_end(void)
+{
+}
+
+void SPI_beginTransaction(uint8_t sensorId)
+{
+  (void)sensorId;
+}
+
+void SPI_endTransaction(uint8_t sensorId)
+{
+  (void)sensorId;
+}
+
+// Clocks one byte through the simulated RAP decoder
+static uint8_t SIM_transferByte(uint8_t data)
+{
+  simSensor_t * sensor;
+  uint8_t result = 0xFF;
+
+  _counters.bytes++;
+  _counters.busNanos += _byteNanos;
+  _now += _byteNanos;
+
+  if(_selected == NO_SENSOR) return result;
+  sensor = &_sensors[_selected];
+
+  switch(_phase)
+  {
+    case PHASE_COMMAND:
+      _address = data & 0x1F;
+      if((data & 0xE0) == 0xA0)
+      {
+        _fillerCount = 0;
+        _phase = PHASE_READ_FILLER;
+      }
+      else if((data & 0xE0) == 0x80)
+      {
+        _phase = PHASE_WRITE_DATA;
+      }
+      result = 0xFB;
+      break;
+    case PHASE_READ_FILLER:
+      if(++_fillerCount == 2) _phase = PHASE_READ_DATA;
+      result = 0xFB;
+      break;
+    case PHASE_READ_DATA:
+      result = SIM_readRegister(sensor, _address);
+      _address = (_address + 1) & 0x1F;
+      break;
+    case PHASE_WRITE_DATA:
+      // Pinnacle accepts further address/data pairs within the same CS assertion
+      SIM_writeRegister(sensor, _address, data);
+      _phase = PHASE_COMMAND;
+      result = 0xFB;
+      break;
+  }
+
+  return result;
+}
+
+uint8_t SPI_transfer(uint8_t data)
+{
+  _counters.transferCalls++;
+  return SIM_transferByte(data);
+}
+
+void SPI_transferBytes(uint8_t * data, uint16_t count)
+{
+  uint16_t i = 0;
+
+  _counters.transferCalls++;
+  for(; i < count; i++)
+  {
+    data[i] = SIM_transferByte(data[i]);
+  }
+}
+
+// The bytes are exchanged immediately, but the transfer only reports done once the virtual clock
+// has passed the time the bytes would take on the bus; the CPU (the clock) is not held meanwhile
+void SPI_startTransferBytes(uint8_t * data, uint16_t count)
+{
+  uint64_t startedAt = _now;
+
+  SPI_transferBytes(data, count);
+  _asyncDoneAt = _now;
+  _now = startedAt;
+}
+
+// Each poll of a busy transfer costs SIM_POLL_NS of CPU time
+bool SPI_transferBusy(void)
+{
+  if(_now >= _asyncDoneAt) return false;
+
+  _now += SIM_POLL_NS;
+  return true;
+}
+
+void I2C_init(uint32_t clock)
+{
+  _i2cBitNanos = (uint32_t)(1000000000ULL / clock);
+  _i2cClaimed = false;
+}
+
+void I2C_end(void)
+{
+}
+
+// Puts <bits> bit times on the I2C bus
+static void SIM_i2cClock(uint32_t bits)
+{
+  _counters.busNanos += (uint64_t)bits * _i2cBitNanos;
+  _now += (uint64_t)bits * _i2cBitNanos;
+}
+
+// Starts a transfer (a repeated start if the bus was kept) and clocks the address byte. Returns the
+// chip at <address>, or NO_SENSOR if none acknowledges.
+static uint8_t SIM_i2cStart(uint8_t address)
+{
+  uint8_t i;
+
+  if(!_i2cClaimed) _counters.transactions++;
+  _i2cClaimed = true;
+  _counters.transferCalls++;
+  _counters.bytes++;
+  SIM_i2cClock(SIM_I2C_START_BITS + SIM_I2C_BYTE_BITS);
+
+  for(i = 0; i < _registered; i++)
+  {
+    if(_i2cAddress[i] == address && !_sensors[i].unplugged) return i;
+  }
+  return NO_SENSOR;
+}
+
+static void SIM_i2cStop(void)
+{
+  _i2cClaimed = false;
+  SIM_i2cClock(SIM_I2C_STOP_BITS);
+}
+
+// Decodes the RAP bytes the way the chip does on I2C: a read command only sets where the next read
+// starts, a write command takes the byte after it; further pairs may follow in the same transfer
+bool I2C_write(uint8_t address, const uint8_t * data, uint8_t count, bool stop)
+{
+  simSensor_t * sensor;
+  uint8_t sensorId = SIM_i2cStart(address);
+  uint8_t i;
+
+  if(sensorId == NO_SENSOR)
+  {
+    SIM_i2cStop();
+    return false;
+  }
+  sensor = &_sensors[sensorId];
+
+  _phase = PHASE_COMMAND;
+  for(i = 0; i < count; i++)
+  {
+    _counters.bytes++;
+    SIM_i2cClock(SIM_I2C_BYTE_BITS);
+
+    if(_phase == PHASE_WRITE_DATA)
+    {
+      SIM_writeRegister(sensor, sensor->i2cRegister, data[i]);
+      _phase = PHASE_COMMAND;
+    }
+    else
+    {
+      sensor->i2cRegister = data[i] & 0x1F;
+      if((data[i] & 0xE0) == 0x80) _phase = PHASE_WRITE_DATA;
+    }
+  }
+
+  if(stop) SIM_i2cStop();
+  return true;
+}
+
+bool I2C_read(uint8_t address, uint8_t * data, uint8_t count)
+{
+  simSensor_t * sensor;
+  uint8_t sensorId = SIM_i2cStart(address);
+  uint8_t i;
+
+  if(sensorId == NO_SENSOR)
+  {
+    SIM_i2cStop();
+    return false;
+  }
+  sensor = &_sensors[sensorId];
+
+  for(i = 0; i < count; i++)
+  {
+    _counters.bytes++;
+    SIM_i2cClock(SIM_I2C_BYTE_BITS);
+    data[i] = SIM_readRegister(sensor, sensor->i2cRegister);
+    sensor->i2cRegister = (sensor->i2cRegister + 1) & 0x1F;
+  }
+
+  SIM_i2cStop();
+  return true;
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// Host-side (Linux) implementation of Hardware.h backed by a simulated 1CA027 register file.
+// The simulator decodes the RAP byte stream exactly as Pinnacle.c produces it, models the ERA
+// window (0x1B - 0x1E), STATUS_1 flags and the DR pin, and keeps a virtual clock so the cost of
+// the read path can be measured without a Teensy.
+
+#ifndef HARDWARE_SIM_H
+#define HARDWARE_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_MAX_SENSORS   16
+
+// Timing model (nanoseconds of virtual time)
+#define SIM_ERA_BUSY_NS       20000   // ERA_CONTROL stays non-zero this long after a request
+#define SIM_CAL_BUSY_NS    20000000   // CAL_CONFIG_1 bit 0 stays set this long after a request
+#define SIM_DR_SETTLE_NS      50000   // DR pin lags STATUS_1 by this long after a clear
+#define SIM_POLL_NS            1000   // CPU time of one SPI_transferBusy() poll
+
+// I2C costs, in bit times of the I2C_init() clock: a START (or repeated start) and a STOP take one
+// each, every byte nine (eight bits and the acknowledge), including the address byte of a transfer
+#define SIM_I2C_START_BITS        1
+#define SIM_I2C_STOP_BITS         1
+#define SIM_I2C_BYTE_BITS         9
+
+// Bus statistics accumulated since the last SIM_clearCounters()
+typedef struct _simCounters
+{
+  uint32_t transactions;    // CS assertions, or I2C transfers from START to STOP
+  uint32_t bytes;           // bytes clocked on the bus (on I2C, with the address bytes)
+  uint32_t transferCalls;   // calls into SPI_transfer / SPI_transferBytes / I2C_write / I2C_read
+  uint32_t registerWrites;  // RAP register writes decoded by the simulated chip
+  uint32_t registerReads;   // RAP register reads decoded by the simulated chip
+  uint32_t packetsOverwritten;  // packets replaced by a newer one before the host read them
+  uint64_t busNanos;        // time spent clocking bytes at the configured bit-rate
+  uint64_t delayNanos;      // time spent in TIMER_delayMicroseconds
+} simCounters_t;
+
+void SIM_reset(uint8_t sensorCount);
+bool SIM_pushPacket(uint8_t sensorId, const uint8_t * packet);
+bool SIM_pushAbsolute(uint8_t sensorId, uint16_t xValue, uint16_t yValue, uint8_t zValue, uint8_t buttons);
+bool SIM_pushRelative(uint8_t sensorId, int16_t xDelta, int16_t yDelta, int8_t wheelCount, uint8_t buttons);
+uint8_t SIM_peekRegister(uint8_t sensorId, uint8_t address);
+void SIM_pokeRegister(uint8_t sensorId, uint8_t address, uint8_t value);
+uint8_t SIM_peekEra(uint8_t sensorId, uint16_t address);
+void SIM_pokeEra(uint8_t sensorId, uint16_t address, uint8_t value);
+void SIM_stall(uint8_t sensorId, bool stalled);
+void SIM_unplug(uint8_t sensorId, bool unplugged);
+void SIM_advance(uint32_t nanoSeconds);
+uint64_t SIM_nanos(void);
+void SIM_getCounters(simCounters_t *);
+void SIM_clearCounters(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HARDWARE_SIM_H
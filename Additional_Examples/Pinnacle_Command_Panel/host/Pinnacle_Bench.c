@@ -0,0 +1,2730 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// ___ Pinnacle read-path benchmark on the simulated 1CA027 ___
+// Runs Pinnacle.c against Hardware_Sim.c and reports, per packet (or per operation), the number of
+// CS assertions, bytes on the bus, virtual bus/delay time and host CPU time.
+// Usage: pinnacle_bench [-c]
+//   -c  compare against the budgets below and exit non-zero on a regression (for CI)
+// Built with PINNACLE_INSTRUMENT (make pinnacle_bench_instrumented) it also prints the latency
+// histograms the instrumentation collected over the whole run, in virtual nanoseconds.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Pinnacle.h"
+#include "Hardware.h"
+#include "Hardware_Sim.h"
+#include "SensorManager.h"
+#include "Transform.h"
+#include "HoverMap.h"
+#include "Telemetry.h"
+#include "TextFormat.h"
+#include "Instrument.h"
+#include "Profile.h"
+#include "Transport.h"
+#include "Gesture.h"
+#include "Polar.h"
+#include "MotionFilter.h"
+#include "Pointer.h"
+#include "HidReport.h"
+
+#define SENSOR_COUNT    2
+#define PACKET_COUNT    20000
+
+typedef struct _benchResult
+{
+  const char * name;
+  uint32_t operations;
+  simCounters_t counters;
+  uint64_t cpuNanos;
+  uint64_t wallNanos;       // virtual time that passed, including modelled processing
+  uint32_t staleReads;      // DR still asserted after a packet was consumed
+  uint32_t errors;          // data read back differs from the simulated chip
+  uint32_t lost;            // packets produced by the sensor that never reached the caller
+} benchResult_t;
+
+// Per-operation limits used by -c. A benchmark without a budget entry is reported only.
+typedef struct _benchBudget
+{
+  const char * name;
+  double transactions;
+  double blockingMicros;    // bus time + fixed delays
+  double wallMicros;        // elapsed virtual time including modelled processing (0 = unchecked)
+} benchBudget_t;
+
+static const benchBudget_t budgets[] =
+{
+  { "absolute packet",          2.0,   138.0,   0.0 },
+  { "absolute fast-read",       2.0,    88.0,   0.0 },
+  { "relative packet",          2.0,   122.0,   0.0 },
+  { "relative fast-read",       2.0,    72.0,   0.0 },
+  { "stalled loop, ISR",        2.0,    88.0,   0.0 },
+  { "two-pad loop, blocking",   2.0,    88.0, 175.0 },
+  { "two-pad loop, queued",     2.0,    88.0, 160.0 },
+  { "manager, 8 pads",          2.0,    88.0, 126.0 },
+  { "manager, 8 pads, 2 kHz",   2.0,    88.0,  90.0 },
+  { "era read per-byte",      380.0, 14000.0,   0.0 },
+  { "era read block",         285.0,  7500.0,   0.0 },
+  { "era write per-byte",     560.0, 15000.0,   0.0 },
+  { "era write block",        190.0,  6100.0,   0.0 },
+  { "config changes, shadow",  15.0,   400.0,   0.0 },
+  { "i2c packet, 400 kHz",      2.0,   290.0,   0.0 },
+  { "i2c packet, 1 MHz",        2.0,   116.0,   0.0 },
+  { "i2c registers, batched",   1.0,   170.0,   0.0 },
+};
+
+static uint64_t cpuNow(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Simulates <count> sensors: the first two are the dev-kit ports set up by HW_init(), the rest are
+// added with HW_addSensor()
+static void setupSensorCount(touchData_t * touchData, uint8_t count)
+{
+  uint8_t i;
+
+  SIM_reset(count);
+  HW_init();
+  for(i = HW_sensorCount(); i < count; i++)
+  {
+    HW_addSensor(0, 0, 0);
+  }
+  SPI_init(1000000, MSBFIRST, SPI_MODE1);
+
+  for(i = 0; i < count; i++)
+  {
+    memset(&touchData[i], 0, sizeof(touchData_t));
+    Pinnacle_init(&touchData[i], i);
+  }
+}
+
+static void setupSensors(touchData_t * touchData)
+{
+  setupSensorCount(touchData, SENSOR_COUNT);
+}
+
+static void beginResult(benchResult_t * result, const char * name)
+{
+  memset(result, 0, sizeof(benchResult_t));
+  result->name = name;
+  SIM_clearCounters();
+  result->wallNanos = SIM_nanos();
+  result->cpuNanos = cpuNow();
+}
+
+static void endResult(benchResult_t * result)
+{
+  result->cpuNanos = cpuNow() - result->cpuNanos;
+  result->wallNanos = SIM_nanos() - result->wallNanos;
+  SIM_getCounters(&result->counters);
+}
+
+// Streams packets from both sensors through Pinnacle_getTouchData() in the given mode
+static void benchPackets(benchResult_t * result, const char * name, uint8_t mode, bool fastRead)
+{
+  touchData_t touchData[SENSOR_COUNT];
+  uint32_t i;
+  uint8_t sensorId;
+
+  setupSensors(touchData);
+  for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+  {
+    if(mode == RELATIVE) Pinnacle_setToRelative(&touchData[sensorId], sensorId);
+    Pinnacle_clearFlags(sensorId);
+    Pinnacle_enableFastRead(fastRead, sensorId);
+  }
+
+  beginResult(result, name);
+  for(i = 0; i < PACKET_COUNT; i++)
+  {
+    sensorId = i % SENSOR_COUNT;
+    if(mode == ABSOLUTE)
+    {
+      SIM_pushAbsolute(sensorId, 128 + (i & 0x3FF), 64 + (i & 0x1FF), 40, 0);
+    }
+    else
+    {
+      SIM_pushRelative(sensorId, (int8_t)(i & 0x0F), -(int8_t)(i & 0x07), 0, 0);
+    }
+
+    if(Pinnacle_available(sensorId))
+    {
+      Pinnacle_getTouchData(&touchData[sensorId], sensorId);
+      result->operations++;
+      if(Pinnacle_available(sensorId)) result->staleReads++;
+    }
+  }
+  endResult(result);
+}
+
+#define SAMPLE_PERIOD_NS    5000000   // one packet every 5 ms, alternating between the sensors
+#define STALL_PACKETS       8         // the main loop only gets to run once every this many packets
+
+// Models a main loop that is busy (printing, ...) for STALL_PACKETS sample periods at a time and
+// then consumes whatever it can, either by polling DR or by draining the capture rings
+static void benchStalledLoop(benchResult_t * result, const char * name, bool capture)
+{
+  touchData_t touchData[SENSOR_COUNT];
+  rawPacket_t packets[PACKET_RING_SIZE];
+  uint32_t i;
+  uint16_t count, j;
+  uint8_t sensorId;
+
+  setupSensors(touchData);
+  for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+  {
+    Pinnacle_clearFlags(sensorId);
+    Pinnacle_enableFastRead(true, sensorId);
+    if(capture) Pinnacle_enableCapture(true, sensorId);
+  }
+
+  beginResult(result, name);
+  for(i = 0; i < PACKET_COUNT; i++)
+  {
+    SIM_advance(SAMPLE_PERIOD_NS);
+    SIM_pushAbsolute(i % SENSOR_COUNT, 128 + (i & 0x3FF), 64 + (i & 0x1FF), 40, 0);
+
+    if((i % STALL_PACKETS) != STALL_PACKETS - 1) continue;
+
+    for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+    {
+      if(capture)
+      {
+        count = Pinnacle_getCaptured(packets, PACKET_RING_SIZE, sensorId);
+        for(j = 0; j < count; j++) Pinnacle_decodePacket(&packets[j], &touchData[sensorId]);
+        result->operations += count;
+      }
+      else if(Pinnacle_available(sensorId))
+      {
+        Pinnacle_getTouchData(&touchData[sensorId], sensorId);
+        result->operations++;
+      }
+    }
+  }
+  result->lost = PACKET_COUNT - result->operations;
+  endResult(result);
+}
+
+#define PROCESS_NS          60000     // time the two-pad loop spends on each packet after reading it
+
+static uint32_t _processed;
+
+static void processPacket(packetRequest_t * request)
+{
+  (void)request;
+  SIM_advance(PROCESS_NS);
+  _processed++;
+}
+
+// Two-pad loop that reads and then processes every packet, either blocking on each read or queueing
+// the reads of both pads and processing each packet while the next transfer is on the bus
+static void benchTwoPadLoop(benchResult_t * result, const char * name, bool async)
+{
+  touchData_t touchData[SENSOR_COUNT];
+  packetRequest_t requests[SENSOR_COUNT];
+  uint32_t i;
+  uint8_t sensorId;
+
+  setupSensors(touchData);
+  SpiQueue_init();
+  for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+  {
+    Pinnacle_clearFlags(sensorId);
+    Pinnacle_enableFastRead(true, sensorId);
+    requests[sensorId].pending = false;
+  }
+
+  _processed = 0;
+  beginResult(result, name);
+  for(i = 0; i < PACKET_COUNT / SENSOR_COUNT; i++)
+  {
+    SIM_advance(DR_SETTLE_MICROS * 1000);
+    for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+    {
+      SIM_pushAbsolute(sensorId, 128 + (i & 0x3FF), 64 + (i & 0x1FF), 40, 0);
+    }
+
+    for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+    {
+      if(!Pinnacle_available(sensorId)) continue;
+
+      if(async)
+      {
+        Pinnacle_requestTouchData(&requests[sensorId], &touchData[sensorId], sensorId, processPacket);
+      }
+      else
+      {
+        Pinnacle_getTouchData(&touchData[sensorId], sensorId);
+        processPacket(0);
+      }
+    }
+    SpiQueue_flush();
+  }
+  result->operations = _processed;
+  endResult(result);
+  result->lost = PACKET_COUNT - result->operations;
+}
+
+#define MANAGER_RUN_NS      200000000   // virtual time each sensor-manager run covers
+#define MANAGER_IDLE_NS     2000        // cost of a service pass that found nothing to read
+
+typedef struct _managerSummary
+{
+  uint8_t count;
+  uint32_t periodMicros;
+  uint32_t packetsPerSecond;    // all sensors together
+  uint32_t minShare;            // fewest packets read from one sensor
+  uint32_t maxShare;            // most packets read from one sensor
+  uint32_t averageLatency;
+  uint32_t worstLatency;
+} managerSummary_t;
+
+// <count> sensors each producing a packet every <periodNs>, staggered across the period, all served by
+// SensorManager_service() from one loop. Packets a sensor replaces before they are read count as lost.
+static void benchManager(benchResult_t * result, const char * name, uint8_t count, uint32_t periodNs, managerSummary_t * summary)
+{
+  touchData_t touchData[HW_MAX_SENSORS];
+  uint64_t nextPacketAt[HW_MAX_SENSORS];
+  uint64_t endAt;
+  sensorStats_t stats;
+  uint32_t sequence = 0;
+  uint8_t sensorId;
+
+  setupSensorCount(touchData, count);
+  SensorManager_init();
+  for(sensorId = 0; sensorId < count; sensorId++)
+  {
+    Pinnacle_clearFlags(sensorId);
+    Pinnacle_enableFastRead(true, sensorId);
+    SensorManager_add(sensorId, &touchData[sensorId]);
+    nextPacketAt[sensorId] = SIM_nanos() + ((uint64_t)periodNs * sensorId) / count;
+  }
+
+  beginResult(result, name);
+  SensorManager_resetStats();
+  endAt = SIM_nanos() + MANAGER_RUN_NS;
+  while(SIM_nanos() < endAt)
+  {
+    for(sensorId = 0; sensorId < count; sensorId++)
+    {
+      if(SIM_nanos() < nextPacketAt[sensorId]) continue;
+      SIM_pushAbsolute(sensorId, 128 + (sequence & 0x3FF), 64 + (sequence & 0x1FF), 40, 0);
+      nextPacketAt[sensorId] += periodNs;
+      sequence++;
+    }
+
+    if(SensorManager_service() == SENSOR_NONE) SIM_advance(MANAGER_IDLE_NS);
+  }
+  endResult(result);
+
+  summary->count = count;
+  summary->periodMicros = periodNs / 1000;
+  summary->minShare = 0xFFFFFFFF;
+  summary->maxShare = 0;
+  summary->worstLatency = 0;
+  summary->averageLatency = 0;
+  for(sensorId = 0; sensorId < count; sensorId++)
+  {
+    SensorManager_getStats(sensorId, &stats);
+    result->operations += stats.packets;
+    if(stats.packets < summary->minShare) summary->minShare = stats.packets;
+    if(stats.packets > summary->maxShare) summary->maxShare = stats.packets;
+    if(stats.latencyMax > summary->worstLatency) summary->worstLatency = stats.latencyMax;
+    summary->averageLatency += stats.latencyTotal;
+  }
+  if(result->operations) summary->averageLatency /= result->operations;
+  summary->packetsPerSecond = (uint32_t)(((uint64_t)result->operations * 1000000000ULL) / MANAGER_RUN_NS);
+  result->lost = result->counters.packetsOverwritten;
+}
+
+#define ERA_BENCH_ADDRESS   0x01DF
+#define ERA_BENCH_SIZE      COMP_MATRIX_SIZE
+
+// Reads the comp-matrix range from each sensor, per byte or as one block, and checks the contents
+static void benchEraRead(benchResult_t * result, const char * name, bool block)
+{
+  touchData_t touchData[SENSOR_COUNT];
+  uint8_t data[ERA_BENCH_SIZE];
+  uint8_t sensorId;
+  uint16_t i;
+
+  setupSensors(touchData);
+
+  beginResult(result, name);
+  for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+  {
+    if(block)
+    {
+      ERA_readBlock(ERA_BENCH_ADDRESS, data, ERA_BENCH_SIZE, sensorId);
+    }
+    else
+    {
+      ERA_readBytes(ERA_BENCH_ADDRESS, data, ERA_BENCH_SIZE, sensorId);
+    }
+    result->operations++;
+
+    for(i = 0; i < ERA_BENCH_SIZE; i++)
+    {
+      if(data[i] != SIM_peekEra(sensorId, ERA_BENCH_ADDRESS + i)) result->errors++;
+    }
+  }
+  endResult(result);
+}
+
+// Writes the comp-matrix range on each sensor, per byte or as one block, and checks the contents
+static void benchEraWrite(benchResult_t * result, const char * name, bool block)
+{
+  touchData_t touchData[SENSOR_COUNT];
+  uint8_t data[ERA_BENCH_SIZE];
+  uint8_t sensorId;
+  uint16_t i;
+
+  setupSensors(touchData);
+  for(i = 0; i < ERA_BENCH_SIZE; i++) data[i] = (uint8_t)(0xA5 ^ i);
+
+  beginResult(result, name);
+  for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+  {
+    if(block)
+    {
+      ERA_writeBlock(ERA_BENCH_ADDRESS, data, ERA_BENCH_SIZE, sensorId);
+    }
+    else
+    {
+      for(i = 0; i < ERA_BENCH_SIZE; i++) ERA_writeByte(ERA_BENCH_ADDRESS + i, data[i], sensorId);
+    }
+    result->operations++;
+
+    for(i = 0; i < ERA_BENCH_SIZE; i++)
+    {
+      if(data[i] != SIM_peekEra(sensorId, ERA_BENCH_ADDRESS + i)) result->errors++;
+    }
+  }
+  endResult(result);
+}
+
+#define CONFIG_ROUNDS         100
+#define ADC_ATTENUATION_ERA   0x0187
+
+// Switches sensor 0 to relative mode with scroll, back to absolute, to a curved overlay and back,
+// and turns the feed off and on again, all through the register shadow or, <cold>, with the shadow
+// forgotten before each round. Checks the sensor ends up configured as before.
+static void benchConfig(benchResult_t * result, const char * name, bool cold)
+{
+  touchData_t touchData[SENSOR_COUNT];
+  uint32_t i;
+
+  setupSensors(touchData);
+
+  beginResult(result, name);
+  for(i = 0; i < CONFIG_ROUNDS; i++)
+  {
+    if(cold) Pinnacle_invalidateShadow(0);
+
+    Pinnacle_setToRelative(&touchData[0], 0);
+    Pinnacle_enableScroll(0);
+    Pinnacle_setToAbsolute(&touchData[0], 0);
+    Pinnacle_enableCurved(&touchData[0], true, 0);
+    Pinnacle_enableCurved(&touchData[0], false, 0);
+    Pinnacle_enableFeed(false, 0);
+    Pinnacle_enableFeed(true, 0);
+    Pinnacle_setZIdleCount(5, 0);
+    result->operations++;
+
+    if(SIM_peekRegister(0, FEED_CONFIG_1) != 0x03 || SIM_peekRegister(0, Z_IDLE) != 5) result->errors++;
+    if((SIM_peekEra(0, ADC_ATTENUATION_ERA) & 0xC0) != ADC_ATTENUATE_4X) result->errors++;
+  }
+  endResult(result);
+}
+
+static double perOperation(uint64_t value, uint32_t operations)
+{
+  return operations ? (double)value / operations : 0.0;
+}
+
+// Prints one row and returns false if it exceeds its budget
+static bool reportResult(const benchResult_t * result, bool check)
+{
+  const simCounters_t * c = &result->counters;
+  double transactions = perOperation(c->transactions, result->operations);
+  double busMicros = perOperation(c->busNanos, result->operations) / 1000.0;
+  double delayMicros = perOperation(c->delayNanos, result->operations) / 1000.0;
+  double wallMicros = perOperation(result->wallNanos, result->operations) / 1000.0;
+  bool withinBudget = true;
+  uint8_t i;
+
+  printf("%-22s %8u %7.2f %8.2f %7.2f %9.2f %9.2f %9.2f %9.1f %6u %6u",
+    result->name, result->operations, transactions,
+    perOperation(c->bytes, result->operations), perOperation(c->transferCalls, result->operations),
+    busMicros, delayMicros, wallMicros,
+    perOperation(result->cpuNanos, result->operations), result->staleReads, result->lost);
+
+  for(i = 0; check && i < sizeof(budgets) / sizeof(budgets[0]); i++)
+  {
+    if(strcmp(budgets[i].name, result->name) != 0) continue;
+    if(transactions > budgets[i].transactions || busMicros + delayMicros > budgets[i].blockingMicros)
+    {
+      withinBudget = false;
+      printf("  OVER BUDGET (%.2f CS, %.2f us)", budgets[i].transactions, budgets[i].blockingMicros);
+    }
+    if(budgets[i].wallMicros > 0 && wallMicros > budgets[i].wallMicros)
+    {
+      withinBudget = false;
+      printf("  OVER BUDGET (%.2f us elapsed)", budgets[i].wallMicros);
+    }
+  }
+  if(check && result->lost && strstr(result->name, "ISR"))
+  {
+    withinBudget = false;
+    printf("  PACKETS LOST");
+  }
+  if(result->errors)
+  {
+    withinBudget = false;
+    printf("  %u DATA ERRORS", result->errors);
+  }
+  printf("\n");
+
+  return withinBudget;
+}
+
+/*  Coordinate scaling  */
+#define SCALE_COUNT     2000000
+#define SCALE_PACKETS   64
+
+// ScaleData() and ClipCoordinates() as the sample sketches have them, for reference
+static void referenceScale(absData_t * coordinates, uint16_t xResolution, uint16_t yResolution)
+{
+  uint32_t xTemp = 0;
+  uint32_t yTemp = 0;
+
+  if(coordinates->xValue < PINNACLE_X_LOWER) coordinates->xValue = PINNACLE_X_LOWER;
+  else if(coordinates->xValue > PINNACLE_X_UPPER) coordinates->xValue = PINNACLE_X_UPPER;
+  if(coordinates->yValue < PINNACLE_Y_LOWER) coordinates->yValue = PINNACLE_Y_LOWER;
+  else if(coordinates->yValue > PINNACLE_Y_UPPER) coordinates->yValue = PINNACLE_Y_UPPER;
+
+  xTemp = coordinates->xValue - PINNACLE_X_LOWER;
+  yTemp = coordinates->yValue - PINNACLE_Y_LOWER;
+
+  coordinates->xValue = (uint16_t)(xTemp * xResolution / PINNACLE_X_RANGE);
+  coordinates->yValue = (uint16_t)(yTemp * yResolution / PINNACLE_Y_RANGE);
+}
+
+// A host compiler turns the division by the constant range into a multiply, which a Cortex-M0 or
+// AVR can't (no 32x32->64 multiply), so there it calls a shift-and-subtract routine like this one
+__attribute__((noinline)) static uint32_t softDivide(uint32_t numerator, uint32_t denominator)
+{
+  uint32_t quotient = 0;
+  uint32_t remainder = 0;
+  int bit;
+
+  for(bit = 31; bit >= 0; bit--)
+  {
+    remainder = (remainder << 1) | ((numerator >> bit) & 1);
+    if(remainder >= denominator)
+    {
+      remainder -= denominator;
+      quotient |= 1UL << bit;
+    }
+  }
+  return quotient;
+}
+
+// ScaleData() with the divisions done as a part without a hardware divider does them
+static void referenceScaleSoft(absData_t * coordinates, uint16_t xResolution, uint16_t yResolution)
+{
+  uint32_t xTemp = 0;
+  uint32_t yTemp = 0;
+
+  if(coordinates->xValue < PINNACLE_X_LOWER) coordinates->xValue = PINNACLE_X_LOWER;
+  else if(coordinates->xValue > PINNACLE_X_UPPER) coordinates->xValue = PINNACLE_X_UPPER;
+  if(coordinates->yValue < PINNACLE_Y_LOWER) coordinates->yValue = PINNACLE_Y_LOWER;
+  else if(coordinates->yValue > PINNACLE_Y_UPPER) coordinates->yValue = PINNACLE_Y_UPPER;
+
+  xTemp = coordinates->xValue - PINNACLE_X_LOWER;
+  yTemp = coordinates->yValue - PINNACLE_Y_LOWER;
+
+  coordinates->xValue = (uint16_t)softDivide(xTemp * xResolution, PINNACLE_X_RANGE);
+  coordinates->yValue = (uint16_t)softDivide(yTemp * yResolution, PINNACLE_Y_RANGE);
+}
+
+__attribute__((noinline)) static void referenceScaleBatch(absData_t * data, uint16_t count, uint16_t xResolution, uint16_t yResolution, bool soft)
+{
+  uint16_t i;
+
+  for(i = 0; i < count; i++)
+  {
+    if(soft) referenceScaleSoft(&data[i], xResolution, yResolution);
+    else referenceScale(&data[i], xResolution, yResolution);
+  }
+}
+
+__attribute__((noinline)) static void transformEach(const transform_t * transform, absData_t * data, uint16_t count)
+{
+  uint16_t i;
+
+  for(i = 0; i < count; i++)
+  {
+    Transform_apply(transform, &data[i]);
+  }
+}
+
+// Compares Transform_apply() with ScaleData() over every raw X and Y value. Returns the number of
+// outputs that differ; the largest difference goes to <*worst>.
+static uint32_t compareScaling(uint16_t xResolution, uint16_t yResolution, uint32_t * worst)
+{
+  transform_t transform;
+  absData_t expected, actual;
+  uint32_t mismatches = 0;
+  uint32_t diff;
+  uint16_t value;
+
+  Transform_init(&transform, xResolution, yResolution, TRANSFORM_ROTATE_0);
+  *worst = 0;
+
+  for(value = 0; value <= PINNACLE_XMAX; value++)
+  {
+    expected.xValue = actual.xValue = value;
+    expected.yValue = actual.yValue = (value <= PINNACLE_YMAX) ? value : PINNACLE_YMAX;
+    referenceScale(&expected, xResolution, yResolution);
+    Transform_apply(&transform, &actual);
+
+    diff = (expected.xValue > actual.xValue) ? expected.xValue - actual.xValue : actual.xValue - expected.xValue;
+    if(diff) mismatches++;
+    if(diff > *worst) *worst = diff;
+    diff = (expected.yValue > actual.yValue) ? expected.yValue - actual.yValue : actual.yValue - expected.yValue;
+    if(diff) mismatches++;
+    if(diff > *worst) *worst = diff;
+  }
+  return mismatches;
+}
+
+static void fillPackets(absData_t * packets)
+{
+  uint16_t i;
+
+  for(i = 0; i < SCALE_PACKETS; i++)
+  {
+    packets[i].xValue = (uint16_t)((i * 331) % (PINNACLE_XMAX + 1));
+    packets[i].yValue = (uint16_t)((i * 197) % (PINNACLE_YMAX + 1));
+    packets[i].zValue = 30;
+  }
+}
+
+// CPU ns per packet for the four ways of scaling a batch of SCALE_PACKETS packets
+static void benchScaling(uint16_t xResolution, uint16_t yResolution, uint8_t orientation, double * ns)
+{
+  absData_t packets[SCALE_PACKETS];
+  transform_t transform;
+  uint64_t started;
+  uint32_t i;
+  int way;
+
+  Transform_init(&transform, xResolution, yResolution, orientation);
+
+  for(way = 0; way < 4; way++)
+  {
+    started = cpuNow();
+    for(i = 0; i < SCALE_COUNT / SCALE_PACKETS; i++)
+    {
+      fillPackets(packets);
+      if(way == 0) referenceScaleBatch(packets, SCALE_PACKETS, xResolution, yResolution, false);
+      else if(way == 1) referenceScaleBatch(packets, SCALE_PACKETS, xResolution, yResolution, true);
+      else if(way == 2) transformEach(&transform, packets, SCALE_PACKETS);
+      else Transform_applyBatch(&transform, packets, SCALE_PACKETS);
+    }
+    ns[way] = (double)(cpuNow() - started) / SCALE_COUNT;
+  }
+}
+
+// Prints the scaling comparison; returns false if Transform_apply() strays from ScaleData() by more
+// than it is documented to
+static bool reportScaling(bool check)
+{
+  static const uint16_t resolutions[][2] = { { 1024, 1024 }, { 800, 600 }, { 4096, 4096 }, { 65535, 65535 } };
+  uint32_t mismatches, worst;
+  double ns[4];
+  bool passed = true;
+  uint8_t i;
+
+  printf("\ncoordinate scaling (cpu ns/packet, batches of %u, refilling the batch included)\n", SCALE_PACKETS);
+  printf("%-14s %10s %10s %10s %10s %10s %10s\n", "resolution", "ScaleData", "soft div", "apply", "batch",
+    "mismatch", "worst");
+  for(i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]); i++)
+  {
+    mismatches = compareScaling(resolutions[i][0], resolutions[i][1], &worst);
+    benchScaling(resolutions[i][0], resolutions[i][1], TRANSFORM_ROTATE_0, ns);
+    printf("%5ux%-8u %10.2f %10.2f %10.2f %10.2f %10u %10u", resolutions[i][0], resolutions[i][1],
+      ns[0], ns[1], ns[2], ns[3], mismatches, worst);
+    if(check && (worst > 1 || (resolutions[i][0] <= 1024 && mismatches)))
+    {
+      passed = false;
+      printf("  OUT OF TOLERANCE");
+    }
+    printf("\n");
+  }
+  benchScaling(1024, 1024, TRANSFORM_ROTATE_90, ns);
+  printf("%-14s %10s %10s %10.2f %10.2f\n", "1024, rot 90", "-", "-", ns[2], ns[3]);
+
+  return passed;
+}
+
+// ___ Polar output ___
+
+#define POLAR_RADIUS          1024
+#define POLAR_MIN_RADIUS      64        // nearer the center the angle isn't checked, a count of X or Y is degrees there
+#define POLAR_MAX_ANGLE_ERROR 8         // binary angle (0.044 degree)
+#define POLAR_MAX_RADIUS_ERROR 1
+#define POLAR_COUNT           2000000
+
+// Polar_apply() in floating point, with atan2() and hypot() from libm
+static void referencePolar(const absData_t * data, polarData_t * output)
+{
+  double xOffset = (data->xValue - (PINNACLE_X_LOWER + PINNACLE_X_UPPER + 1) / 2) * (2.0 * POLAR_RADIUS / PINNACLE_X_RANGE);
+  double yOffset = (data->yValue - (PINNACLE_Y_LOWER + PINNACLE_Y_UPPER + 1) / 2) * (2.0 * POLAR_RADIUS / PINNACLE_Y_RANGE);
+  double angle = atan2(yOffset, xOffset) * (65536.0 / (2.0 * M_PI));
+
+  output->angle = (uint16_t)(int32_t)lround(angle < 0 ? angle + 65536.0 : angle);
+  output->radius = (uint16_t)lround(hypot(xOffset, yOffset));
+  output->zValue = data->zValue;
+  output->buttons = data->buttons;
+  output->hovering = data->hovering;
+}
+
+// Compares Polar_apply() with referencePolar() at every X/Y Pinnacle can report
+static void comparePolar(uint16_t * angleError, uint16_t * radiusError)
+{
+  polar_t polar;
+  polarData_t expected, actual;
+  absData_t data;
+  uint16_t diff;
+
+  memset(&data, 0, sizeof(data));
+  Polar_init(&polar, POLAR_RADIUS);
+  *angleError = *radiusError = 0;
+
+  for(data.yValue = 1; data.yValue <= PINNACLE_YMAX; data.yValue++)
+  {
+    for(data.xValue = 1; data.xValue <= PINNACLE_XMAX; data.xValue++)
+    {
+      referencePolar(&data, &expected);
+      Polar_apply(&polar, &data, &actual);
+
+      diff = (expected.radius > actual.radius) ? expected.radius - actual.radius : actual.radius - expected.radius;
+      if(diff > *radiusError) *radiusError = diff;
+      if(expected.radius < POLAR_MIN_RADIUS) continue;
+
+      diff = (uint16_t)(expected.angle - actual.angle);
+      if(diff > 0x8000) diff = (uint16_t)(0x10000 - diff);
+      if(diff > *angleError) *angleError = diff;
+    }
+  }
+}
+
+// CPU ns per packet of Polar_apply() (<fixed>) or referencePolar()
+static double benchPolar(bool fixed)
+{
+  absData_t packets[SCALE_PACKETS];
+  polarData_t output[SCALE_PACKETS];
+  polar_t polar;
+  uint64_t started;
+  uint32_t i, j, sum = 0;
+
+  Polar_init(&polar, POLAR_RADIUS);
+  fillPackets(packets);
+
+  started = cpuNow();
+  for(i = 0; i < POLAR_COUNT / SCALE_PACKETS; i++)
+  {
+    packets[i % SCALE_PACKETS].xValue ^= 1;     // so the loop can't be hoisted
+    for(j = 0; j < SCALE_PACKETS; j++)
+    {
+      if(fixed) Polar_apply(&polar, &packets[j], &output[j]);
+      else referencePolar(&packets[j], &output[j]);
+    }
+    sum += output[i % SCALE_PACKETS].angle;
+  }
+  started = cpuNow() - started;
+
+  if(sum == 1) printf(" ");
+  return (double)started / POLAR_COUNT;
+}
+
+// Prints the polar comparison; returns false if Polar_apply() strays from atan2()/hypot() by more
+// than it is documented to, or is no faster than them (on a host with an FPU; more so without one)
+static bool reportPolar(bool check)
+{
+  uint16_t angleError, radiusError;
+  double fixedNs, libmNs;
+  bool passed;
+
+  comparePolar(&angleError, &radiusError);
+  fixedNs = benchPolar(true);
+  libmNs = benchPolar(false);
+
+  printf("\npolar output (radius %u at the window edge, every reportable X/Y against atan2/hypot)\n", POLAR_RADIUS);
+  printf("%-24s %10s %10s\n", "", "Polar", "libm");
+  printf("%-24s %10.2f %10.2f\n", "cpu ns/packet", fixedNs, libmNs);
+  printf("worst angle error %u (%.4f degree, radius >= %u), worst radius error %u\n", angleError,
+    angleError * 360.0 / 65536, POLAR_MIN_RADIUS, radiusError);
+
+  passed = angleError <= POLAR_MAX_ANGLE_ERROR && radiusError <= POLAR_MAX_RADIUS_ERROR && fixedNs < libmNs;
+  if(check && !passed)
+  {
+    printf("polar output OUT OF TOLERANCE\n");
+    return false;
+  }
+  return true;
+}
+
+// ___ Motion filter ___
+
+#define FILTER_SAMPLES      300         // 3 s at 100 Hz
+#define FILTER_NOISE        6           // +/- counts, uniform: a curved overlay with the ADC attenuated
+#define FILTER_SLIDE_SPEED  1200        // counts per second
+#define FILTER_ROUNDS       2000
+#define FILTER_MAX_NS       100.0
+
+typedef struct _filterScore
+{
+  double stillNoise;    // rms error while holding still
+  double slideLag;      // how far behind the finger during the slide, in ms
+  double rmsError;      // over the whole script
+  double nsPerPacket;
+} filterScore_t;
+
+// Where the finger of the filter script is at <sample>: holding still, sliding right at
+// FILTER_SLIDE_SPEED, holding again, then a circle. Sets <*phase> to 0 (still), 1 (slide) or 2 (circle).
+static void filterTruth(uint16_t sample, double * x, double * y, uint8_t * phase)
+{
+  double t = sample * 0.01;
+
+  if(t < 1.0) { *x = 700; *y = 700; *phase = 0; }
+  else if(t < 1.5) { *x = 700 + FILTER_SLIDE_SPEED * (t - 1.0); *y = 700; *phase = 1; }
+  else if(t < 2.0) { *x = 700 + FILTER_SLIDE_SPEED * 0.5; *y = 700; *phase = 0; }
+  else
+  {
+    *x = 1000 + 300 * cos(2 * M_PI * (t - 2.0));
+    *y = 700 + 300 * sin(2 * M_PI * (t - 2.0));
+    *phase = 2;
+  }
+}
+
+// The filter script with noise, the same every time
+static void filterInput(absData_t * packets)
+{
+  uint32_t seed = 12345;
+  double x, y;
+  uint8_t phase;
+  uint16_t i;
+
+  for(i = 0; i < FILTER_SAMPLES; i++)
+  {
+    filterTruth(i, &x, &y, &phase);
+    seed = seed * 1103515245u + 12345u;
+    packets[i].xValue = (uint16_t)lround(x + (int32_t)((seed >> 16) % (2 * FILTER_NOISE + 1)) - FILTER_NOISE);
+    seed = seed * 1103515245u + 12345u;
+    packets[i].yValue = (uint16_t)lround(y + (int32_t)((seed >> 16) % (2 * FILTER_NOISE + 1)) - FILTER_NOISE);
+    packets[i].zValue = 40;
+  }
+}
+
+// Runs the filter script through MotionFilter_apply() with <config>, or unfiltered if it is NULL
+static void scoreFilter(const motionFilterConfig_t * config, filterScore_t * score)
+{
+  absData_t input[FILTER_SAMPLES], output[FILTER_SAMPLES];
+  motionFilter_t filter;
+  double x, y, stillSum = 0, lagSum = 0, errorSum = 0;
+  uint32_t still = 0, slide = 0, round;
+  uint64_t started;
+  uint8_t phase;
+  uint16_t i;
+
+  filterInput(input);
+  started = cpuNow();
+  for(round = 0; round < FILTER_ROUNDS; round++)
+  {
+    memcpy(output, input, sizeof(output));
+    MotionFilter_init(&filter);
+    for(i = 0; config && i < FILTER_SAMPLES; i++)
+    {
+      MotionFilter_apply(&filter, config, &output[i], i * 10000u);
+    }
+  }
+  score->nsPerPacket = (double)(cpuNow() - started) / ((double)FILTER_ROUNDS * FILTER_SAMPLES);
+
+  for(i = 0; i < FILTER_SAMPLES; i++)
+  {
+    filterTruth(i, &x, &y, &phase);
+    x -= output[i].xValue;
+    y -= output[i].yValue;
+    errorSum += x * x + y * y;
+    if(phase == 0 && (i % 100) >= 20)   // settled
+    {
+      stillSum += x * x + y * y;
+      still++;
+    }
+    if(phase == 1 && (i % 100) >= 10)
+    {
+      lagSum += x;
+      slide++;
+    }
+  }
+  score->stillNoise = sqrt(stillSum / still);
+  score->slideLag = lagSum / slide * 1000.0 / FILTER_SLIDE_SPEED;
+  score->rmsError = sqrt(errorSum / FILTER_SAMPLES);
+}
+
+// Prints the filter comparison; returns false if the default filter doesn't at least halve the noise
+// of a still finger, if prediction doesn't cut its lag, or if a packet costs more than FILTER_MAX_NS
+static bool reportFilter(bool check)
+{
+  motionFilterConfig_t config;
+  filterScore_t raw, smoothed, predicted;
+
+  MotionFilter_initConfig(&config);
+  scoreFilter(&config, &predicted);
+  config.predictMicros = 0;
+  scoreFilter(&config, &smoothed);
+  scoreFilter(NULL, &raw);
+
+  printf("\nmotion filter (hold, slide at %u counts/s, hold, circle; +/-%u counts of noise at 100 Hz)\n",
+    FILTER_SLIDE_SPEED, FILTER_NOISE);
+  printf("%-22s %12s %12s %12s %12s\n", "output", "still rms", "slide lag ms", "rms error", "cpu ns/pkt");
+  printf("%-22s %12.2f %12.1f %12.2f %12s\n", "raw", raw.stillNoise, raw.slideLag, raw.rmsError, "-");
+  printf("%-22s %12.2f %12.1f %12.2f %12.2f\n", "1-euro", smoothed.stillNoise, smoothed.slideLag,
+    smoothed.rmsError, smoothed.nsPerPacket);
+  MotionFilter_initConfig(&config);
+  printf("1-euro, %2u ms ahead    %12.2f %12.1f %12.2f %12.2f\n", config.predictMicros / 1000, predicted.stillNoise,
+    predicted.slideLag, predicted.rmsError, predicted.nsPerPacket);
+
+  if(check && (predicted.stillNoise > raw.stillNoise / 2 || predicted.slideLag >= smoothed.slideLag ||
+    predicted.nsPerPacket > FILTER_MAX_NS))
+  {
+    printf("motion filter FAILED\n");
+    return false;
+  }
+  return true;
+}
+
+// ___ Pointer motion ___
+
+#define POINTER_FRAMES      10          // 1 ms USB frames per 100 Hz packet
+#define POINTER_ROUNDS      20000
+#define POINTER_MAX_NS      100.0
+
+typedef struct _pointerScenario
+{
+  const char * name;
+  int16_t deltas[4];      // X deltas of the packets, repeated
+  uint16_t packets;
+} pointerScenario_t;
+
+static const pointerScenario_t pointerScenarios[] =
+{
+  { "slow drag",      { 1, 1, 1, 1 },         400 },
+  { "slower drag",    { 1, 0, 0, 0 },         400 },
+  { "steady slide",   { 8, 8, 8, 8 },         100 },
+  { "back and forth", { 5, -5, 3, -3 },       400 },
+  { "fast flick",     { 200, 200, 200, 200 }, 20 },
+};
+#define POINTER_SCENARIOS (sizeof(pointerScenarios) / sizeof(pointerScenarios[0]))
+
+typedef struct _pointerScore
+{
+  double wanted;        // pixels the curve asks for
+  int32_t legacy;       // Mouse.move() of the raw deltas, as the sample sketches do
+  int32_t rounded;      // the curve applied to each packet on its own, clipped to a report
+  int32_t moved;        // through Pointer_add() and Pointer_nextReport()
+  uint32_t reports;
+  int32_t maxPerPacket; // most pixels reported in one packet period
+} pointerScore_t;
+
+static void scorePointer(const pointerScenario_t * scenario, pointerScore_t * score)
+{
+  pointer_t pointer;
+  int32_t xDelta, gain, perPacket;
+  uint16_t i, frame;
+  int8_t xMove, yMove;
+
+  memset(score, 0, sizeof(pointerScore_t));
+  Pointer_init(&pointer);
+
+  for(i = 0; i < scenario->packets + 100; i++)    // and 100 packet periods to drain
+  {
+    perPacket = 0;
+    if(i < scenario->packets)
+    {
+      xDelta = scenario->deltas[i % 4];
+      gain = pointer.gain[(abs(xDelta) < POINTER_CURVE_SIZE) ? abs(xDelta) : POINTER_CURVE_SIZE - 1];
+      score->wanted += (double)xDelta * gain / POINTER_GAIN_ONE;
+      score->legacy += (int8_t)xDelta;
+      perPacket = xDelta * gain / POINTER_GAIN_ONE;
+      score->rounded += (perPacket > POINTER_MAX_REPORT) ? POINTER_MAX_REPORT :
+        (perPacket < -POINTER_MAX_REPORT) ? -POINTER_MAX_REPORT : perPacket;
+      Pointer_add(&pointer, (int16_t)xDelta, 0);
+      perPacket = 0;
+    }
+    for(frame = 0; frame < POINTER_FRAMES; frame++)
+    {
+      if(!Pointer_nextReport(&pointer, &xMove, &yMove)) break;
+      score->moved += xMove;
+      perPacket += abs(xMove);
+      score->reports++;
+    }
+    if(perPacket > score->maxPerPacket) score->maxPerPacket = perPacket;
+  }
+}
+
+// CPU ns per packet of Pointer_add() followed by the reports it makes
+static double benchPointer(void)
+{
+  pointer_t pointer;
+  uint64_t started;
+  uint32_t round;
+  int32_t sum = 0;
+  int8_t xMove, yMove;
+  uint8_t i;
+
+  Pointer_init(&pointer);
+  started = cpuNow();
+  for(round = 0; round < POINTER_ROUNDS; round++)
+  {
+    for(i = 0; i < POINTER_SCENARIOS; i++)
+    {
+      Pointer_add(&pointer, pointerScenarios[i].deltas[round % 4], (int16_t)(round & 7) - 3);
+      while(Pointer_nextReport(&pointer, &xMove, &yMove)) sum += xMove + yMove;
+    }
+  }
+  started = cpuNow() - started;
+
+  if(sum == 1) printf(" ");
+  return (double)started / ((double)POINTER_ROUNDS * POINTER_SCENARIOS);
+}
+
+// Prints what each way of moving the pointer delivers; returns false if Pointer ends up more than a
+// pixel from what the curve asks for, or a packet costs more than POINTER_MAX_NS
+static bool reportPointer(bool check)
+{
+  pointerScore_t score;
+  bool passed = true;
+  double nsPerPacket;
+  uint8_t i;
+
+  printf("\npointer motion (X pixels, default curve, 100 Hz packets, a report per 1 ms frame)\n");
+  printf("%-16s %10s %10s %10s %10s %10s %12s\n", "stroke", "raw 1:1", "wanted", "per packet", "Pointer",
+    "reports", "max px/pkt");
+  for(i = 0; i < POINTER_SCENARIOS; i++)
+  {
+    scorePointer(&pointerScenarios[i], &score);
+    printf("%-16s %10d %10.1f %10d %10d %10u %12d", pointerScenarios[i].name, score.legacy, score.wanted,
+      score.rounded, score.moved, score.reports, score.maxPerPacket);
+    if(fabs(score.moved - score.wanted) >= 1.0)
+    {
+      passed = false;
+      printf("  OFF");
+    }
+    printf("\n");
+  }
+  nsPerPacket = benchPointer();
+  printf("cpu %.1f ns/packet\n", nsPerPacket);
+
+  if(check && (!passed || nsPerPacket > POINTER_MAX_NS))
+  {
+    printf("pointer motion FAILED\n");
+    return false;
+  }
+  return true;
+}
+
+// ___ HID reports ___
+
+#define HID_TICK_US         50          // how often loop() asks for a report
+#define HID_PACKET_US       10000       // 100 Hz packets from each pad
+#define HID_DRAIN_US        100000
+#define HID_ROUNDS          20000
+#define HID_MAX_NS          100.0
+
+typedef struct _hidPadScript
+{
+  int8_t xDelta;
+  int8_t wheelCount;
+  uint16_t pressAt;       // the primary button is down from this packet...
+  uint16_t releaseAt;     // ...up to this one; equal for no press
+  uint16_t offset;        // us before the pad's first packet
+} hidPadScript_t;
+
+typedef struct _hidScenario
+{
+  const char * name;
+  uint16_t packets;       // per pad
+  uint8_t pads;
+  hidPadScript_t pad[HID_REPORT_MAX_PADS];
+} hidScenario_t;
+
+static const hidScenario_t hidScenarios[] =
+{
+  { "tap",         40,  1, { { 0, 0, 10, 13, 0 } } },
+  { "held drag",   100, 1, { { 3, 0, 5, 95, 0 } } },
+  { "scroll",      100, 1, { { 0, 2, 0, 0, 0 } } },
+  { "fast flick",  20,  1, { { 120, 0, 0, 0, 0 } } },
+  { "two in step", 100, 2, { { 4, 0, 0, 0, 0 }, { 2, 1, 0, 0, 0 } } },
+  { "two apart",   100, 2, { { 4, 0, 0, 0, 0 }, { -2, 1, 20, 60, 400 } } },
+  { "two taps",    40,  2, { { 0, 0, 10, 12, 0 }, { 0, 0, 11, 14, 5000 } } },
+};
+#define HID_SCENARIOS (sizeof(hidScenarios) / sizeof(hidScenarios[0]))
+
+typedef struct _hidScore
+{
+  uint32_t packets;
+  uint32_t legacyReports;   // the sample sketches: Mouse.move() per packet, Mouse.click() (two more) per button packet
+  uint32_t legacyClicks;
+  uint32_t presses;         // primary going down on the pads, merged
+  uint32_t reports;
+  uint32_t clicks;          // primary going down in the reports
+  uint32_t maxLatency;      // us from a packet to the next report
+  uint32_t closest;         // us between the closest two reports
+  double wantedX;
+  int32_t movedX;
+  int32_t wantedWheel;
+  int32_t wheel;
+} hidScore_t;
+
+// Runs <scenario> through a scheduler polled every HID_TICK_US, as a sketch's loop() would
+static void scoreHid(const hidScenario_t * scenario, hidScore_t * score)
+{
+  hidScheduler_t scheduler;
+  hidReport_t report;
+  relData_t packet;
+  pointer_t reference;
+  const hidPadScript_t * script;
+  uint16_t sent[HID_REPORT_MAX_PADS] = { 0 };
+  uint8_t padButtons[HID_REPORT_MAX_PADS] = { 0 };
+  uint8_t buttons, merged = 0, lastButtons = 0;
+  uint32_t now, end, lastReportAt = 0, pendingSince = 0;
+  bool pending = false;
+  uint8_t pad, i;
+
+  memset(score, 0, sizeof(hidScore_t));
+  score->closest = UINT32_MAX;
+  HidReport_init(&scheduler, HID_REPORT_FRAME_US);
+  Pointer_init(&reference);
+
+  end = (uint32_t)scenario->packets * HID_PACKET_US + HID_DRAIN_US;
+  for(now = 0; now < end; now += HID_TICK_US)
+  {
+    for(pad = 0; pad < scenario->pads; pad++)
+    {
+      script = &scenario->pad[pad];
+      if(sent[pad] >= scenario->packets || now != script->offset + (uint32_t)sent[pad] * HID_PACKET_US) continue;
+
+      packet.buttons = (sent[pad] >= script->pressAt && sent[pad] < script->releaseAt) ? 0x01 : 0;
+      packet.xDelta = script->xDelta;
+      packet.yDelta = 0;
+      packet.wheelCount = script->wheelCount;
+      sent[pad]++;
+
+      score->packets++;
+      score->legacyReports += packet.buttons ? 3 : 1;
+      score->legacyClicks += packet.buttons;
+      score->wantedX += (double)packet.xDelta * reference.gain[abs(packet.xDelta) < POINTER_CURVE_SIZE ?
+        abs(packet.xDelta) : POINTER_CURVE_SIZE - 1] / POINTER_GAIN_ONE;
+      score->wantedWheel += packet.wheelCount;
+
+      padButtons[pad] = packet.buttons;
+      for(buttons = 0, i = 0; i < HID_REPORT_MAX_PADS; i++) buttons |= padButtons[i];
+      if(buttons && !merged) score->presses++;
+      merged = buttons;
+
+      HidReport_addPacket(&scheduler, pad, &packet);
+      if(!pending) pendingSince = now;
+      pending = true;
+    }
+
+    if(HidReport_next(&scheduler, now, &report))
+    {
+      if(score->reports > 0 && now - lastReportAt < score->closest) score->closest = now - lastReportAt;
+      if(pending && now - pendingSince > score->maxLatency) score->maxLatency = now - pendingSince;
+      if((report.buttons & 0x01) && !(lastButtons & 0x01)) score->clicks++;
+      lastButtons = report.buttons;
+      score->movedX += report.xMove;
+      score->wheel += report.wheel;
+      score->reports++;
+      lastReportAt = now;
+      pending = false;
+    }
+    else if(score->reports == 0 || now - lastReportAt >= HID_REPORT_FRAME_US)
+    {
+      pending = false;      // free to report and nothing to say: a fraction of a pixel
+    }
+  }
+}
+
+// CPU ns per packet of HidReport_addPacket() followed by HidReport_next()
+static double benchHid(void)
+{
+  hidScheduler_t scheduler;
+  hidReport_t report;
+  relData_t packet;
+  uint64_t started;
+  uint32_t round;
+  int32_t sum = 0;
+
+  HidReport_init(&scheduler, HID_REPORT_FRAME_US);
+  started = cpuNow();
+  for(round = 0; round < HID_ROUNDS; round++)
+  {
+    packet.buttons = (round >> 4) & 0x01;
+    packet.xDelta = (int8_t)((round & 15) - 7);
+    packet.yDelta = (int8_t)((round & 7) - 3);
+    packet.wheelCount = (int8_t)(round & 1);
+    HidReport_addPacket(&scheduler, round & 1, &packet);
+    if(HidReport_next(&scheduler, round * HID_REPORT_FRAME_US, &report)) sum += report.xMove + report.wheel;
+  }
+  started = cpuNow() - started;
+
+  if(sum == 1) printf(" ");
+  return (double)started / HID_ROUNDS;
+}
+
+// Prints the USB traffic of each scenario; returns false if a press is lost or doubled, motion or
+// scroll goes missing, two reports share a frame, a packet waits a frame or more for its report, or a
+// packet costs more than HID_MAX_NS
+static bool reportHid(bool check)
+{
+  hidScore_t score;
+  bool passed = true;
+  double nsPerPacket;
+  uint8_t i;
+
+  printf("\nHID reports (100 Hz packets per pad, 1 ms frames, loop() every %d us)\n", HID_TICK_US);
+  printf("%-12s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n", "stroke", "packets", "old rpts", "old clks", "reports",
+    "clicks", "presses", "wait us", "gap us", "X, wheel");
+  for(i = 0; i < HID_SCENARIOS; i++)
+  {
+    scoreHid(&hidScenarios[i], &score);
+    printf("%-12s %8u %8u %8u %8u %8u %8u %8u %8u %4d,%3d", hidScenarios[i].name, score.packets, score.legacyReports,
+      score.legacyClicks, score.reports, score.clicks, score.presses, score.maxLatency, score.closest, score.movedX,
+      score.wheel);
+    if(score.clicks != score.presses || fabs(score.movedX - score.wantedX) >= 1.0 || score.wheel != score.wantedWheel ||
+      score.closest < HID_REPORT_FRAME_US || score.maxLatency >= HID_REPORT_FRAME_US)
+    {
+      passed = false;
+      printf("  OFF");
+    }
+    printf("\n");
+  }
+  nsPerPacket = benchHid();
+  printf("cpu %.1f ns/packet\n", nsPerPacket);
+
+  if(check && (!passed || nsPerPacket > HID_MAX_NS))
+  {
+    printf("HID reports FAILED\n");
+    return false;
+  }
+  return true;
+}
+
+// ___ Hover map ___
+
+#define HOVER_COUNT       1000000
+#define HOVER_SWEEP_DEPTH 4       // the sweep hovers from the ceiling down to this many counts below it
+#define HOVER_MIN_KEPT    95      // % of the sweep's samples the learned map must call hovering
+
+// The hand-tuned zone table Pinnacle_applyCurvedThresh() used to index directly
+static const uint8_t zoneThresholds[HOVER_MAP_ROWS][HOVER_MAP_COLS] =
+{
+  {0, 0,  0,  0,  0,  0, 0, 0},
+  {0, 2,  3,  5,  5,  3, 2, 0},
+  {0, 3,  5, 15, 15,  5, 2, 0},
+  {0, 3,  5, 15, 15,  5, 3, 0},
+  {0, 2,  3,  5,  5,  3, 2, 0},
+  {0, 0,  0,  0,  0,  0, 0, 0},
+};
+
+// The previous per-packet test, kept for comparison (not inlined, as it was a call from decodeAbsolute)
+static __attribute__((noinline)) bool zoneIsHovering(const absData_t * data)
+{
+  return !(data->zValue > zoneThresholds[data->yValue / ZONESCALE][data->xValue / ZONESCALE]);
+}
+
+// Model of a curved overlay: the highest Z a hovering finger produces, high in the middle where the
+// overlay bulges towards the finger and falling off smoothly to the edges
+static uint8_t hoverCeiling(uint16_t xValue, uint16_t yValue)
+{
+  double dx = (xValue - PINNACLE_XMAX / 2.0) / (PINNACLE_XMAX / 2.0);
+  double dy = (yValue - PINNACLE_YMAX / 2.0) / (PINNACLE_YMAX / 2.0);
+  double bump = (1.0 - dx * dx) * (1.0 - dy * dy);
+
+  return (uint8_t)(bump * bump * 16.0);
+}
+
+// Classifies a grid of positions twice, once just at the model's hover ceiling (should hover) and
+// once a few counts above it (should not); returns the percentage classified correctly
+static double hoverAccuracy(const hoverMap_t * map, bool zoneTable)
+{
+  absData_t data;
+  uint32_t correct = 0;
+  uint32_t total = 0;
+  bool hovering;
+  uint8_t pass;
+
+  for(data.yValue = 0; data.yValue <= PINNACLE_YMAX; data.yValue += 16)
+  {
+    for(data.xValue = 0; data.xValue <= PINNACLE_XMAX; data.xValue += 16)
+    {
+      for(pass = 0; pass < 2; pass++)
+      {
+        data.zValue = hoverCeiling(data.xValue, data.yValue) + (pass ? 3 : 0);
+        hovering = zoneTable ? zoneIsHovering(&data) : HoverMap_isHovering(map, &data);
+        if(hovering == (pass == 0)) correct++;
+        total++;
+      }
+    }
+  }
+  return 100.0 * correct / total;
+}
+
+// Largest change of the threshold (in Z counts) between neighbouring X positions, over all rows
+static double hoverMaxStep(const hoverMap_t * map, bool zoneTable)
+{
+  double previous, current;
+  double worst = 0;
+  uint16_t x, y;
+
+  for(y = 0; y <= PINNACLE_YMAX; y += 8)
+  {
+    previous = -1;
+    for(x = 0; x <= PINNACLE_XMAX; x++)
+    {
+      current = zoneTable ? zoneThresholds[y / ZONESCALE][x / ZONESCALE] : HoverMap_threshold(map, x, y) / 256.0;
+      if(previous >= 0 && current - previous > worst) worst = current - previous;
+      if(previous >= 0 && previous - current > worst) worst = previous - current;
+      previous = current;
+    }
+  }
+  return worst;
+}
+
+// CPU ns per packet to classify a batch of SCALE_PACKETS packets
+static double benchHoverLookup(const hoverMap_t * map, bool zoneTable)
+{
+  absData_t packets[SCALE_PACKETS];
+  uint32_t hovering = 0;
+  uint64_t started;
+  uint32_t i, j;
+
+  fillPackets(packets);
+  started = cpuNow();
+  for(i = 0; i < HOVER_COUNT / SCALE_PACKETS; i++)
+  {
+    for(j = 0; j < SCALE_PACKETS; j++)
+    {
+      packets[j].zValue = (uint8_t)((i + j) & 0x1F);
+      hovering += zoneTable ? zoneIsHovering(&packets[j]) : HoverMap_isHovering(map, &packets[j]);
+    }
+  }
+  started = cpuNow() - started;
+  if(hovering == 0xFFFFFFFF) printf("\n");   // keep the result live
+  return (double)started / HOVER_COUNT;
+}
+
+// Prints the hover-map comparison; returns false if the map disagrees with the zone table at the zone
+// centers, the learned map isn't more accurate than the zone table or calls too many of the sweep's
+// own samples touches, or a saved map doesn't load back
+static bool reportHoverMap(bool check)
+{
+  hoverMap_t defaults, learned, loaded;
+  hoverLearn_t learn;
+  absData_t data;
+  uint8_t blob[HOVER_MAP_BLOB_SIZE];
+  uint32_t centerMismatches = 0;
+  uint32_t sweepSamples = 0, sweepHovering = 0;
+  uint8_t row, col, nodes, ceiling, depth;
+  bool roundTrip, corruptRejected;
+  bool passed = true;
+
+  HoverMap_init(&defaults, zoneThresholds);
+
+  // at the zone centers the interpolated map must give the old answer for every Z
+  for(row = 0; row < HOVER_MAP_ROWS; row++)
+  {
+    for(col = 0; col < HOVER_MAP_COLS; col++)
+    {
+      data.xValue = col * ZONESCALE + ZONESCALE / 2;
+      data.yValue = row * ZONESCALE + ZONESCALE / 2;
+      for(data.zValue = 0; data.zValue < 64; data.zValue++)
+      {
+        if(HoverMap_isHovering(&defaults, &data) != zoneIsHovering(&data)) centerMismatches++;
+      }
+    }
+  }
+
+  // calibration sweep: a finger moved over the whole pad at varying heights, from the hover ceiling
+  // down to HOVER_SWEEP_DEPTH counts below it, as a hand would
+  learned = defaults;
+  HoverMap_beginLearning(&learn);
+  for(data.yValue = 8; data.yValue <= PINNACLE_YMAX; data.yValue += 32)
+  {
+    for(data.xValue = 8; data.xValue <= PINNACLE_XMAX; data.xValue += 32)
+    {
+      ceiling = hoverCeiling(data.xValue, data.yValue);
+      depth = ((data.xValue + data.yValue) / 32) % (HOVER_SWEEP_DEPTH + 1);
+      data.zValue = (ceiling > depth) ? ceiling - depth : 1;
+      HoverMap_learn(&learn, &data);
+    }
+  }
+  nodes = HoverMap_finishLearning(&learn, &learned);
+
+  // the learned map must call the sweep's own samples hovering, at every height
+  for(data.yValue = 8; data.yValue <= PINNACLE_YMAX; data.yValue += 32)
+  {
+    for(data.xValue = 8; data.xValue <= PINNACLE_XMAX; data.xValue += 32)
+    {
+      ceiling = hoverCeiling(data.xValue, data.yValue);
+      depth = ((data.xValue + data.yValue) / 32) % (HOVER_SWEEP_DEPTH + 1);
+      data.zValue = (ceiling > depth) ? ceiling - depth : 1;
+      sweepSamples++;
+      if(HoverMap_isHovering(&learned, &data)) sweepHovering++;
+    }
+  }
+
+  HoverMap_save(&learned, blob);
+  roundTrip = HoverMap_load(&loaded, blob) && memcmp(&loaded, &learned, sizeof(loaded)) == 0;
+  blob[10] ^= 0x01;
+  corruptRejected = !HoverMap_load(&loaded, blob);
+
+  printf("\nhover map (curved overlay, %u x %u nodes)\n", HOVER_MAP_COLS, HOVER_MAP_ROWS);
+  printf("%-18s %10s %10s %10s\n", "map", "cpu ns/pkt", "max step", "accuracy %");
+  printf("%-18s %10.2f %10.2f %10.1f\n", "zone table", benchHoverLookup(&defaults, true),
+    hoverMaxStep(&defaults, true), hoverAccuracy(&defaults, true));
+  printf("%-18s %10.2f %10.2f %10.1f\n", "interpolated", benchHoverLookup(&defaults, false),
+    hoverMaxStep(&defaults, false), hoverAccuracy(&defaults, false));
+  printf("%-18s %10.2f %10.2f %10.1f\n", "learned", benchHoverLookup(&learned, false),
+    hoverMaxStep(&learned, false), hoverAccuracy(&learned, false));
+  printf("nodes learned %u, center mismatches %u, blob %u bytes, round trip %s, corruption %s\n", nodes,
+    centerMismatches, HOVER_MAP_BLOB_SIZE, roundTrip ? "ok" : "FAILED", corruptRejected ? "rejected" : "ACCEPTED");
+  printf("sweep samples the learned map calls hovering: %.1f %%\n", 100.0 * sweepHovering / sweepSamples);
+
+  if(check && (centerMismatches || !roundTrip || !corruptRejected || sweepHovering * 100 < sweepSamples * HOVER_MIN_KEPT ||
+    hoverAccuracy(&learned, false) <= hoverAccuracy(&defaults, true)))
+  {
+    passed = false;
+    printf("hover map OUT OF TOLERANCE\n");
+  }
+
+  return passed;
+}
+
+// ___ Serial output ___
+
+#define OUTPUT_REPORTS  100000
+#define UART_BYTES_PER_SECOND  11520    // 115200 baud, 8N1
+
+static uint32_t _outputBytes;
+static uint32_t _outputWrites;
+static telemetryReader_t _outputReader;
+static uint32_t _outputMismatches;
+static uint32_t _outputDecoded;
+static absData_t _outputSent[TELEMETRY_MAX_BATCH];
+
+static void countWrite(uint32_t bytes)
+{
+  _outputBytes += bytes;
+  _outputWrites++;
+}
+
+// The per-report text of the sample sketches: five fields, each printed on its own
+static void writeText(const absData_t * data)
+{
+  char field[8];
+
+  countWrite(snprintf(field, sizeof(field), "%u", data->xValue));
+  countWrite(1);
+  countWrite(snprintf(field, sizeof(field), "%u", data->yValue));
+  countWrite(1);
+  countWrite(snprintf(field, sizeof(field), "%u", data->zValue));
+  countWrite(1);
+  countWrite(snprintf(field, sizeof(field), "%u", data->buttons));
+  countWrite(1);
+  countWrite(data->hovering ? 10 : 7);    // "hovering\r\n" or "valid\r\n"
+}
+
+// Telemetry sink: counts the frame and checks that it decodes back to the reports sent
+static void writeFrame(const uint8_t * frame, uint16_t length)
+{
+  uint16_t i;
+  uint8_t j;
+
+  countWrite(length);
+  for(i = 0; i < length; i++)
+  {
+    if(!Telemetry_feed(&_outputReader, frame[i])) continue;
+
+    for(j = 0; j < _outputReader.count; j++)
+    {
+      if((uint16_t)_outputReader.records[j].xValue != _outputSent[j].xValue ||
+        (uint16_t)_outputReader.records[j].yValue != _outputSent[j].yValue ||
+        (uint8_t)_outputReader.records[j].zValue != _outputSent[j].zValue) _outputMismatches++;
+    }
+    _outputDecoded += _outputReader.count;
+  }
+}
+
+// Prints the text versus telemetry comparison; returns false if telemetry didn't round-trip
+static bool reportOutput(bool check)
+{
+  absData_t packets[SCALE_PACKETS];
+  telemetry_t telemetry;
+  uint64_t started, textNanos, binaryNanos;
+  uint32_t textBytes, textWrites;
+  uint32_t i;
+  bool passed = true;
+
+  fillPackets(packets);
+
+  _outputBytes = _outputWrites = 0;
+  started = cpuNow();
+  for(i = 0; i < OUTPUT_REPORTS; i++)
+  {
+    writeText(&packets[i % SCALE_PACKETS]);
+  }
+  textNanos = cpuNow() - started;
+  textBytes = _outputBytes;
+  textWrites = _outputWrites;
+
+  _outputBytes = _outputWrites = 0;
+  _outputMismatches = _outputDecoded = 0;
+  Telemetry_initReader(&_outputReader);
+  Telemetry_init(&telemetry, 8, 0, writeFrame);
+  started = cpuNow();
+  for(i = 0; i < OUTPUT_REPORTS; i++)
+  {
+    _outputSent[telemetry.count] = packets[i % SCALE_PACKETS];
+    Telemetry_addAbsolute(&telemetry, &packets[i % SCALE_PACKETS], i & 1, 0);
+  }
+  Telemetry_flush(&telemetry);
+  binaryNanos = cpuNow() - started;    // includes decoding every frame back
+
+  printf("\nserial output (%u absolute reports)\n", OUTPUT_REPORTS);
+  printf("%-18s %10s %10s %10s %14s\n", "format", "bytes/rpt", "writes/rpt", "cpu ns/rpt", "rpts/s 115200");
+  printf("%-18s %10.2f %10.2f %10.2f %14.0f\n", "text, per field", (double)textBytes / OUTPUT_REPORTS,
+    (double)textWrites / OUTPUT_REPORTS, (double)textNanos / OUTPUT_REPORTS,
+    UART_BYTES_PER_SECOND / ((double)textBytes / OUTPUT_REPORTS));
+  printf("%-18s %10.2f %10.3f %10.2f %14.0f\n", "telemetry, 8/frame", (double)_outputBytes / OUTPUT_REPORTS,
+    (double)_outputWrites / OUTPUT_REPORTS, (double)binaryNanos / OUTPUT_REPORTS,
+    UART_BYTES_PER_SECOND / ((double)_outputBytes / OUTPUT_REPORTS));
+  printf("decoded %u, lost %u, crc errors %u, mismatches %u\n", _outputDecoded, _outputReader.lost,
+    _outputReader.crcErrors, _outputMismatches);
+
+  if(check && (_outputDecoded != OUTPUT_REPORTS || _outputReader.lost || _outputReader.crcErrors || _outputMismatches))
+  {
+    passed = false;
+    printf("telemetry OUT OF TOLERANCE\n");
+  }
+  return passed;
+}
+
+// ___ Text formatting ___
+
+#define FORMAT_LINES    100000
+
+// Model of the Arduino String the Command Panel used to build its lines with: every concatenation
+// that outgrows the buffer reallocates it to the exact new length, and temporaries such as
+// String(i) or "SENS_" + String(i) allocate their own buffer
+typedef struct _heapString
+{
+  char * buffer;
+  uint16_t length;
+  uint16_t capacity;
+} heapString_t;
+
+static uint32_t _allocations;
+
+static void heapConcat(heapString_t * string, const char * text, uint16_t length)
+{
+  if(string->length + length > string->capacity)
+  {
+    string->capacity = string->length + length;
+    string->buffer = realloc(string->buffer, string->capacity + 1);
+    _allocations++;
+  }
+  memcpy(string->buffer + string->length, text, length);
+  string->length += length;
+  string->buffer[string->length] = '\0';
+}
+
+static void heapConcatText(heapString_t * string, const char * text)
+{
+  heapConcat(string, text, (uint16_t)strlen(text));
+}
+
+// String::concat(unsigned) and String(unsigned): utoa() into a local buffer, one division per digit
+static void heapConcatNumber(heapString_t * string, int32_t value)
+{
+  char digits[12];
+  char * next = &digits[11];
+  uint32_t magnitude = (value < 0) ? 0 - (uint32_t)value : (uint32_t)value;
+
+  *next = '\0';
+  do
+  {
+    *--next = (char)('0' + magnitude % 10);
+    magnitude /= 10;
+  } while(magnitude);
+  if(value < 0) *--next = '-';
+  heapConcatText(string, next);
+}
+
+static void heapFree(heapString_t * string)
+{
+  free(string->buffer);
+  memset(string, 0, sizeof(heapString_t));
+}
+
+// One line of the panel's two-pad output, the way the String code built it
+static void formatHeapLine(heapString_t * line, const touchData_t * touchData, uint8_t count)
+{
+  heapString_t temporary = { NULL, 0, 0 };
+  heapString_t number = { NULL, 0, 0 };
+  uint8_t i;
+
+  for(i = 0; i < count; i++)
+  {
+    if(line->length != 0) heapConcatText(line, "\t");
+    heapConcatText(&temporary, "SENS_");    // "SENS_" + String(i) + " "
+    heapConcatNumber(&number, i);
+    heapConcat(&temporary, number.buffer, number.length);
+    heapConcatText(&temporary, " ");
+    heapConcat(line, temporary.buffer, temporary.length);
+    heapFree(&temporary);
+    heapFree(&number);
+
+    heapConcatNumber(line, touchData[i].absolute.xValue);
+    heapConcatText(line, "\t");
+    heapConcatNumber(line, touchData[i].absolute.yValue);
+    heapConcatText(line, "\t");
+    heapConcatNumber(line, touchData[i].absolute.zValue);
+    heapConcatText(line, touchData[i].absolute.hovering ? " - h\t" : " - v\t");
+  }
+  heapConcatNumber(&number, touchData[0].absolute.buttons);
+  heapConcat(line, number.buffer, number.length);
+  heapFree(&number);
+}
+
+// The same line through TextFormat, as the panel builds it now
+static void formatTextLine(textFormat_t * line, const touchData_t * touchData, uint8_t count)
+{
+  uint8_t i;
+
+  for(i = 0; i < count; i++)
+  {
+    if(line->length != 0) TextFormat_appendChar(line, '\t');
+    TextFormat_appendString(line, "SENS_");
+    TextFormat_appendUnsigned(line, i);
+    TextFormat_appendChar(line, ' ');
+    TextFormat_appendUnsigned(line, touchData[i].absolute.xValue);
+    TextFormat_appendChar(line, '\t');
+    TextFormat_appendUnsigned(line, touchData[i].absolute.yValue);
+    TextFormat_appendChar(line, '\t');
+    TextFormat_appendUnsigned(line, touchData[i].absolute.zValue);
+    TextFormat_appendString(line, touchData[i].absolute.hovering ? " - h\t" : " - v\t");
+  }
+  TextFormat_appendUnsigned(line, touchData[0].absolute.buttons);
+}
+
+static int compareNanos(const void * a, const void * b)
+{
+  uint32_t left = *(const uint32_t *)a;
+  uint32_t right = *(const uint32_t *)b;
+
+  return (left > right) - (left < right);
+}
+
+// Prints p50/p99/max of the <count> per-line times in <nanos> (sorted in place)
+static void printPercentiles(const char * name, double allocations, uint32_t * nanos, uint32_t count)
+{
+  qsort(nanos, count, sizeof(uint32_t), compareNanos);
+  printf("%-18s %10.2f %10u %10u %10u\n", name, allocations, nanos[count / 2], nanos[count - count / 100 - 1],
+    nanos[count - 1]);
+}
+
+// Prints the String versus TextFormat comparison; returns false if the two produce different text or
+// TextFormat overflows
+static bool reportFormatting(bool check)
+{
+  static uint32_t nanos[FORMAT_LINES];
+  touchData_t touchData[SENSOR_COUNT];
+  absData_t packets[SCALE_PACKETS];
+  heapString_t heapLine = { NULL, 0, 0 };
+  textFormat_t textLine;
+  char storage[PINNACLE_MAX_SENSORS * 32];
+  uint32_t mismatches = 0;
+  uint32_t heapAllocations;
+  uint64_t started;
+  uint32_t i;
+  bool passed = true;
+
+  fillPackets(packets);
+  memset(touchData, 0, sizeof(touchData));
+  TextFormat_init(&textLine, storage, sizeof(storage));
+
+  printf("\ntext formatting (two-pad line, %u lines, cpu ns/line including the clock read)\n", FORMAT_LINES);
+  printf("%-18s %10s %10s %10s %10s\n", "method", "allocs", "p50", "p99", "max");
+
+  _allocations = 0;
+  for(i = 0; i < FORMAT_LINES; i++)
+  {
+    touchData[0].absolute = packets[i % SCALE_PACKETS];
+    touchData[1].absolute = packets[(i * 7) % SCALE_PACKETS];
+    touchData[1].absolute.hovering = (i & 3) == 0;
+
+    started = cpuNow();
+    formatHeapLine(&heapLine, touchData, SENSOR_COUNT);
+    nanos[i] = (uint32_t)(cpuNow() - started);
+
+    TextFormat_clear(&textLine);
+    formatTextLine(&textLine, touchData, SENSOR_COUNT);
+    if(strcmp(heapLine.buffer, textLine.data) != 0 || textLine.overflow) mismatches++;
+    heapFree(&heapLine);
+  }
+  heapAllocations = _allocations;
+  printPercentiles("String model", (double)heapAllocations / FORMAT_LINES, nanos, FORMAT_LINES);
+
+  for(i = 0; i < FORMAT_LINES; i++)
+  {
+    touchData[0].absolute = packets[i % SCALE_PACKETS];
+    touchData[1].absolute = packets[(i * 7) % SCALE_PACKETS];
+    touchData[1].absolute.hovering = (i & 3) == 0;
+
+    started = cpuNow();
+    TextFormat_clear(&textLine);
+    formatTextLine(&textLine, touchData, SENSOR_COUNT);
+    nanos[i] = (uint32_t)(cpuNow() - started);
+  }
+  printPercentiles("TextFormat", 0.0, nanos, FORMAT_LINES);
+  printf("lines differing from the String output: %u\n", mismatches);
+
+  if(check && mismatches)
+  {
+    passed = false;
+    printf("text formatting OUT OF TOLERANCE\n");
+  }
+  return passed;
+}
+
+// ___ Full SPI queue ___
+
+#define QUEUE_PADS          6           // three requests' worth more than SPI_QUEUE_DEPTH holds
+
+typedef struct _queueResult
+{
+  uint8_t accepted;         // requests queued on the first pass, the rest were refused
+  uint8_t delivered;        // pads whose packet arrived over both passes
+  uint8_t stuck;            // pads left with a request pending, or DR not clearing
+} queueResult_t;
+
+// Requests a packet from each of QUEUE_PADS pads without servicing the queue, so it runs out of room
+// part way, then retries the pads that were refused once it has drained. A request is only accepted
+// if both its read and its Status1 clear fit.
+static void benchQueueFull(queueResult_t * result)
+{
+  touchData_t touchData[QUEUE_PADS];
+  packetRequest_t requests[QUEUE_PADS];
+  bool queued[QUEUE_PADS];
+  uint8_t sensorId;
+
+  setupSensorCount(touchData, QUEUE_PADS);
+  SpiQueue_init();
+  memset(result, 0, sizeof(queueResult_t));
+  for(sensorId = 0; sensorId < QUEUE_PADS; sensorId++)
+  {
+    Pinnacle_clearFlags(sensorId);
+    Pinnacle_enableFastRead(true, sensorId);
+    requests[sensorId].pending = false;
+  }
+
+  SIM_advance(DR_SETTLE_MICROS * 1000);
+  for(sensorId = 0; sensorId < QUEUE_PADS; sensorId++) SIM_pushAbsolute(sensorId, 512, 512, 40, 0);
+
+  _processed = 0;
+  for(sensorId = 0; sensorId < QUEUE_PADS; sensorId++)
+  {
+    queued[sensorId] = Pinnacle_available(sensorId) &&
+      Pinnacle_requestTouchData(&requests[sensorId], &touchData[sensorId], sensorId, processPacket);
+    if(queued[sensorId]) result->accepted++;
+  }
+  SpiQueue_flush();
+
+  for(sensorId = 0; sensorId < QUEUE_PADS; sensorId++)
+  {
+    if(!queued[sensorId] && Pinnacle_available(sensorId))
+    {
+      Pinnacle_requestTouchData(&requests[sensorId], &touchData[sensorId], sensorId, processPacket);
+    }
+  }
+  SpiQueue_flush();
+  result->delivered = (uint8_t)_processed;
+
+  // Every pad must be free again: nothing pending, DR cleared, and the next packet seen
+  SIM_advance(DR_SETTLE_MICROS * 1000);
+  for(sensorId = 0; sensorId < QUEUE_PADS; sensorId++)
+  {
+    if(requests[sensorId].pending || Pinnacle_available(sensorId)) result->stuck++;
+    SIM_pushAbsolute(sensorId, 512, 512, 40, 0);
+    if(!Pinnacle_available(sensorId)) result->stuck++;
+  }
+}
+
+// Prints what a full queue does to the requests; fails if a pad loses its packet or is left stuck
+static bool reportQueueFull(bool check)
+{
+  queueResult_t result;
+
+  benchQueueFull(&result);
+  printf("\nfull SPI queue (%d pads requested at once, %d transfers deep)\n", QUEUE_PADS, SPI_QUEUE_DEPTH);
+  printf("accepted %u, retried %u, delivered %u, stuck %u\n", result.accepted, QUEUE_PADS - result.accepted,
+    result.delivered, result.stuck);
+
+  if(check && (result.delivered != QUEUE_PADS || result.stuck != 0))
+  {
+    printf("full SPI queue FAILED\n");
+    return false;
+  }
+  return true;
+}
+
+#define STALL_PERIOD_NS     1000000   // the healthy pad sends a packet every 1 ms
+#define STALL_LOOP_NS       20000     // time the rest of loop() takes in the job runs
+#define STALL_MAX_STEP_US   200       // longest a Pinnacle_serviceJob() call may block
+
+typedef struct _stallResult
+{
+  uint8_t status;
+  uint32_t elapsedMicros;   // until the call returned or the job ended
+  uint32_t maxStepMicros;   // longest single call into the driver for the stalled pad
+  uint32_t pushed;          // packets the healthy pad sent meanwhile
+  uint32_t read;            // of those, packets the loop got to read
+} stallResult_t;
+
+// Runs a calibration (or a comp-matrix read) of sensor 1, which never completes it, while sensor 0
+// keeps sending packets. Blocking, the loop can't read sensor 0 until the call gives up; as a job
+// serviced from the loop, sensor 0 is read as usual.
+static void benchStall(stallResult_t * result, bool calibrate, bool job)
+{
+  touchData_t touchData[SENSOR_COUNT];
+  uint8_t compData[ERA_BENCH_SIZE];
+  pinnacleJob_t pending;
+  uint64_t started, nextPacket, stepStarted;
+  uint32_t i, step;
+
+  setupSensors(touchData);
+  Pinnacle_clearFlags(0);
+  SIM_stall(1, true);
+  memset(result, 0, sizeof(stallResult_t));
+
+  started = SIM_nanos();
+  if(!job)
+  {
+    result->status = (calibrate ? Pinnacle_forceCalibration(1) : ERA_readBlock(ERA_BENCH_ADDRESS, compData,
+      ERA_BENCH_SIZE, 1)) ? PINNACLE_DONE : PINNACLE_TIMEOUT;
+    result->elapsedMicros = result->maxStepMicros = (uint32_t)((SIM_nanos() - started) / 1000);
+
+    // The packets sent meanwhile overwrote each other, only the last one is still there to read
+    result->pushed = result->elapsedMicros / (STALL_PERIOD_NS / 1000);
+    for(i = 0; i < result->pushed; i++) SIM_pushAbsolute(0, 512, 512, 40, 0);
+    if(Pinnacle_available(0))
+    {
+      Pinnacle_getTouchData(&touchData[0], 0);
+      result->read++;
+    }
+    return;
+  }
+
+  if(calibrate) Pinnacle_startCalibration(&pending, 1);
+  else Pinnacle_startEraRead(&pending, ERA_BENCH_ADDRESS, compData, ERA_BENCH_SIZE, 1);
+
+  nextPacket = started + STALL_PERIOD_NS;
+  while(pending.status == PINNACLE_BUSY)
+  {
+    if(SIM_nanos() >= nextPacket)
+    {
+      SIM_pushAbsolute(0, 512, 512, 40, 0);
+      result->pushed++;
+      nextPacket += STALL_PERIOD_NS;
+    }
+    if(Pinnacle_available(0))
+    {
+      Pinnacle_getTouchData(&touchData[0], 0);
+      result->read++;
+    }
+
+    stepStarted = SIM_nanos();
+    Pinnacle_serviceJob(&pending);
+    step = (uint32_t)((SIM_nanos() - stepStarted) / 1000);
+    if(step > result->maxStepMicros) result->maxStepMicros = step;
+
+    SIM_advance(STALL_LOOP_NS);
+  }
+  result->status = pending.status;
+  result->elapsedMicros = (uint32_t)((SIM_nanos() - started) / 1000);
+}
+
+// Prints how a pad that stops answering affects the other one, blocking versus serviced as a job.
+// Fails if a job doesn't time out, blocks for too long in one step, or costs the healthy pad a packet.
+static bool reportStall(bool check)
+{
+  static const char * const names[] = { "comp-matrix, blocking", "comp-matrix, job", "calibrate, blocking", "calibrate, job" };
+  stallResult_t result;
+  uint8_t i;
+  bool passed = true;
+
+  printf("\nstalled pad (sensor 1 never completes a request, sensor 0 sends every %u us)\n", STALL_PERIOD_NS / 1000);
+  printf("%-22s %8s %10s %12s %8s %8s\n", "operation", "result", "elapsed us", "max step us", "sent", "lost");
+  for(i = 0; i < 4; i++)
+  {
+    benchStall(&result, i >= 2, i & 1);
+    printf("%-22s %8s %10u %12u %8u %8u\n", names[i], (result.status == PINNACLE_TIMEOUT) ? "timeout" : "done",
+      result.elapsedMicros, result.maxStepMicros, result.pushed, result.pushed - result.read);
+
+    if(result.status != PINNACLE_TIMEOUT) passed = false;
+    if((i & 1) && (result.maxStepMicros > STALL_MAX_STEP_US || result.read != result.pushed)) passed = false;
+  }
+  SIM_stall(1, false);
+
+  if(check && !passed)
+  {
+    printf("stalled pad OUT OF BUDGET\n");
+  }
+  return passed || !check;
+}
+
+/*  Start-up configuration  */
+#define STARTUP_MAX_PADS    8
+#define STARTUP_MAX_MICROS  30000     // profile start-up of 8 pads: one 20 ms calibration plus the bus traffic
+
+// The curved-overlay set-up of the sample sketches
+static const pinnacleProfile_t curvedProfile =
+{
+  { { SYS_CONFIG_1, 0x00 }, { FEED_CONFIG_2, 0x1F }, { Z_IDLE, 5 } },
+  { { ADC_ATTENUATION_ERA, ADC_ATTENUATE_2X }, { 0x0149, 0x04 }, { 0x0168, 0x03 } },
+  3, 3, true,
+};
+
+typedef struct _startupResult
+{
+  uint32_t readyMicros;     // until every pad had its feed on
+  uint32_t transactions;
+  uint32_t errors;          // pads not configured as <curvedProfile> says
+} startupResult_t;
+
+// Counts the pads whose registers differ from <profile>, or whose feed is off
+static uint32_t checkStartup(const pinnacleProfile_t * profile, uint8_t count)
+{
+  uint32_t errors = 0;
+  uint8_t sensorId, i;
+
+  for(sensorId = 0; sensorId < count; sensorId++)
+  {
+    bool correct = (SIM_peekRegister(sensorId, FEED_CONFIG_1) & 0x01) != 0;
+
+    for(i = 0; i < profile->rapCount; i++)
+    {
+      if(SIM_peekRegister(sensorId, (uint8_t)profile->rap[i].address) != profile->rap[i].value) correct = false;
+    }
+    for(i = 0; i < profile->eraCount; i++)
+    {
+      if(SIM_peekEra(sensorId, profile->era[i].address) != profile->era[i].value) correct = false;
+    }
+    if(!correct) errors++;
+  }
+  return errors;
+}
+
+// Brings up <count> pads with the curved-overlay set-up, the way the sample sketches do it (one pad
+// after the other, each setting read, written and read back per byte, then a blocking calibration),
+// or with <profile> applied to all pads at once. With <captured>, the profile of pad 0 is captured
+// once it's set up.
+static void benchStartup(startupResult_t * result, uint8_t count, const pinnacleProfile_t * profile, pinnacleProfile_t * captured)
+{
+  static const uint16_t eraAddresses[] = { ADC_ATTENUATION_ERA, 0x0149, 0x0168 };
+  touchData_t touchData[STARTUP_MAX_PADS];
+  uint8_t sensorIds[STARTUP_MAX_PADS];
+  simCounters_t counters;
+  uint64_t started;
+  uint8_t sensorId, i, value;
+
+  setupSensorCount(touchData, count);
+  SIM_clearCounters();
+  started = SIM_nanos();
+
+  for(sensorId = 0; sensorId < count; sensorId++)
+  {
+    Pinnacle_init(&touchData[sensorId], sensorId);
+    sensorIds[sensorId] = sensorId;
+    if(profile) continue;
+
+    for(i = 0; i < curvedProfile.rapCount; i++)
+    {
+      RAP_write((uint8_t)curvedProfile.rap[i].address, curvedProfile.rap[i].value, sensorId);
+    }
+    for(i = 0; i < curvedProfile.eraCount; i++)
+    {
+      ERA_readBytes(curvedProfile.era[i].address, &value, 1, sensorId);
+      ERA_writeByte(curvedProfile.era[i].address, curvedProfile.era[i].value, sensorId);
+      ERA_readBytes(curvedProfile.era[i].address, &value, 1, sensorId);
+    }
+    Pinnacle_forceCalibration(sensorId);
+    Pinnacle_enableFeed(true, sensorId);
+  }
+  if(profile) Profile_apply(profile, sensorIds, count);
+
+  result->readyMicros = (uint32_t)((SIM_nanos() - started) / 1000);
+  SIM_getCounters(&counters);
+  result->transactions = counters.transactions;
+  result->errors = checkStartup(&curvedProfile, count);
+
+  if(captured) Profile_capture(captured, eraAddresses, 3, true, 0);
+}
+
+// Prints the time until every pad is ready, set up one by one or from a profile captured from a pad
+// that was set up one by one. Fails if a pad ends up configured wrong, or 8 pads take too long.
+static bool reportStartup(bool check)
+{
+  static const uint8_t padCounts[] = { 1, 2, 4, 8 };
+  startupResult_t oneByOne, fromProfile;
+  pinnacleProfile_t captured;
+  uint8_t i;
+  bool passed = true;
+
+  printf("\nstart-up, curved overlay (until every pad has its feed on)\n");
+  printf("%6s %14s %8s %14s %8s\n", "pads", "one by one us", "CS", "profile us", "CS");
+  for(i = 0; i < sizeof(padCounts); i++)
+  {
+    benchStartup(&oneByOne, padCounts[i], NULL, &captured);
+    benchStartup(&fromProfile, padCounts[i], &captured, NULL);
+    printf("%6u %14u %8u %14u %8u\n", padCounts[i], oneByOne.readyMicros, oneByOne.transactions,
+      fromProfile.readyMicros, fromProfile.transactions);
+
+    if(oneByOne.errors || fromProfile.errors) passed = false;
+  }
+  if(fromProfile.readyMicros > STARTUP_MAX_MICROS) passed = false;
+
+  if(check && !passed)
+  {
+    printf("start-up OUT OF BUDGET\n");
+  }
+  return passed || !check;
+}
+
+/*  I2C transport  */
+#define I2C_MIN_SPEEDUP   3.0     // packets/s at 400 kHz against the sample sketches' Wire path
+
+// Reads a packet the way the I2C sample sketches do: the command and the read are separate transfers
+// (a STOP between them), then Status1 is cleared with the fixed settle delay
+static void readLegacyI2c(uint8_t i2cAddress, uint8_t * packet)
+{
+  uint8_t command = 0xA0 | PACKET_BYTE_0;
+  uint8_t clear[2] = { 0x80 | STATUS_1, 0x00 };
+
+  I2C_write(i2cAddress, &command, 1, true);
+  I2C_read(i2cAddress, packet, 6);
+  I2C_write(i2cAddress, clear, 2, true);
+  TIMER_delayMicroseconds(50);
+}
+
+// Simulates two pads on I2C, at the default and the alternate address, clocked at <clock>
+static void setupI2cSensors(touchData_t * touchData, uint32_t clock)
+{
+  uint8_t i;
+
+  SIM_reset(SENSOR_COUNT);
+  HW_addI2cSensor(I2C_ADDRESS_DEFAULT, 9);
+  HW_addI2cSensor(I2C_ADDRESS_ALTERNATE, 7);
+  I2C_init(clock);
+
+  for(i = 0; i < SENSOR_COUNT; i++)
+  {
+    memset(&touchData[i], 0, sizeof(touchData_t));
+    Pinnacle_init(&touchData[i], i);
+  }
+}
+
+// Streams absolute packets from both pads, through the sample sketches' Wire path (<legacy>) or
+// through Pinnacle_getTouchData() in fast-read mode, and checks the coordinates that come out
+static void benchI2cPackets(benchResult_t * result, const char * name, uint32_t clock, bool legacy)
+{
+  touchData_t touchData[SENSOR_COUNT];
+  uint8_t packet[6];
+  uint16_t xValue;
+  uint32_t i;
+  uint8_t sensorId;
+
+  setupI2cSensors(touchData, clock);
+  for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+  {
+    Pinnacle_clearFlags(sensorId);
+    Pinnacle_enableFastRead(!legacy, sensorId);
+  }
+
+  beginResult(result, name);
+  for(i = 0; i < PACKET_COUNT; i++)
+  {
+    sensorId = i % SENSOR_COUNT;
+    xValue = 128 + (i & 0x3FF);
+    SIM_pushAbsolute(sensorId, xValue, 64 + (i & 0x1FF), 40, 0);
+
+    if(!Pinnacle_available(sensorId))
+    {
+      result->lost++;
+      continue;
+    }
+
+    if(legacy)
+    {
+      readLegacyI2c(HW_i2cAddress(sensorId), packet);
+      if(packet[2] != (uint8_t)xValue) result->errors++;
+    }
+    else
+    {
+      Pinnacle_getTouchData(&touchData[sensorId], sensorId);
+      if(touchData[sensorId].absolute.xValue != xValue) result->errors++;
+    }
+    result->operations++;
+  }
+  endResult(result);
+}
+
+// Writes the registers of <curvedProfile> to pad 0, one transfer per register or all of them in one
+static void benchI2cRegisters(benchResult_t * result, const char * name, bool batched)
+{
+  touchData_t touchData[SENSOR_COUNT];
+  uint8_t pairs[2 * PROFILE_MAX_RAP];
+  uint32_t i;
+  uint8_t j;
+
+  setupI2cSensors(touchData, I2C_CLOCK_FAST);
+  for(j = 0; j < curvedProfile.rapCount; j++)
+  {
+    pairs[2 * j] = (uint8_t)curvedProfile.rap[j].address;
+    pairs[2 * j + 1] = curvedProfile.rap[j].value;
+  }
+
+  beginResult(result, name);
+  for(i = 0; i < CONFIG_ROUNDS; i++)
+  {
+    if(batched)
+    {
+      RAP_writePairs(pairs, curvedProfile.rapCount, 0);
+    }
+    else
+    {
+      for(j = 0; j < curvedProfile.rapCount; j++) RAP_write(pairs[2 * j], pairs[2 * j + 1], 0);
+    }
+    result->operations++;
+
+    for(j = 0; j < curvedProfile.rapCount; j++)
+    {
+      if(SIM_peekRegister(0, pairs[2 * j]) != pairs[2 * j + 1]) result->errors++;
+    }
+  }
+  endResult(result);
+}
+
+// Packets/s one pad could deliver if the host did nothing but read it
+static double packetsPerSecond(const benchResult_t * result)
+{
+  const simCounters_t * c = &result->counters;
+  double blockingNanos = (double)(c->busNanos + c->delayNanos) / result->operations;
+
+  return blockingNanos > 0 ? 1e9 / blockingNanos : 0.0;
+}
+
+// Prints the packets/s of each I2C path against the sample sketches' Wire path. Fails if 400 kHz
+// with repeated starts isn't I2C_MIN_SPEEDUP times faster.
+static bool reportI2c(const benchResult_t * results, uint8_t count, bool check)
+{
+  double legacy = packetsPerSecond(&results[0]);
+  double speedup = 0.0;
+  uint8_t i;
+
+  printf("\ni2c transport (2 pads at 0x%02X and 0x%02X, absolute packets)\n", I2C_ADDRESS_DEFAULT, I2C_ADDRESS_ALTERNATE);
+  printf("%-22s %10s %10s\n", "path", "packets/s", "speed-up");
+  for(i = 0; i < count; i++)
+  {
+    printf("%-22s %10.0f %9.2fx\n", results[i].name, packetsPerSecond(&results[i]), packetsPerSecond(&results[i]) / legacy);
+    if(strcmp(results[i].name, "i2c packet, 400 kHz") == 0) speedup = packetsPerSecond(&results[i]) / legacy;
+  }
+
+  if(check && speedup < I2C_MIN_SPEEDUP)
+  {
+    printf("i2c transport OUT OF BUDGET (%.1fx)\n", I2C_MIN_SPEEDUP);
+    return false;
+  }
+  return true;
+}
+
+/*  Transport conformance  */
+#define CONFORMANCE_PACKETS   200
+#define CONFORMANCE_ERA_SIZE  32
+
+typedef struct _conformanceRun
+{
+  uint32_t checks;
+  uint32_t failures;
+  simCounters_t counters;
+  uint8_t registers[SENSOR_COUNT][SLEEP_TIMER - SYS_CONFIG_1 + 1];   // the configuration block at the end
+} conformanceRun_t;
+
+static void conformanceCheck(conformanceRun_t * run, bool passed)
+{
+  run->checks++;
+  if(!passed) run->failures++;
+}
+
+// Runs the same script on two pads behind <transport>: packets in both modes, captured or polled,
+// configuration changes through the shadow, ERA block and cached accesses, the comp-matrix and a
+// profile with calibration. Each step is checked against the simulated chip.
+static void runConformance(conformanceRun_t * run, const pinnacleTransport_t * transport)
+{
+  static const uint8_t sensorIds[SENSOR_COUNT] = { 0, 1 };
+  touchData_t touchData[SENSOR_COUNT];
+  uint8_t pattern[CONFORMANCE_ERA_SIZE], readBack[CONFORMANCE_ERA_SIZE], compData[COMP_MATRIX_SIZE];
+  int16_t compMatrix[COMP_MATRIX_SIZE / 2], expected[COMP_MATRIX_SIZE / 2];
+  rawPacket_t packet;
+  uint8_t sensorId, j;
+  uint32_t i;
+  bool captured;
+
+  memset(run, 0, sizeof(conformanceRun_t));
+  SIM_reset(SENSOR_COUNT);
+  if(transport == &TRANSPORT_I2C)
+  {
+    HW_addI2cSensor(I2C_ADDRESS_DEFAULT, 9);
+    HW_addI2cSensor(I2C_ADDRESS_ALTERNATE, 7);
+    I2C_init(I2C_CLOCK_FAST);
+  }
+  else
+  {
+    HW_init();
+    SPI_init(1000000, MSBFIRST, SPI_MODE1);
+  }
+  SIM_clearCounters();
+
+  for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+  {
+    conformanceCheck(run, Transport_get(sensorId) == transport);
+    memset(&touchData[sensorId], 0, sizeof(touchData_t));
+    Pinnacle_init(&touchData[sensorId], sensorId);
+    conformanceCheck(run, SIM_peekRegister(sensorId, FEED_CONFIG_1) == 0x03 && SIM_peekRegister(sensorId, Z_IDLE) == 5);
+    conformanceCheck(run, Pinnacle_sensorPresent(sensorId));
+    Pinnacle_setZIdleCount(5, sensorId);
+    Pinnacle_clearFlags(sensorId);
+  }
+
+  for(i = 0; i < CONFORMANCE_PACKETS; i++)
+  {
+    sensorId = i % SENSOR_COUNT;
+    SIM_pushAbsolute(sensorId, 128 + (i * 37 & 0x7FF), 64 + (i * 11 & 0x5FF), (uint8_t)(i & 0x3F), (uint8_t)(i & 0x07));
+    conformanceCheck(run, Pinnacle_available(sensorId));
+    Pinnacle_getTouchData(&touchData[sensorId], sensorId);
+    conformanceCheck(run, touchData[sensorId].absolute.xValue == 128 + (i * 37 & 0x7FF) &&
+      touchData[sensorId].absolute.yValue == 64 + (i * 11 & 0x5FF) && touchData[sensorId].absolute.zValue == (i & 0x3F) &&
+      touchData[sensorId].absolute.buttons == (i & 0x07));
+  }
+
+  // Capture takes SPI pads only: an I2C read from the DR interrupt could break into a Wire transaction
+  // of the main loop. I2C pads are polled for the same packets, with the fast read as the panel does.
+  for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+  {
+    captured = Pinnacle_enableCapture(true, sensorId);
+    conformanceCheck(run, captured == (transport == &TRANSPORT_SPI));
+    if(!captured) Pinnacle_enableFastRead(true, sensorId);
+    SIM_pushAbsolute(sensorId, 300 + sensorId, 200, 20, 0);
+    conformanceCheck(run, captured ? Pinnacle_getCaptured(&packet, 1, sensorId) == 1 : Pinnacle_pollPacket(&packet, sensorId));
+    Pinnacle_decodePacket(&packet, &touchData[sensorId]);
+    conformanceCheck(run, packet.sensorId == sensorId && touchData[sensorId].absolute.xValue == 300 + sensorId);
+    if(captured) Pinnacle_enableCapture(false, sensorId);
+    else Pinnacle_enableFastRead(false, sensorId);
+  }
+
+  for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+  {
+    Pinnacle_setToRelative(&touchData[sensorId], sensorId);
+    Pinnacle_enableScroll(sensorId);
+  }
+  for(i = 0; i < CONFORMANCE_PACKETS; i++)
+  {
+    int16_t xDelta = (int16_t)((i * 13) & 0x1FF) - 256, yDelta = 255 - (int16_t)((i * 7) & 0x1FF);   // all 9 bits
+    int8_t wheelCount = (int8_t)(i & 0x0F) - 8;
+
+    sensorId = i % SENSOR_COUNT;
+    SIM_pushRelative(sensorId, xDelta, yDelta, wheelCount, (uint8_t)(i & 0x07));
+    conformanceCheck(run, Pinnacle_available(sensorId));
+    Pinnacle_getTouchData(&touchData[sensorId], sensorId);
+    conformanceCheck(run, touchData[sensorId].relative.xDelta == xDelta && touchData[sensorId].relative.yDelta == yDelta &&
+      touchData[sensorId].relative.wheelCount == wheelCount && touchData[sensorId].relative.buttons == (i & 0x07));
+  }
+
+  for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+  {
+    Pinnacle_setToAbsolute(&touchData[sensorId], sensorId);
+    Pinnacle_enableCurved(&touchData[sensorId], true, sensorId);
+    Pinnacle_setZIdleCount(7, sensorId);
+    conformanceCheck(run, SIM_peekRegister(sensorId, FEED_CONFIG_1) == 0x03 && SIM_peekRegister(sensorId, Z_IDLE) == 7);
+    conformanceCheck(run, (SIM_peekEra(sensorId, ADC_ATTENUATION_ERA) & 0xC0) == ADC_ATTENUATE_2X);
+
+    conformanceCheck(run, Pinnacle_setAdcAttenuation(ADC_ATTENUATE_3X, sensorId));
+    conformanceCheck(run, (SIM_peekEra(sensorId, ADC_ATTENUATION_ERA) & 0xC0) == ADC_ATTENUATE_3X);
+
+    for(j = 0; j < CONFORMANCE_ERA_SIZE; j++) pattern[j] = (uint8_t)(j * 29 + sensorId);
+    conformanceCheck(run, ERA_writeBlock(ERA_BENCH_ADDRESS, pattern, CONFORMANCE_ERA_SIZE, sensorId));
+    conformanceCheck(run, ERA_readBlock(ERA_BENCH_ADDRESS, readBack, CONFORMANCE_ERA_SIZE, sensorId));
+    conformanceCheck(run, memcmp(pattern, readBack, CONFORMANCE_ERA_SIZE) == 0);
+    for(j = 0; j < CONFORMANCE_ERA_SIZE; j++)
+    {
+      conformanceCheck(run, SIM_peekEra(sensorId, ERA_BENCH_ADDRESS + j) == pattern[j]);
+    }
+
+    conformanceCheck(run, Pinnacle_getCompMatrix(compMatrix, sensorId));
+    for(j = 0; j < COMP_MATRIX_SIZE; j++) compData[j] = SIM_peekEra(sensorId, COMP_MATRIX_ADDRESS + j);
+    Pinnacle_decodeCompMatrix(compData, expected);
+    conformanceCheck(run, memcmp(compMatrix, expected, sizeof(expected)) == 0);
+  }
+
+  conformanceCheck(run, Profile_apply(&curvedProfile, sensorIds, SENSOR_COUNT) == PINNACLE_DONE);
+  conformanceCheck(run, checkStartup(&curvedProfile, SENSOR_COUNT) == 0);
+
+  SIM_getCounters(&run->counters);
+  for(sensorId = 0; sensorId < SENSOR_COUNT; sensorId++)
+  {
+    for(j = 0; j < sizeof(run->registers[0]); j++)
+    {
+      run->registers[sensorId][j] = SIM_peekRegister(sensorId, SYS_CONFIG_1 + j);
+    }
+  }
+}
+
+// Runs the conformance script on SPI and on I2C. Fails if a check fails on either, or the two
+// leave the pads configured differently.
+static bool reportTransports(bool check)
+{
+  const pinnacleTransport_t * transports[] = { &TRANSPORT_SPI, &TRANSPORT_I2C };
+  conformanceRun_t runs[2];
+  bool identical;
+  uint8_t i;
+
+  printf("\ntransport conformance (same script on 2 pads per bus)\n");
+  printf("%-10s %8s %9s %12s %8s %10s\n", "transport", "checks", "failures", "transactions", "bytes", "bus us");
+  for(i = 0; i < 2; i++)
+  {
+    runConformance(&runs[i], transports[i]);
+    printf("%-10s %8u %9u %12u %8u %10.0f\n", transports[i]->name, runs[i].checks, runs[i].failures,
+      runs[i].counters.transactions, runs[i].counters.bytes, runs[i].counters.busNanos / 1000.0);
+  }
+
+  identical = memcmp(runs[0].registers, runs[1].registers, sizeof(runs[0].registers)) == 0;
+  printf("registers afterwards: %s\n", identical ? "identical" : "DIFFERENT");
+
+  if(check && (runs[0].failures || runs[1].failures || !identical))
+  {
+    printf("transport conformance FAILED\n");
+    return false;
+  }
+  return true;
+}
+
+/*  Unplugged I2C pad  */
+#define UNPLUGGED_MAX_US    (2 * ERA_TIMEOUT_MICROS)    // a failed ERA read gives up within its timeout
+
+// Unplugs the second of two I2C pads and runs the calls that have a timeout path against it. Fails if
+// one reports success, doesn't give up in time, the failures aren't counted, or the other pad is hit.
+static bool reportUnplugged(bool check)
+{
+  touchData_t touchData[2];
+  uint8_t data[ERA_BENCH_SIZE];
+  rawPacket_t packet;
+  uint32_t busErrors[2], timeouts;
+  uint64_t started;
+  uint32_t eraMicros;
+  bool present, eraRead, calibrated, polled, healthy;
+  uint8_t sensorId;
+
+  SIM_reset(2);
+  HW_addI2cSensor(I2C_ADDRESS_DEFAULT, 9);
+  HW_addI2cSensor(I2C_ADDRESS_ALTERNATE, 7);
+  I2C_init(I2C_CLOCK_FAST);
+  for(sensorId = 0; sensorId < 2; sensorId++)
+  {
+    memset(&touchData[sensorId], 0, sizeof(touchData_t));
+    Pinnacle_init(&touchData[sensorId], sensorId);
+    Pinnacle_enableFastRead(true, sensorId);
+    busErrors[sensorId] = Pinnacle_busErrors(sensorId);
+  }
+  timeouts = Pinnacle_timeouts(1);
+
+  SIM_unplug(1, true);
+  present = Pinnacle_sensorPresent(1);
+  started = SIM_nanos();
+  eraRead = ERA_readBlock(ERA_BENCH_ADDRESS, data, ERA_BENCH_SIZE, 1);
+  eraMicros = (uint32_t)((SIM_nanos() - started) / 1000);
+  calibrated = Pinnacle_forceCalibration(1);
+  SIM_pushAbsolute(1, 300, 200, 20, 0);
+  polled = Pinnacle_pollPacket(&packet, 1);
+
+  SIM_pushAbsolute(0, 300, 200, 20, 0);
+  healthy = Pinnacle_pollPacket(&packet, 0) && packet.sensorId == 0;
+  SIM_unplug(1, false);
+
+  busErrors[0] = Pinnacle_busErrors(0) - busErrors[0];
+  busErrors[1] = Pinnacle_busErrors(1) - busErrors[1];
+  timeouts = Pinnacle_timeouts(1) - timeouts;
+
+  printf("\nunplugged I2C pad (sensor 1 stops acknowledging, sensor 0 keeps going)\n");
+  printf("present %s, ERA read %s after %u us, calibration %s, packet %s\n", present ? "yes" : "no",
+    eraRead ? "done" : "failed", eraMicros, calibrated ? "done" : "failed", polled ? "read" : "not read");
+  printf("bus errors %u (sensor 0: %u), timeouts %u, sensor 0 packet %s\n", busErrors[1], busErrors[0], timeouts,
+    healthy ? "read" : "LOST");
+
+  if(check && (present || eraRead || calibrated || polled || eraMicros > UNPLUGGED_MAX_US || busErrors[1] == 0 ||
+    timeouts < 2 || busErrors[0] != 0 || !healthy))
+  {
+    printf("unplugged I2C pad FAILED\n");
+    return false;
+  }
+  return true;
+}
+
+/*  Gestures  */
+#define GESTURE_SAMPLE_US     10000     // 100 Hz
+#define GESTURE_ROUNDS        2000
+#define GESTURE_SCRIPT_EVENTS 16
+#define GESTURE_MAX_NS        100.0     // cpu ns per packet
+
+typedef struct _gestureRun
+{
+  gesture_t gesture;
+  gestureConfig_t config;
+  gestureEvent_t events[GESTURE_SCRIPT_EVENTS];   // consecutive rotation steps are added up
+  uint8_t eventCount;
+  uint32_t timestamp;
+  uint32_t packets;
+} gestureRun_t;
+
+// What the script of runGestureScript() must produce: a tap in the center, a double-tap in sector 1
+// (lower right), swipes left and up, two turns clockwise and one back, and nothing for the long press
+static const gestureEvent_t gestureExpected[] =
+{
+  { GESTURE_TAP,    GESTURE_CENTER, 1,   0 },
+  { GESTURE_TAP,    1,              2,   0 },
+  { GESTURE_SWIPE,  GESTURE_LEFT,   0,   0 },
+  { GESTURE_SWIPE,  GESTURE_UP,     0,   0 },
+  { GESTURE_ROTATE, 0,              0,  32 },
+  { GESTURE_ROTATE, 0,              0, -16 },
+};
+#define GESTURE_EXPECTED (sizeof(gestureExpected) / sizeof(gestureExpected[0]))
+
+static void gestureRecord(gestureRun_t * run, const gestureEvent_t * event)
+{
+  gestureEvent_t * last = run->eventCount ? &run->events[run->eventCount - 1] : NULL;
+
+  if(last && event->type == GESTURE_ROTATE && last->type == GESTURE_ROTATE && (event->steps > 0) == (last->steps > 0))
+  {
+    last->steps += event->steps;
+  }
+  else if(run->eventCount < GESTURE_SCRIPT_EVENTS)
+  {
+    run->events[run->eventCount++] = *event;
+  }
+}
+
+static void gestureFeed(gestureRun_t * run, uint16_t xValue, uint16_t yValue, uint8_t zValue)
+{
+  absData_t data = { 0, xValue, yValue, zValue, false };
+  gestureEvent_t events[GESTURE_MAX_EVENTS];
+  uint8_t count, i;
+
+  count = Gesture_update(&run->gesture, &run->config, &data, run->timestamp, events);
+  for(i = 0; i < count; i++) gestureRecord(run, &events[i]);
+  run->timestamp += GESTURE_SAMPLE_US;
+  run->packets++;
+}
+
+// The Z-idle packets after a lift-off, then <idleMicros> without packets
+static void gestureLift(gestureRun_t * run, uint32_t idleMicros)
+{
+  gestureEvent_t events[GESTURE_MAX_EVENTS];
+  uint8_t i, count;
+
+  for(i = 0; i < 5; i++) gestureFeed(run, 0, 0, 0);
+  run->timestamp += idleMicros;
+  count = Gesture_poll(&run->gesture, &run->config, run->timestamp, events);
+  for(i = 0; i < count; i++) gestureRecord(run, &events[i]);
+}
+
+static void gestureStroke(gestureRun_t * run, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint32_t micros, uint32_t idleMicros)
+{
+  uint16_t samples = (uint16_t)(micros / GESTURE_SAMPLE_US);
+  uint16_t i;
+
+  for(i = 0; i <= samples; i++)
+  {
+    gestureFeed(run, (uint16_t)(x0 + ((int32_t)x1 - x0) * i / samples), (uint16_t)(y0 + ((int32_t)y1 - y0) * i / samples), 40);
+  }
+  gestureLift(run, idleMicros);
+}
+
+// <turns> around the center at a radius of 600, clockwise if positive, starting at the top
+static void gestureCircle(gestureRun_t * run, double turns, uint32_t micros)
+{
+  uint16_t samples = (uint16_t)(micros / GESTURE_SAMPLE_US);
+  double angle;
+  uint16_t i;
+
+  for(i = 0; i <= samples; i++)
+  {
+    angle = -M_PI / 2 + 2 * M_PI * turns * i / samples;
+    gestureFeed(run, (uint16_t)lround(run->config.xCenter + 600 * cos(angle)), (uint16_t)lround(run->config.yCenter + 600 * sin(angle)), 40);
+  }
+  gestureLift(run, 300000);
+}
+
+static void runGestureScript(gestureRun_t * run)
+{
+  run->eventCount = 0;
+  Gesture_init(&run->gesture);
+
+  gestureStroke(run, 1030, 760, 1040, 770, 80000, 300000);      // tap, center
+  gestureStroke(run, 1600, 1100, 1610, 1100, 60000, 100000);    // double-tap, lower right
+  gestureStroke(run, 1605, 1105, 1600, 1100, 60000, 300000);
+  gestureStroke(run, 1600, 768, 450, 768, 150000, 300000);      // swipe left through the center
+  gestureStroke(run, 1024, 1400, 1024, 150, 200000, 300000);    // swipe up
+  gestureCircle(run, 2.0, 1000000);
+  gestureCircle(run, -1.0, 600000);
+  gestureStroke(run, 500, 400, 510, 400, 600000, 300000);       // long press
+}
+
+// Runs the gesture script and checks what it produced, then times it. Fails on a wrong event or if
+// a packet costs more than GESTURE_MAX_NS.
+static bool reportGestures(bool check)
+{
+  gestureRun_t run;
+  uint64_t started, elapsed;
+  uint32_t round;
+  double nsPerPacket;
+  bool correct;
+  uint8_t i;
+
+  memset(&run, 0, sizeof(run));
+  Gesture_initConfig(&run.config);
+  runGestureScript(&run);
+  correct = run.eventCount == GESTURE_EXPECTED;
+  for(i = 0; correct && i < GESTURE_EXPECTED; i++)
+  {
+    correct = run.events[i].type == gestureExpected[i].type && run.events[i].region == gestureExpected[i].region &&
+      run.events[i].taps == gestureExpected[i].taps && run.events[i].steps == gestureExpected[i].steps;
+  }
+
+  run.packets = 0;
+  started = cpuNow();
+  for(round = 0; round < GESTURE_ROUNDS; round++)
+  {
+    runGestureScript(&run);
+  }
+  elapsed = cpuNow() - started;
+  nsPerPacket = (double)elapsed / run.packets;
+
+  printf("\ngestures (scripted taps, swipes and turns, %u packets per run)\n", run.packets / GESTURE_ROUNDS);
+  for(i = 0; i < run.eventCount; i++)
+  {
+    printf("  %-6s region %u taps %u steps %d\n", Gesture_typeName(run.events[i].type), run.events[i].region,
+      run.events[i].taps, run.events[i].steps);
+  }
+  printf("events %s, cpu %.1f ns/packet\n", correct ? "as expected" : "WRONG", nsPerPacket);
+
+  if(check && (!correct || nsPerPacket > GESTURE_MAX_NS))
+  {
+    printf("gestures FAILED\n");
+    return false;
+  }
+  return true;
+}
+
+#ifdef PINNACLE_INSTRUMENT
+#define CLEAR_FLAGS_MIN_US  50      // Pinnacle_clearFlags() waits this long after the write
+
+// Prints the instrumentation's histograms. Fails if a histogram is inconsistent or a Status1 clear
+// took less than its fixed delay, which would mean the hooks don't enclose what they should.
+static bool reportInstrument(bool check)
+{
+  instrumentStats_t stats;
+  uint8_t stage, sensorId;
+  bool passed = true;
+
+  printf("\nlatency instrumentation (cycles, %u per us)\n", TIMER_cyclesPerMicro());
+  printf("%-14s %6s %8s %9s %9s %9s %9s\n", "stage", "sensor", "count", "min", "p50", "p99", "max");
+  for(stage = 0; stage < INSTRUMENT_STAGES; stage++)
+  {
+    for(sensorId = 0; sensorId < INSTRUMENT_MAX_SENSORS; sensorId++)
+    {
+      Instrument_getStats(stage, sensorId, &stats);
+      if(stats.count == 0) continue;
+
+      printf("%-14s %6u %8u %9u %9u %9u %9u\n", Instrument_stageName(stage), sensorId, stats.count, stats.min,
+        stats.p50, stats.p99, stats.max);
+      if(stats.min > stats.p50 || stats.p50 > stats.p99 || stats.p99 > stats.max) passed = false;
+      if(stage == INSTRUMENT_CLEAR_FLAGS && stats.min < CLEAR_FLAGS_MIN_US * TIMER_cyclesPerMicro()) passed = false;
+    }
+  }
+
+  if(check && !passed)
+  {
+    printf("latency instrumentation INCONSISTENT\n");
+  }
+  return passed || !check;
+}
+#endif
+
+typedef struct _managerRun
+{
+  const char * name;
+  uint8_t count;
+  uint32_t periodNs;
+} managerRun_t;
+
+static const managerRun_t managerRuns[] =
+{
+  { "manager, 1 pad",         1, 1000000 },
+  { "manager, 2 pads",        2, 1000000 },
+  { "manager, 4 pads",        4, 1000000 },
+  { "manager, 8 pads",        8, 1000000 },
+  { "manager, 8 pads, 2 kHz", 8,  500000 },
+};
+#define MANAGER_RUNS (sizeof(managerRuns) / sizeof(managerRuns[0]))
+
+typedef struct _i2cRun
+{
+  const char * name;
+  uint32_t clock;
+  bool legacy;
+} i2cRun_t;
+
+// The first run is what the others are compared against
+static const i2cRun_t i2cRuns[] =
+{
+  { "i2c packet, Wire 100k",  I2C_CLOCK_STANDARD,  true  },
+  { "i2c packet, 100 kHz",    I2C_CLOCK_STANDARD,  false },
+  { "i2c packet, 400 kHz",    I2C_CLOCK_FAST,      false },
+  { "i2c packet, 1 MHz",      I2C_CLOCK_FAST_PLUS, false },
+};
+#define I2C_RUNS (sizeof(i2cRuns) / sizeof(i2cRuns[0]))
+
+int main(int argc, char ** argv)
+{
+  benchResult_t result;
+  benchResult_t i2cResults[I2C_RUNS];
+  managerSummary_t summary[MANAGER_RUNS];
+  uint8_t i;
+  bool check = (argc > 1) && (strcmp(argv[1], "-c") == 0);
+  bool passed = true;
+
+  printf("%-22s %8s %7s %8s %7s %9s %9s %9s %9s %6s %6s\n",
+    "benchmark", "ops", "CS/op", "bytes/op", "calls", "bus us/op", "delay us", "wall us", "cpu ns/op",
+    "stale", "lost");
+
+  benchPackets(&result, "absolute packet", ABSOLUTE, false);
+  passed &= reportResult(&result, check);
+
+  benchPackets(&result, "absolute fast-read", ABSOLUTE, true);
+  passed &= reportResult(&result, check);
+
+  benchPackets(&result, "relative packet", RELATIVE, false);
+  passed &= reportResult(&result, check);
+
+  benchPackets(&result, "relative fast-read", RELATIVE, true);
+  passed &= reportResult(&result, check);
+
+  benchStalledLoop(&result, "stalled loop, polled", false);
+  passed &= reportResult(&result, check);
+
+  benchStalledLoop(&result, "stalled loop, ISR", true);
+  passed &= reportResult(&result, check);
+
+  benchTwoPadLoop(&result, "two-pad loop, blocking", false);
+  passed &= reportResult(&result, check);
+
+  benchTwoPadLoop(&result, "two-pad loop, queued", true);
+  passed &= reportResult(&result, check);
+
+  for(i = 0; i < MANAGER_RUNS; i++)
+  {
+    benchManager(&result, managerRuns[i].name, managerRuns[i].count, managerRuns[i].periodNs, &summary[i]);
+    passed &= reportResult(&result, check);
+  }
+
+  benchEraRead(&result, "era read per-byte", false);
+  passed &= reportResult(&result, check);
+
+  benchEraRead(&result, "era read block", true);
+  passed &= reportResult(&result, check);
+
+  benchEraWrite(&result, "era write per-byte", false);
+  passed &= reportResult(&result, check);
+
+  benchEraWrite(&result, "era write block", true);
+  passed &= reportResult(&result, check);
+
+  benchConfig(&result, "config changes, cold", true);
+  passed &= reportResult(&result, check);
+
+  benchConfig(&result, "config changes, shadow", false);
+  passed &= reportResult(&result, check);
+
+  for(i = 0; i < I2C_RUNS; i++)
+  {
+    benchI2cPackets(&i2cResults[i], i2cRuns[i].name, i2cRuns[i].clock, i2cRuns[i].legacy);
+    passed &= reportResult(&i2cResults[i], check);
+  }
+
+  benchI2cRegisters(&result, "i2c registers, each", false);
+  passed &= reportResult(&result, check);
+
+  benchI2cRegisters(&result, "i2c registers, batched", true);
+  passed &= reportResult(&result, check);
+
+  passed &= reportScaling(check);
+  passed &= reportPolar(check);
+  passed &= reportFilter(check);
+  passed &= reportPointer(check);
+  passed &= reportHid(check);
+  passed &= reportHoverMap(check);
+  passed &= reportOutput(check);
+  passed &= reportFormatting(check);
+  passed &= reportQueueFull(check);
+  passed &= reportStall(check);
+  passed &= reportStartup(check);
+  passed &= reportI2c(i2cResults, I2C_RUNS, check);
+  passed &= reportTransports(check);
+  passed &= reportUnplugged(check);
+  passed &= reportGestures(check);
+#ifdef PINNACLE_INSTRUMENT
+  passed &= reportInstrument(check);
+#endif
+
+  printf("\nsensor manager scaling (1 MHz SPI, fast-read)\n");
+  printf("%6s %10s %10s %12s %12s %10s %10s\n",
+    "pads", "period us", "packets/s", "min/pad", "max/pad", "avg lat us", "max lat us");
+  for(i = 0; i < MANAGER_RUNS; i++)
+  {
+    printf("%6u %10u %10u %12u %12u %10u %10u\n", summary[i].count, summary[i].periodMicros,
+      summary[i].packetsPerSecond, summary[i].minShare, summary[i].maxShare, summary[i].averageLatency,
+      summary[i].worstLatency);
+  }
+
+  return passed ? 0 : 1;
+}
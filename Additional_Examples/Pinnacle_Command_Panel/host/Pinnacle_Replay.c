@@ -0,0 +1,562 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// ___ Offline replay of Pinnacle packet traces ___
+// Pushes a binary trace (see Trace.h; the Command Panel's 't' command streams one over serial) through
+// the same decode, hover-map and scaling code the firmware runs, followed by a quadrant-tap detector
+// (a tap: touch down and lift off in the same quadrant within TAP_MAX_US), as fast as the host allows.
+// With -g the absolute packets also go through the gesture engine (Gesture.h), one per sensor.
+// With -f they are first smoothed by the motion filter (MotionFilter.h), and the jitter before and after
+// is reported, so its settings can be tuned on a recorded trace.
+// Usage:
+//   pinnacle_replay -r <file> [loops]   record <loops> passes of a scripted session from the simulated chip
+//   pinnacle_replay [options] <file>    replay a trace
+//     -c            curved overlay: flag hovering packets (default map, or -m)
+//     -m <file>     hover map blob, as written by HoverMap_save()
+//     -s <w>x<h>    scale absolute data to <w> x <h> with Transform_apply()
+//     -p            print each packet (the Command Panel's columns), each tap ("Qx") and each gesture
+//     -g            recognize gestures, with Gesture_initConfig() centered on the output
+//     -f <settings> filter absolute data, "default" or minCutoff,beta,speedCutoff,predictMicros (see
+//                   motionFilterConfig_t), e.g. -f 100,100,500,4000
+//     -n <count>    replay the trace <count> times, for benchmarking
+//     -d <digest>   exit non-zero unless the digest of the output matches (regression tests)
+//     -t <file>     also write the output as a binary telemetry stream (Telemetry.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Pinnacle.h"
+#include "Hardware.h"
+#include "Hardware_Sim.h"
+#include "HoverMap.h"
+#include "Transform.h"
+#include "Trace.h"
+#include "Telemetry.h"
+#include "Gesture.h"
+#include "MotionFilter.h"
+
+#define TAP_MAX_US        300000
+#define SAMPLE_PERIOD_US  10000     // 100 Hz, the rate of the scripted session
+#define Z_IDLE_PACKETS    5
+
+typedef struct _tapState
+{
+  bool down;
+  bool moved;           // left the quadrant it touched down in
+  uint8_t quadrant;
+  uint32_t downAt;
+} tapState_t;
+
+// The last two positions of a touch, for its jitter
+typedef struct _jitterState
+{
+  int32_t x[2];
+  int32_t y[2];
+  uint8_t count;
+} jitterState_t;
+
+typedef struct _replayOptions
+{
+  bool curved;
+  bool scale;
+  bool print;
+  bool gestures;
+  bool filter;
+  transform_t transform;
+  motionFilterConfig_t filterConfig;
+  gestureConfig_t gestureConfig;
+  uint16_t xCenter;     // quadrant boundaries, in output coordinates
+  uint16_t yCenter;
+  telemetry_t * telemetry;    // receives the output when set
+} replayOptions_t;
+
+typedef struct _replayResult
+{
+  uint32_t packets;
+  uint32_t hovering;
+  uint32_t taps[4];
+  uint32_t gestures[GESTURE_ROTATE + 1];    // events of each type
+  int32_t steps;                            // rotation steps, added up
+  uint32_t filtered;                        // packets through the motion filter
+  uint64_t rawJitter;                       // |second difference| of X plus Y, added up
+  uint64_t filteredJitter;
+  uint64_t filterOffset;                    // |filtered - raw| of X plus Y, added up
+  uint32_t digest;
+} replayResult_t;
+
+static FILE * _telemetryFile;
+
+static void writeTelemetry(const uint8_t * frame, uint16_t length)
+{
+  fwrite(frame, 1, length, _telemetryFile);
+}
+
+static uint64_t cpuNow(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// FNV-1a, over everything the pipeline produces
+static uint32_t digestAdd(uint32_t digest, uint32_t value)
+{
+  uint8_t i;
+
+  for(i = 0; i < 4; i++)
+  {
+    digest = (digest ^ (uint8_t)(value >> (i * 8))) * 16777619u;
+  }
+  return digest;
+}
+
+// ___ Recording ___
+
+// Pushes one absolute packet per sample period to sensor 0 from (<x0>, <y0>) to (<x1>, <y1>) over
+// <samples> samples, and a matching relative packet to sensor 1, then drains both rings to <file>
+static void recordStroke(FILE * file, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t zValue,
+  uint16_t samples)
+{
+  uint8_t record[TRACE_MAX_RECORD];
+  rawPacket_t packet;
+  uint16_t i, xValue, yValue;
+  uint16_t xLast = x0;
+  uint16_t yLast = y0;
+  uint8_t sensorId;
+
+  for(i = 0; i < samples; i++)
+  {
+    xValue = (uint16_t)(x0 + ((int32_t)x1 - x0) * i / samples);
+    yValue = (uint16_t)(y0 + ((int32_t)y1 - y0) * i / samples);
+    SIM_advance(SAMPLE_PERIOD_US * 1000);
+    SIM_pushAbsolute(0, xValue, yValue, zValue, 0);
+    if(zValue) SIM_pushRelative(1, (int8_t)(xValue - xLast), (int8_t)(yValue - yLast), 0, 0);
+    xLast = xValue;
+    yLast = yValue;
+
+    for(sensorId = 0; sensorId < 2; sensorId++)
+    {
+      while(Pinnacle_getCaptured(&packet, 1, sensorId))
+      {
+        fwrite(record, 1, Trace_encode(&packet, record), file);
+      }
+    }
+  }
+}
+
+// A finger touching down at (<x0>, <y0>), moving to (<x1>, <y1>) within <micros> and lifting off,
+// followed by the chip's Z-idle packets
+static void recordTouch(FILE * file, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t zValue,
+  uint32_t micros)
+{
+  recordStroke(file, x0, y0, x1, y1, zValue, (uint16_t)(micros / SAMPLE_PERIOD_US));
+  recordStroke(file, 0, 0, 0, 0, 0, Z_IDLE_PACKETS);
+  SIM_advance(200000 * 1000);
+}
+
+// Records <loops> passes of a scripted session: quadrant taps, a long press, a slide across quadrants,
+// a hover over the center and circles. Sensor 0 is in absolute mode, sensor 1 in relative mode.
+static int recordSession(const char * path, uint32_t loops)
+{
+  touchData_t touchData[2];
+  FILE * file = fopen(path, "wb");
+  uint32_t loop;
+  uint8_t sensorId, step;
+
+  if(!file)
+  {
+    perror(path);
+    return 1;
+  }
+
+  SIM_reset(2);
+  HW_init();
+  SPI_init(1000000, MSBFIRST, SPI_MODE1);
+  for(sensorId = 0; sensorId < 2; sensorId++)
+  {
+    memset(&touchData[sensorId], 0, sizeof(touchData_t));
+    Pinnacle_init(&touchData[sensorId], sensorId);
+    Pinnacle_enableCapture(true, sensorId);
+  }
+  Pinnacle_setToRelative(&touchData[1], 1);
+
+  for(loop = 0; loop < loops; loop++)
+  {
+    recordTouch(file, 500, 400, 520, 410, 40, 100000);       // tap, quadrant 0
+    recordTouch(file, 1500, 400, 1490, 420, 40, 200000);     // tap, quadrant 1
+    recordTouch(file, 500, 1100, 510, 1100, 40, 500000);     // held too long
+    recordTouch(file, 500, 1100, 1500, 1100, 40, 150000);    // slides from quadrant 2 to 3
+    recordTouch(file, 1500, 1100, 1500, 1100, 40, 50000);    // tap, quadrant 3
+    recordTouch(file, 1000, 750, 1050, 760, 8, 100000);      // hovers over the center of a curved overlay
+    for(step = 0; step < 4; step++)                          // circles
+    {
+      recordStroke(file, 1000, 300, 1500, 750, 45, 25);
+      recordStroke(file, 1500, 750, 1000, 1200, 45, 25);
+      recordStroke(file, 1000, 1200, 500, 750, 45, 25);
+      recordStroke(file, 500, 750, 1000, 300, 45, 25);
+    }
+    recordStroke(file, 0, 0, 0, 0, 0, Z_IDLE_PACKETS);
+    SIM_advance(200000 * 1000);
+  }
+
+  fclose(file);
+  return 0;
+}
+
+// ___ Replay ___
+
+// Reads every valid record of <path>. Returns the number of packets, the array goes to <*packets>.
+static uint32_t loadTrace(const char * path, rawPacket_t ** packets, traceReader_t * reader)
+{
+  FILE * file = fopen(path, "rb");
+  uint32_t count = 0;
+  uint32_t capacity = 4096;
+  rawPacket_t packet;
+  int data;
+
+  Trace_initReader(reader);
+  if(!file)
+  {
+    perror(path);
+    return 0;
+  }
+
+  *packets = malloc(capacity * sizeof(rawPacket_t));
+  while(*packets && (data = fgetc(file)) != EOF)
+  {
+    if(!Trace_feed(reader, (uint8_t)data, &packet)) continue;
+    if(count == capacity)
+    {
+      capacity *= 2;
+      *packets = realloc(*packets, capacity * sizeof(rawPacket_t));
+      if(!*packets) break;
+    }
+    (*packets)[count++] = packet;
+  }
+
+  fclose(file);
+  return *packets ? count : 0;
+}
+
+// Feeds one absolute packet to the tap detector. Returns the quadrant of a completed tap, or 0xFF.
+static uint8_t detectTap(tapState_t * tap, const absData_t * data, uint32_t timestamp, const replayOptions_t * options)
+{
+  uint8_t quadrant;
+  bool touching = data->zValue != 0 && !data->hovering;
+
+  if(!touching)
+  {
+    quadrant = (tap->down && !tap->moved && (timestamp - tap->downAt) <= TAP_MAX_US) ? tap->quadrant : 0xFF;
+    tap->down = false;
+    return quadrant;
+  }
+
+  quadrant = (data->xValue >= options->xCenter) | ((data->yValue >= options->yCenter) << 1);
+  if(!tap->down)
+  {
+    tap->down = true;
+    tap->moved = false;
+    tap->quadrant = quadrant;
+    tap->downAt = timestamp;
+  }
+  else if(quadrant != tap->quadrant)
+  {
+    tap->moved = true;
+  }
+  return 0xFF;
+}
+
+static void countGestures(const gestureEvent_t * events, uint8_t count, uint8_t sensorId, const replayOptions_t * options,
+  replayResult_t * result)
+{
+  uint8_t i;
+
+  for(i = 0; i < count; i++)
+  {
+    result->gestures[events[i].type]++;
+    if(events[i].type == GESTURE_ROTATE) result->steps += events[i].steps;
+    if(options->print)
+    {
+      printf("SENS_%u %s %u x%u %d\n", sensorId, Gesture_typeName(events[i].type), events[i].region, events[i].taps,
+        events[i].steps);
+    }
+  }
+}
+
+// Adds <data> to the touch in <state> and returns the size of its second difference (the change of
+// direction and speed), or 0 until the touch has three packets
+static uint32_t addJitter(jitterState_t * state, const absData_t * data)
+{
+  int32_t x = data->xValue;
+  int32_t y = data->yValue;
+  uint32_t jitter = 0;
+
+  if(data->zValue == 0)
+  {
+    state->count = 0;
+    return 0;
+  }
+
+  if(state->count >= 2) jitter = abs(x - 2 * state->x[1] + state->x[0]) + abs(y - 2 * state->y[1] + state->y[0]);
+  else state->count++;
+
+  state->x[0] = state->x[1];
+  state->y[0] = state->y[1];
+  state->x[1] = x;
+  state->y[1] = y;
+  return jitter;
+}
+
+// Runs <count> packets through the pipeline once. Gestures don't go into the digest.
+static void replay(const rawPacket_t * packets, uint32_t count, const replayOptions_t * options, replayResult_t * result)
+{
+  touchData_t touchData[PINNACLE_MAX_SENSORS];
+  tapState_t taps[PINNACLE_MAX_SENSORS];
+  gesture_t gestures[PINNACLE_MAX_SENSORS];
+  gestureEvent_t events[GESTURE_MAX_EVENTS];
+  motionFilter_t filters[PINNACLE_MAX_SENSORS];
+  jitterState_t rawJitter[PINNACLE_MAX_SENSORS];
+  jitterState_t filteredJitter[PINNACLE_MAX_SENSORS];
+  absData_t raw;
+  const rawPacket_t * packet;
+  uint32_t digest = 2166136261u;
+  uint32_t i;
+  uint8_t quadrant;
+
+  memset(touchData, 0, sizeof(touchData));
+  memset(taps, 0, sizeof(taps));
+  memset(rawJitter, 0, sizeof(rawJitter));
+  memset(filteredJitter, 0, sizeof(filteredJitter));
+  memset(result, 0, sizeof(replayResult_t));
+  for(i = 0; i < PINNACLE_MAX_SENSORS; i++)
+  {
+    touchData[i].overlayMode = options->curved ? CURVED : FLAT;
+    Gesture_init(&gestures[i]);
+    MotionFilter_init(&filters[i]);
+  }
+
+  for(i = 0; i < count; i++)
+  {
+    packet = &packets[i];
+    touchData[packet->sensorId].absolute.hovering = false;
+
+    if(Pinnacle_decodePacket(packet, &touchData[packet->sensorId]) == ABSOLUTE)
+    {
+      absData_t * data = &touchData[packet->sensorId].absolute;
+
+      if(options->filter)
+      {
+        raw = *data;
+        MotionFilter_apply(&filters[packet->sensorId], &options->filterConfig, data, packet->timestamp);
+        result->rawJitter += addJitter(&rawJitter[packet->sensorId], &raw);
+        result->filteredJitter += addJitter(&filteredJitter[packet->sensorId], data);
+        result->filterOffset += abs((int32_t)data->xValue - raw.xValue) + abs((int32_t)data->yValue - raw.yValue);
+        if(data->zValue) result->filtered++;
+      }
+      if(options->scale) Transform_apply(&options->transform, data);
+      quadrant = detectTap(&taps[packet->sensorId], data, packet->timestamp, options);
+
+      digest = digestAdd(digest, data->xValue | ((uint32_t)data->yValue << 16));
+      digest = digestAdd(digest, data->zValue | (data->buttons << 8) | (data->hovering << 16) | ((uint32_t)quadrant << 24));
+      if(data->hovering) result->hovering++;
+      if(quadrant != 0xFF) result->taps[quadrant]++;
+      if(options->telemetry) Telemetry_addAbsolute(options->telemetry, data, packet->sensorId, packet->timestamp);
+
+      if(options->print)
+      {
+        printf("SENS_%u %u\t%u\t%u%s\t%u\n", packet->sensorId, data->xValue, data->yValue, data->zValue,
+          options->curved ? (data->hovering ? " - h" : " - v") : "", data->buttons);
+        if(quadrant != 0xFF) printf("Q%u\n", quadrant);
+      }
+      if(options->gestures)
+      {
+        countGestures(events, Gesture_update(&gestures[packet->sensorId], &options->gestureConfig, data, packet->timestamp,
+          events), packet->sensorId, options, result);
+      }
+    }
+    else
+    {
+      relData_t * data = &touchData[packet->sensorId].relative;
+
+      digest = digestAdd(digest, (uint8_t)data->xDelta | ((uint8_t)data->yDelta << 8) |
+        ((uint32_t)(uint8_t)data->wheelCount << 16) | ((uint32_t)data->buttons << 24));
+      if(options->telemetry) Telemetry_addRelative(options->telemetry, data, packet->sensorId, packet->timestamp);
+
+      if(options->print)
+      {
+        printf("SENS_%u %d\t%d\t%d\t%u\n", packet->sensorId, data->xDelta, data->yDelta, data->wheelCount,
+          data->buttons);
+      }
+    }
+  }
+
+  // taps still held at the end of the trace
+  for(i = 0; options->gestures && i < PINNACLE_MAX_SENSORS; i++)
+  {
+    countGestures(events, Gesture_poll(&gestures[i], &options->gestureConfig, packets[count - 1].timestamp +
+      options->gestureConfig.multiTapMicros + 1, events), (uint8_t)i, options, result);
+  }
+
+  result->packets = count;
+  result->digest = digest;
+}
+
+// Reads "minCutoff,beta,speedCutoff,predictMicros" into <config>
+static bool parseFilter(const char * text, motionFilterConfig_t * config)
+{
+  unsigned minCutoff, beta, speedCutoff, predictMicros;
+
+  if(sscanf(text, "%u,%u,%u,%u", &minCutoff, &beta, &speedCutoff, &predictMicros) != 4) return false;
+  if(minCutoff > 0xFFFF || beta > 0xFFFF || speedCutoff > 0xFFFF || predictMicros > 0xFFFF) return false;
+
+  config->minCutoff = (uint16_t)minCutoff;
+  config->beta = (uint16_t)beta;
+  config->speedCutoff = (uint16_t)speedCutoff;
+  config->predictMicros = (uint16_t)predictMicros;
+  return true;
+}
+
+static int usage(void)
+{
+  fprintf(stderr, "usage: pinnacle_replay -r <file> [loops]\n"
+    "       pinnacle_replay [-c] [-m map] [-s WxH] [-p] [-g] [-f settings] [-n count] [-d digest] [-t telemetry] <file>\n");
+  return 2;
+}
+
+int main(int argc, char ** argv)
+{
+  replayOptions_t options;
+  replayResult_t result;
+  traceReader_t reader;
+  rawPacket_t * packets = NULL;
+  const char * path = NULL;
+  const char * mapPath = NULL;
+  const char * telemetryPath = NULL;
+  telemetry_t telemetry;
+  uint32_t repeats = 1;
+  uint32_t expected = 0;
+  bool checkDigest = false;
+  unsigned width, height;
+  uint64_t started, elapsed;
+  uint32_t count, pass;
+  int i;
+
+  memset(&options, 0, sizeof(options));
+  options.xCenter = (PINNACLE_XMAX + 1) / 2;
+  options.yCenter = (PINNACLE_YMAX + 1) / 2;
+
+  if(argc >= 3 && strcmp(argv[1], "-r") == 0)
+  {
+    return recordSession(argv[2], (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0) : 1);
+  }
+
+  for(i = 1; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-c") == 0) options.curved = true;
+    else if(strcmp(argv[i], "-p") == 0) options.print = true;
+    else if(strcmp(argv[i], "-g") == 0) options.gestures = true;
+    else if(strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+    {
+      MotionFilter_initConfig(&options.filterConfig);
+      options.filter = true;
+      if(strcmp(argv[++i], "default") != 0 && !parseFilter(argv[i], &options.filterConfig)) return usage();
+    }
+    else if(strcmp(argv[i], "-m") == 0 && i + 1 < argc) mapPath = argv[++i];
+    else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc) telemetryPath = argv[++i];
+    else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) repeats = (uint32_t)strtoul(argv[++i], NULL, 0);
+    else if(strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+    {
+      expected = (uint32_t)strtoul(argv[++i], NULL, 0);
+      checkDigest = true;
+    }
+    else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc && sscanf(argv[++i], "%ux%u", &width, &height) == 2)
+    {
+      options.scale = true;
+      Transform_init(&options.transform, (uint16_t)width, (uint16_t)height, TRANSFORM_ROTATE_0);
+      options.xCenter = (uint16_t)(width / 2);
+      options.yCenter = (uint16_t)(height / 2);
+    }
+    else if(argv[i][0] != '-' && !path) path = argv[i];
+    else return usage();
+  }
+  if(!path || repeats == 0) return usage();
+
+  Gesture_initConfig(&options.gestureConfig);
+  options.gestureConfig.xCenter = options.xCenter;
+  options.gestureConfig.yCenter = options.yCenter;
+
+  if(mapPath)
+  {
+    uint8_t blob[HOVER_MAP_BLOB_SIZE];
+    hoverMap_t map;
+    FILE * file = fopen(mapPath, "rb");
+
+    if(!file || fread(blob, 1, sizeof(blob), file) != sizeof(blob) || !HoverMap_load(&map, blob))
+    {
+      fprintf(stderr, "%s: not a hover map\n", mapPath);
+      return 1;
+    }
+    fclose(file);
+    Pinnacle_setHoverMap(&map);
+  }
+
+  count = loadTrace(path, &packets, &reader);
+  if(count == 0)
+  {
+    fprintf(stderr, "%s: no packets\n", path);
+    free(packets);
+    return 1;
+  }
+
+  if(telemetryPath)
+  {
+    if(!(_telemetryFile = fopen(telemetryPath, "wb")))
+    {
+      perror(telemetryPath);
+      free(packets);
+      return 1;
+    }
+    Telemetry_init(&telemetry, 8, 0, writeTelemetry);
+    options.telemetry = &telemetry;
+  }
+
+  started = cpuNow();
+  for(pass = 0; pass < repeats; pass++)
+  {
+    replay(packets, count, &options, &result);
+    if(options.telemetry)
+    {
+      Telemetry_flush(options.telemetry);
+      options.telemetry = NULL;   // one copy of the output is enough
+      fclose(_telemetryFile);
+    }
+  }
+  elapsed = cpuNow() - started;
+
+  fprintf(stderr, "%s: %u packets, %u bytes skipped\n", path, count, reader.skipped);
+  fprintf(stderr, "replayed %llu packets in %.1f ms: %.1f ns/packet\n", (unsigned long long)count * repeats,
+    elapsed / 1e6, (double)elapsed / ((double)count * repeats));
+  fprintf(stderr, "hovering %u, taps Q0 %u Q1 %u Q2 %u Q3 %u\n", result.hovering, result.taps[0], result.taps[1],
+    result.taps[2], result.taps[3]);
+  if(options.filter && result.filtered)
+  {
+    fprintf(stderr, "filter %u,%u,%u,%u: jitter %.2f -> %.2f counts/packet, %.2f counts from the raw position\n",
+      options.filterConfig.minCutoff, options.filterConfig.beta, options.filterConfig.speedCutoff,
+      options.filterConfig.predictMicros, (double)result.rawJitter / result.filtered,
+      (double)result.filteredJitter / result.filtered, (double)result.filterOffset / result.filtered);
+  }
+  if(options.gestures)
+  {
+    fprintf(stderr, "gestures: taps %u, swipes %u, rotations %u (%d steps)\n", result.gestures[GESTURE_TAP],
+      result.gestures[GESTURE_SWIPE], result.gestures[GESTURE_ROTATE], result.steps);
+  }
+  fprintf(stderr, "digest 0x%08x\n", result.digest);
+  free(packets);
+
+  if(checkDigest && result.digest != expected)
+  {
+    fprintf(stderr, "digest MISMATCH, expected 0x%08x\n", expected);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// ___ Decoder for the binary telemetry stream (Telemetry.h) ___
+// Reads a captured stream (the Command Panel's 'b' output, or pinnacle_replay -t) from a file or
+// stdin and prints the reports in the Command Panel's text columns, followed by a summary of frames,
+// missing records, CRC errors and bytes that didn't belong to a frame.
+// Usage: telemetry_decode [-q] [-c] [file]
+//   -q  summary only
+//   -c  exit non-zero if any record was lost or any frame was corrupt (for CI)
+
+#include <stdio.h>
+#include <string.h>
+#include "Telemetry.h"
+
+static void printRecord(const telemetryRecord_t * record)
+{
+  if(record->info & TELEMETRY_RELATIVE)
+  {
+    printf("%5u SENS_%u %d\t%d\t%d\t%u\n", record->sequence, record->info & TELEMETRY_SENSOR, record->xValue,
+      record->yValue, record->zValue, record->buttons);
+  }
+  else
+  {
+    printf("%5u SENS_%u %u\t%u\t%u%s\t%u\n", record->sequence, record->info & TELEMETRY_SENSOR,
+      (uint16_t)record->xValue, (uint16_t)record->yValue, (uint8_t)record->zValue,
+      (record->info & TELEMETRY_HOVERING) ? " - h" : "", record->buttons);
+  }
+}
+
+int main(int argc, char ** argv)
+{
+  telemetryReader_t reader;
+  FILE * file = stdin;
+  const char * path = NULL;
+  uint32_t records = 0;
+  bool quiet = false;
+  bool check = false;
+  int data, i;
+
+  for(i = 1; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-q") == 0) quiet = true;
+    else if(strcmp(argv[i], "-c") == 0) check = true;
+    else if(argv[i][0] != '-' && !path) path = argv[i];
+    else
+    {
+      fprintf(stderr, "usage: telemetry_decode [-q] [-c] [file]\n");
+      return 2;
+    }
+  }
+
+  if(path && !(file = fopen(path, "rb")))
+  {
+    perror(path);
+    return 1;
+  }
+
+  Telemetry_initReader(&reader);
+  while((data = fgetc(file)) != EOF)
+  {
+    if(!Telemetry_feed(&reader, (uint8_t)data)) continue;
+
+    records += reader.count;
+    for(i = 0; !quiet && i < reader.count; i++)
+    {
+      printRecord(&reader.records[i]);
+    }
+  }
+  if(file != stdin) fclose(file);
+
+  fprintf(stderr, "%u frames, %u records, %u lost, %u crc errors, %u bytes skipped\n", reader.frames, records,
+    reader.lost, reader.crcErrors, reader.skipped);
+
+  return (check && (reader.lost || reader.crcErrors || records == 0)) ? 1 : 0;
+}
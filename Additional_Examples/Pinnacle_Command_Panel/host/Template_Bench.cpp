@@ -0,0 +1,194 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+// ___ Pinnacle.hpp versus the C API on the simulated 1CA027 ___
+// Reads the same packets through Pinnacle_getTouchData() and through Pinnacle<...>::read() and
+// reports host CPU time per packet, for the whole read path (simulated bus included) and for the
+// decode step alone. `make size` compares the code size of the two read paths.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "Pinnacle.hpp"
+#include "Hardware.h"
+#include "Hardware_Sim.h"
+
+#define PACKET_COUNT    20000
+#define DECODE_COUNT    10000000
+#define DECODE_PACKETS  64
+
+typedef Pinnacle<PinnacleSpi<0>, PinnacleFlat, PinnacleAbsolute> flatPad_t;
+typedef Pinnacle<PinnacleSpi<0>, PinnacleCurved, PinnacleAbsolute> curvedPad_t;
+
+static flatPad_t _flatPad;
+static curvedPad_t _curvedPad;
+
+// The read paths under test, kept out of line so `make size` can find them
+extern "C" __attribute__((noinline)) void readWithCApi(touchData_t * touchData)
+{
+  Pinnacle_getTouchData(touchData, 0);
+}
+
+extern "C" __attribute__((noinline)) void readWithTemplateFlat(absData_t * data)
+{
+  _flatPad.read(data);
+}
+
+extern "C" __attribute__((noinline)) void readWithTemplateCurved(absData_t * data)
+{
+  _curvedPad.read(data);
+}
+
+extern "C" __attribute__((noinline)) void decodeWithCApi(const uint8_t * packet, touchData_t * touchData)
+{
+  Pinnacle_decodeAbsolute(packet, touchData);
+}
+
+extern "C" __attribute__((noinline)) void decodeWithTemplateFlat(const uint8_t * packet, absData_t * data)
+{
+  PinnacleAbsolute::decode(packet, data);
+  PinnacleFlat::filter(data);
+}
+
+static uint64_t cpuNow(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void setupSensor(touchData_t * touchData, uint8_t overlayMode)
+{
+  SIM_reset(1);
+  HW_init();
+  SPI_init(1000000, MSBFIRST, SPI_MODE1);
+
+  memset(touchData, 0, sizeof(touchData_t));
+  Pinnacle_init(touchData, 0);
+  touchData->overlayMode = overlayMode;   // threshold only; the attenuation doesn't change the bus cost
+  Pinnacle_clearFlags(0);
+  Pinnacle_enableFastRead(true, 0);
+}
+
+static void pushPacket(uint32_t i)
+{
+  SIM_pushAbsolute(0, 128 + (i & 0x3FF), 64 + (i & 0x1FF), 40, 0);
+  SIM_advance(DR_SETTLE_MICROS * 1000);
+}
+
+#define RUNS 5   // each figure is the best of this many runs, host timing is noisy
+
+// Whole read path, from DR to decoded data. Returns CPU ns per packet; <checksum> catches a path
+// that decodes differently from the others.
+static double benchReadOnce(uint8_t overlayMode, int path, uint32_t * checksum)
+{
+  touchData_t touchData;
+  absData_t data;
+  uint64_t started;
+  uint32_t i;
+
+  setupSensor(&touchData, overlayMode);
+  memset(&data, 0, sizeof(data));
+  *checksum = 0;
+
+  started = cpuNow();
+  for(i = 0; i < PACKET_COUNT; i++)
+  {
+    pushPacket(i);
+    if(path == 0)
+    {
+      readWithCApi(&touchData);
+      data = touchData.absolute;
+    }
+    else if(path == 1)
+    {
+      readWithTemplateFlat(&data);
+    }
+    else
+    {
+      readWithTemplateCurved(&data);
+    }
+    *checksum += data.xValue + data.yValue + data.zValue + data.hovering;
+  }
+
+  return (double)(cpuNow() - started) / PACKET_COUNT;
+}
+
+static double benchRead(uint8_t overlayMode, int path, uint32_t * checksum)
+{
+  double best = benchReadOnce(overlayMode, path, checksum);
+  double ns;
+  int i;
+
+  for(i = 1; i < RUNS; i++)
+  {
+    ns = benchReadOnce(overlayMode, path, checksum);
+    if(ns < best) best = ns;
+  }
+  return best;
+}
+
+// Decode step only, over a fixed set of packets
+static double benchDecode(int path, uint32_t * checksum)
+{
+  uint8_t packets[DECODE_PACKETS][6];
+  touchData_t touchData;
+  absData_t data;
+  uint64_t started;
+  uint32_t i;
+
+  for(i = 0; i < DECODE_PACKETS; i++)
+  {
+    packets[i][0] = 0;
+    packets[i][1] = 0;
+    packets[i][2] = (uint8_t)(i * 29);
+    packets[i][3] = (uint8_t)(i * 13);
+    packets[i][4] = (uint8_t)(i * 7);
+    packets[i][5] = (uint8_t)(i & 0x3F);
+  }
+  memset(&touchData, 0, sizeof(touchData));
+  memset(&data, 0, sizeof(data));
+  touchData.overlayMode = FLAT;
+  *checksum = 0;
+
+  started = cpuNow();
+  for(i = 0; i < DECODE_COUNT; i++)
+  {
+    if(path == 0)
+    {
+      decodeWithCApi(packets[i % DECODE_PACKETS], &touchData);
+      *checksum += touchData.absolute.xValue;
+    }
+    else
+    {
+      decodeWithTemplateFlat(packets[i % DECODE_PACKETS], &data);
+      *checksum += data.xValue;
+    }
+  }
+
+  return (double)(cpuNow() - started) / DECODE_COUNT;
+}
+
+int main()
+{
+  uint32_t checkC, checkFlat, checkCurvedC, checkCurved, decodeC, decodeFlat;
+  double readC, readFlat, readCurvedC, readCurved, nsDecodeC, nsDecodeFlat;
+
+  readC = benchRead(FLAT, 0, &checkC);
+  readFlat = benchRead(FLAT, 1, &checkFlat);
+  readCurvedC = benchRead(CURVED, 0, &checkCurvedC);
+  readCurved = benchRead(CURVED, 2, &checkCurved);
+  nsDecodeC = benchDecode(0, &decodeC);
+  nsDecodeFlat = benchDecode(1, &decodeFlat);
+
+  printf("%-36s %12s %12s\n", "cpu ns/packet", "C API", "template");
+  printf("%-36s %12.1f %12.1f\n", "flat absolute, read (sim bus)", readC, readFlat);
+  printf("%-36s %12.1f %12.1f\n", "curved absolute, read (sim bus)", readCurvedC, readCurved);
+  printf("%-36s %12.2f %12.2f\n", "flat absolute, decode only", nsDecodeC, nsDecodeFlat);
+
+  if(checkC != checkFlat || checkCurvedC != checkCurved || decodeC != decodeFlat)
+  {
+    printf("MISMATCH between the C API and the template front-end\n");
+    return 1;
+  }
+  return 0;
+}
@@ -106,19 +106,25 @@ typedef struct _absData
   bool hovering;
 } absData_t;
 
-absData_t touchData_Sense0;
-absData_t touchData_Sense1;
-
-// Used to differentiate between the two sensors
+// Used to differentiate between the sensors. Add a line per pad to run more of them.
 typedef struct _padData
 {
   uint8_t CS_Pin;
   uint8_t DR_Pin;
   uint8_t LED_Pin;
+  bool selected;    // pad is active
+  bool curved;      // pad has a curved overlay
 } padData_t;
 
-padData_t Pad_Sense0;
-padData_t Pad_Sense1;
+padData_t pads[] =
+{
+  { CS0_PIN, DR0_PIN, LED_0, SENSE0_SELECT, SENSE0_OVERLAY_CURVE },
+  { CS1_PIN, DR1_PIN, LED_1, SENSE1_SELECT, SENSE1_OVERLAY_CURVE },
+};
+
+#define PAD_COUNT (sizeof(pads) / sizeof(pads[0]))
+
+absData_t touchData[PAD_COUNT];
 
 // These values require tuning for optimal touch-response
 // Each element represents the Z-value below which is considered "hovering" in that XY region of the sensor.
@@ -139,34 +145,20 @@ void setup()
   Serial.begin(9600);
   while(!Serial); // needed for USB
   String str = "";
+  uint8_t i;
 
-  pinMode(LED_0, OUTPUT);
-  pinMode(LED_1, OUTPUT);
-
-  Pad_Sense0.CS_Pin = CS0_PIN;
-  Pad_Sense0.DR_Pin = DR0_PIN;
-  Pad_Sense0.LED_Pin = LED_0;
-
-  Pad_Sense1.CS_Pin = CS1_PIN;
-  Pad_Sense1.DR_Pin = DR1_PIN;
-  Pad_Sense1.LED_Pin = LED_1;
-
-  if(SENSE0_SELECT) Pinnacle_Init(&Pad_Sense0);
-  if(SENSE1_SELECT) Pinnacle_Init(&Pad_Sense1);
-
-  // These functions are required for use with thick overlays (curved)
-  if(SENSE0_OVERLAY_CURVE)
+  for(i = 0; i < PAD_COUNT; i++)
   {
-    setAdcAttenuation(ADC_ATTENUATE_2X, &Pad_Sense0);
-    tuneEdgeSensitivity(&Pad_Sense0);
-    Pinnacle_forceCalibration(&Pad_Sense0);
-  }
+    pinMode(pads[i].LED_Pin, OUTPUT);
+    if(pads[i].selected) Pinnacle_Init(&pads[i]);
 
-  if(SENSE1_OVERLAY_CURVE)
-  {
-    setAdcAttenuation(ADC_ATTENUATE_2X, &Pad_Sense1);
-    tuneEdgeSensitivity(&Pad_Sense1);
-    Pinnacle_forceCalibration(&Pad_Sense1);
+    // These functions are required for use with thick overlays (curved)
+    if(pads[i].curved)
+    {
+      setAdcAttenuation(ADC_ATTENUATE_2X, &pads[i]);
+      tuneEdgeSensitivity(&pads[i]);
+      Pinnacle_forceCalibration(&pads[i]);
+    }
   }
 
   Serial.println();
@@ -176,57 +168,56 @@ void setup()
     ("BOTH SENSORS DISABLED .. ENABLE SENSOR SELECT");
   Serial.println(str);
 
-  Pinnacle_EnableFeed(true, &Pad_Sense0);
-  Pinnacle_EnableFeed(true, &Pad_Sense1);
+  for(i = 0; i < PAD_COUNT; i++)
+  {
+    Pinnacle_EnableFeed(true, &pads[i]);
+  }
 }
 
 // loop() continuously checks to see if data-ready (DR) is high. If so, reads and reports touch data to terminal.
 void loop()
 {
   String printData = "";
+  uint8_t emptyColumns = 0;   // selected pads without data since the last printed column
+  uint8_t i;
 
-  // Note: the two Pinnacles are not synchronized. In a polling loop like this you
-  // may get one or both of the sensors reporting new data. We just grab what data
-  // there is and write it.
-  if(DR_Asserted(&Pad_Sense0) && SENSE0_SELECT)
+  // Note: the Pinnacles are not synchronized. In a polling loop like this you
+  // may get any number of the sensors reporting new data. We just grab what data
+  // there is and write it, one column per pad.
+  for(i = 0; i < PAD_COUNT; i++)
   {
-    Pinnacle_GetAbsolute(&touchData_Sense0, &Pad_Sense0);
-    Pinnacle_CheckValidTouch(&touchData_Sense0);     // Checks for "hover" caused by curved overlays
-    ScaleData(&touchData_Sense0, 1024, 1024);      // Scale coordinates to arbitrary X, Y resolution
+    if(!pads[i].selected) continue;
 
-    printData += "SENS_0 ";
-
-    Pinnacle_DataToString(&touchData_Sense0, &printData, SENSE0_OVERLAY_CURVE);
-    
-    if(SENSE1_SELECT && !DR_Asserted(&Pad_Sense1))
+    if(!DR_Asserted(&pads[i]))
     {
-      printData += "\t\t\t\t\t\t" + String(touchData_Sense0.buttonFlags);
+      emptyColumns++;
+      continue;
     }
-  }
 
-  if(DR_Asserted(&Pad_Sense1) && SENSE1_SELECT)
-  {
-    Pinnacle_GetAbsolute(&touchData_Sense1, &Pad_Sense1);
-    Pinnacle_CheckValidTouch(&touchData_Sense1);     // Checks for "hover" caused by curved overlays
-    ScaleData(&touchData_Sense1, 1024, 1024);      // Scale coordinates to arbitrary X, Y resolution
+    Pinnacle_GetAbsolute(&touchData[i], &pads[i]);
+    Pinnacle_CheckValidTouch(&touchData[i]);     // Checks for "hover" caused by curved overlays
+    ScaleData(&touchData[i], 1024, 1024);      // Scale coordinates to arbitrary X, Y resolution
 
-    printData += (SENSE0_SELECT && printData.length() == 0) ? ("\t\t\t\t\tSENS_1 ") :
-      (SENSE0_SELECT) ? "\t\tSENS_1 " :
-       "SENS_1 ";
+    // An empty column takes the tabs of a printed one: two between x, y and z, two to the next column
+    if(printData.length() != 0) printData += "\t\t";
+    for(; emptyColumns > 0; emptyColumns--) printData += "\t\t\t\t";
+    printData += "SENS_" + String(i) + " ";
 
-    Pinnacle_DataToString(&touchData_Sense1, &printData, SENSE1_OVERLAY_CURVE);
-    printData += "\t" + String(touchData_Sense0.buttonFlags);
+    Pinnacle_DataToString(&touchData[i], &printData, pads[i].curved);
   }
 
   if (printData.length() != 0)
   {
-      // if there is data to write then write it
+      // if there is data to write then write it, with the buttons of Sensor 0
+      printData += "\t" + String(touchData[0].buttonFlags);
       printData += "\n";
       Serial.print(printData);
   }
 
-  AssertSensorLED(touchData_Sense0.touchDown, Pad_Sense0.LED_Pin);
-  AssertSensorLED(touchData_Sense1.touchDown, Pad_Sense1.LED_Pin);
+  for(i = 0; i < PAD_COUNT; i++)
+  {
+    AssertSensorLED(touchData[i].touchDown, pads[i].LED_Pin);
+  }
 }
 
 // General Print function to display the parameters
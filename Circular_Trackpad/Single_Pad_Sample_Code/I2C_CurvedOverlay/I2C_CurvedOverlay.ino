@@ -354,7 +354,7 @@ void RAP_Init()
 {
   // Set up I2C peripheral
   Wire.begin();
-  Wire.setClock(100000);
+  Wire.setClock(400000);    // Pinnacle supports up to 1000000 (Fast-mode plus)
 }
 
 // Reads <count> Pinnacle registers starting at <address>
@@ -365,7 +365,7 @@ void RAP_ReadBytes(byte address, byte * data, byte count)
 
   Wire.beginTransmission(SLAVE_ADDR);   // Set up an I2C-write to the I2C slave (Pinnacle)
   Wire.write(cmdByte);                  // Signal a RAP-read operation starting at <address>
-  Wire.endTransmission(true);           // I2C stop condition
+  Wire.endTransmission(false);          // No stop condition, the read follows with a repeated start
 
   Wire.requestFrom((uint8_t)SLAVE_ADDR, count, (uint8_t)true);  // Read <count> bytes from I2C slave
   while(Wire.available())
@@ -380,8 +380,8 @@ void RAP_Write(byte address, byte data)
   uint8_t cmdByte = WRITE_MASK | address;  // Form the WRITE command byte
 
   Wire.beginTransmission(SLAVE_ADDR);   // Set up an I2C-write to the I2C slave (Pinnacle)
-  Wire.send(cmdByte);                   // Signal a RAP-write operation at <address>
-  Wire.send(data);                      // Write <data> to I2C slave
+  Wire.write(cmdByte);                  // Signal a RAP-write operation at <address>
+  Wire.write(data);                     // Write <data> to I2C slave
   Wire.endTransmission(true);           // I2C stop condition
 }
 
@@ -48,7 +48,7 @@
 #define SYSCONFIG_1_ADDR   0x03
 #define FEEDCONFIG_1_DATA  0x81  //0x01 = relative, 0x03 = absolute, 0x80 = invert Y-axis
 #define FEEDCONFIG_1_ADDR  0x04
-#define FEEDCONFIG_2_DATA  0x1C // disable scroll, disable rtap
+#define FEEDCONFIG_2_DATA  0x15 // Intellimouse packets with scroll, disable rtap
 #define FEEDCONFIG_2_ADDR  0x05
 #define Z_IDLE_COUNT  0x05
 #define PACKETBYTE_0_ADDRESS 0x12
@@ -96,6 +96,38 @@ typedef struct _relData
 
 relData_t relData;
 
+// Pointer motion: an acceleration curve, with the fractions of a pixel carried over to the next packet
+// and large moves spread over several reports (a copy of Pointer.c in
+// Additional_Examples/Pinnacle_Command_Panel, where the host bench measures it)
+#define POINTER_GAIN_ONE    256     // gains are in 1/256 pixel per count
+#define POINTER_CURVE_SIZE  64
+#define POINTER_MAX_REPORT  127
+#define POINTER_MAX_PENDING (1024L * POINTER_GAIN_ONE)
+
+// Gain for each speed in counts per packet: 1/2 up to 2, 1 at 6, 2 at 20, 3 from 40 on
+const uint16_t POINTER_GAIN[POINTER_CURVE_SIZE] =
+{
+  128, 128, 128, 160, 192, 224, 256, 274, 292, 310, 329, 347, 365, 384, 402, 420,
+  438, 457, 475, 493, 512, 524, 537, 550, 563, 576, 588, 601, 614, 627, 640, 652,
+  665, 678, 691, 704, 716, 729, 742, 755, 768, 768, 768, 768, 768, 768, 768, 768,
+  768, 768, 768, 768, 768, 768, 768, 768, 768, 768, 768, 768, 768, 768, 768, 768,
+};
+
+int32_t xPending = 0;   // motion not reported yet, in 1/256 pixel
+int32_t yPending = 0;
+
+// USB reports: at most one per 1 ms frame, and only when something changed (a copy of HidReport.c
+// in Additional_Examples/Pinnacle_Command_Panel, for one pad)
+#define USB_FRAME_MICROS  1000
+#define REPORT_MAX_WHEEL  127
+#define REPORT_MAX_SCROLL 1024
+
+uint8_t buttonsHeld = 0;      // as of the last packet
+uint8_t buttonsPressed = 0;   // went down since the last report
+uint8_t buttonsSent = 0;
+int16_t wheelPending = 0;     // scroll counts not reported yet
+uint32_t lastReportAt = 0;
+
 // These values require tuning for optimal touch-response
 // Each element represents the Z-value below which is considered "hovering" in that XY region of the sensor.
 // The values present are not guaranteed to work for all HW configurations.
@@ -129,19 +161,86 @@ void loop()
   if(DR_Asserted())
   {
     Pinnacle_GetRelative(&relData);
-    Mouse.move(relData.xDelta, relData.yDelta);
-    if(relData.buttonFlags & 0x01)
-      Mouse.click();
+    Report_AddPacket(&relData);
   }
+  Report_Send();    // one report per USB frame at the most, what's left goes in the next ones
   AssertSensorLED(touchData.touchDown);
 }
 
+/*  Pointer Motion Functions  */
+// Adds the deltas of one packet, scaled by the gain for their speed, to the motion waiting for a report
+void Pointer_Add(int16_t xDelta, int16_t yDelta)
+{
+  uint16_t xSize = abs(xDelta);
+  uint16_t ySize = abs(yDelta);
+  uint16_t speed = (xSize > ySize) ? xSize + ySize / 2 : ySize + xSize / 2;
+  uint16_t gain = POINTER_GAIN[(speed < POINTER_CURVE_SIZE) ? speed : POINTER_CURVE_SIZE - 1];
+
+  xPending = constrain(xPending + (int32_t)xDelta * gain, -POINTER_MAX_PENDING, POINTER_MAX_PENDING);
+  yPending = constrain(yPending + (int32_t)yDelta * gain, -POINTER_MAX_PENDING, POINTER_MAX_PENDING);
+}
+
+// Takes the next report, up to POINTER_MAX_REPORT per axis, out of the motion waiting. Returns false
+// while there isn't a whole pixel to report; fractions stay for later, rounded towards zero.
+bool Pointer_NextReport(int8_t * xMove, int8_t * yMove)
+{
+  int32_t x = constrain(xPending / POINTER_GAIN_ONE, -POINTER_MAX_REPORT, POINTER_MAX_REPORT);
+  int32_t y = constrain(yPending / POINTER_GAIN_ONE, -POINTER_MAX_REPORT, POINTER_MAX_REPORT);
+
+  if(x == 0 && y == 0) return false;
+
+  xPending -= x * POINTER_GAIN_ONE;
+  yPending -= y * POINTER_GAIN_ONE;
+  *xMove = (int8_t)x;
+  *yMove = (int8_t)y;
+  return true;
+}
+
+/*  USB Report Functions  */
+// Adds one packet to the next report: motion through Pointer_Add(), scroll summed, buttons edge-detected
+void Report_AddPacket(relData_t * packet)
+{
+  Pointer_Add(packet->xDelta, packet->yDelta);
+  wheelPending = constrain(wheelPending + packet->scrollWheel, -REPORT_MAX_SCROLL, REPORT_MAX_SCROLL);
+  buttonsHeld = packet->buttonFlags;
+  buttonsPressed |= buttonsHeld & ~buttonsSent;
+}
+
+// Sends what has been collected, if the last report is a frame old. A press or release goes out on its
+// own (Mouse.set_buttons() makes a report) and the motion follows in the next frame; a press released
+// before its report still makes a click.
+void Report_Send()
+{
+  uint32_t now = micros();
+  uint8_t buttons = buttonsHeld | buttonsPressed;
+  int8_t xMove = 0, yMove = 0, wheel;
+
+  if(now - lastReportAt < USB_FRAME_MICROS) return;
+
+  if(buttons != buttonsSent)
+  {
+    // Pinnacle's buttons: 0x01 primary, 0x02 secondary, 0x04 auxiliary
+    Mouse.set_buttons(buttons & 0x01, (buttons >> 2) & 0x01, (buttons >> 1) & 0x01);
+    buttonsSent = buttons;
+    buttonsPressed = 0;
+    lastReportAt = now;
+    return;
+  }
+
+  wheel = constrain(wheelPending, -REPORT_MAX_WHEEL, REPORT_MAX_WHEEL);
+  if(!Pointer_NextReport(&xMove, &yMove) && wheel == 0) return;
+
+  wheelPending -= wheel;
+  Mouse.move(xMove, yMove, wheel);
+  lastReportAt = now;
+}
+
 /*  Pinnacle-based TM0XX0XX Functions  */
 void Pinnacle_Init()
 {
   // Set up I2C peripheral
   Wire.begin();
-  Wire.setClock(100000);
+  Wire.setClock(400000);    // Pinnacle supports up to 1000000 (Fast-mode plus)
   pinMode(DR_PIN, INPUT);
 
   // Host clears SW_CC flag
@@ -168,8 +267,8 @@ void Pinnacle_GetRelative(relData_t * result)
   Pinnacle_ClearFlags();
 
   result->buttonFlags = data[0] & 0x07;
-  result->xDelta = data[1] | ((data[0]&0x10)<<8);
-  result->yDelta = data[2] | ((data[0]&0x20)<<8);
+  result->xDelta = (int16_t)(data[1] | ((data[0] & 0x10) ? 0xFF00 : 0));   // 9-bit, sign in byte 0
+  result->yDelta = (int16_t)(data[2] | ((data[0] & 0x20) ? 0xFF00 : 0));
   result->scrollWheel = data[3];
 }
 
@@ -314,7 +413,7 @@ void RAP_ReadBytes(uint8_t address, uint8_t * data, uint8_t count)
 
   Wire.beginTransmission(SLAVE_ADDR);   // Set up an I2C-write to the I2C slave (Pinnacle)
   Wire.write(cmdByte);                  // Signal a RAP-read operation starting at <address>
-  Wire.endTransmission(true);           // I2C stop condition
+  Wire.endTransmission(false);          // No stop condition, the read follows with a repeated start
 
   Wire.requestFrom((uint8_t)SLAVE_ADDR, count, (uint8_t)true);  // Read <count> bytes from I2C slave
   while(Wire.available())
@@ -329,8 +428,8 @@ void RAP_Write(uint8_t address, uint8_t data)
   uint8_t cmdByte = WRITE_MASK | address;  // Form the WRITE command byte
 
   Wire.beginTransmission(SLAVE_ADDR);   // Set up an I2C-write to the I2C slave (Pinnacle)
-  Wire.send(cmdByte);                   // Signal a RAP-write operation at <address>
-  Wire.send(data);                      // Write <data> to I2C slave
+  Wire.write(cmdByte);                  // Signal a RAP-write operation at <address>
+  Wire.write(data);                     // Write <data> to I2C slave
   Wire.endTransmission(true);           // I2C stop condition
 }
 
@@ -98,7 +98,7 @@ void Pinnacle_Init()
 {
   // Set up I2C peripheral
   Wire.begin();
-  Wire.setClock(100000);
+  Wire.setClock(400000);    // Pinnacle supports up to 1000000 (Fast-mode plus)
 
   pinMode(DR_PIN, INPUT);
 
@@ -219,7 +219,7 @@ void RAP_ReadBytes(uint8_t address, uint8_t * data, uint8_t count)
 
   Wire.beginTransmission(SLAVE_ADDR);   // Set up an I2C-write to the I2C slave (Pinnacle)
   Wire.write(cmdByte);                  // Signal a RAP-read operation starting at <address>
-  Wire.endTransmission(true);           // I2C stop condition
+  Wire.endTransmission(false);          // No stop condition, the read follows with a repeated start
 
   Wire.requestFrom((uint8_t)SLAVE_ADDR, count, (uint8_t)true);  // Read <count> bytes from I2C slave
   while(Wire.available())
@@ -234,8 +234,8 @@ void RAP_Write(uint8_t address, uint8_t data)
   uint8_t cmdByte = WRITE_MASK | address;  // Form the WRITE command byte
 
   Wire.beginTransmission(SLAVE_ADDR);   // Set up an I2C-write to the I2C slave (Pinnacle)
-  Wire.send(cmdByte);                   // Signal a RAP-write operation at <address>
-  Wire.send(data);                      // Write <data> to I2C slave
+  Wire.write(cmdByte);                  // Signal a RAP-write operation at <address>
+  Wire.write(data);                     // Write <data> to I2C slave
   Wire.endTransmission(true);           // I2C stop condition
 }
 
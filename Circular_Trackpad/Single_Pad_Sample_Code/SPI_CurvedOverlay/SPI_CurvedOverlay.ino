@@ -67,6 +67,17 @@
 #define ADC_ATTENUATE_3X   0x80
 #define ADC_ATTENUATE_4X   0xC0
 
+// Output format: 0 = text (one line per packet), 1 = binary telemetry frames.
+// Binary frames use the format of Telemetry.h in Additional_Examples/Pinnacle_Command_Panel; decode them
+// with host/telemetry_decode from there.
+#define BINARY_OUTPUT           0
+#define TELEMETRY_SYNC_0        0xC5
+#define TELEMETRY_SYNC_1        0x3A
+#define TELEMETRY_HEADER_SIZE   5
+#define TELEMETRY_RECORD_SIZE   7
+#define TELEMETRY_BATCH         8       // records per frame; 8 make a 63-byte frame, one USB packet
+#define TELEMETRY_HOVERING      0x08
+
 // Convenient way to store and access measurements
 typedef struct _absData
 {
@@ -80,6 +91,11 @@ typedef struct _absData
 
 absData_t touchData;
 
+// Telemetry frame under construction
+uint8_t telemetryFrame[TELEMETRY_HEADER_SIZE + TELEMETRY_BATCH * TELEMETRY_RECORD_SIZE + 2];
+uint8_t telemetryCount = 0;
+uint16_t telemetrySequence = 0;
+
 //const uint16_t ZONESCALE = 256;
 //const uint16_t ROWS_Y = 6;
 //const uint16_t COLS_X = 8;
@@ -112,7 +128,7 @@ void setup()
   tuneEdgeSensitivity();
 
   Serial.println();
-  Serial.println("X\tY\tZ\tBtn\tData");
+  if(!BINARY_OUTPUT) Serial.println("X\tY\tZ\tBtn\tData");
   Pinnacle_EnableFeed(true);
 }
 
@@ -126,6 +142,13 @@ void loop()
 
 //    ScaleData(&touchData, 1024, 1024);      // Scale coordinates to arbitrary X, Y resolution
 
+    if(BINARY_OUTPUT)
+    {
+      Telemetry_AddRecord(&touchData);
+      AssertSensorLED(touchData.touchDown);
+      return;
+    }
+
     Serial.print(touchData.xValue);
     Serial.print('\t');
     Serial.print(touchData.yValue);
@@ -150,6 +173,56 @@ void loop()
   AssertSensorLED(touchData.touchDown);
 }
 
+/*  Binary telemetry  */
+// Appends <data> to the telemetry frame and sends the frame, in one write, once it holds
+// TELEMETRY_BATCH records. Z-idle packets flush a partial frame so liftoff isn't delayed.
+void Telemetry_AddRecord(absData_t * data)
+{
+  uint8_t * record = &telemetryFrame[TELEMETRY_HEADER_SIZE + telemetryCount * TELEMETRY_RECORD_SIZE];
+
+  record[0] = data->hovering ? TELEMETRY_HOVERING : 0;
+  record[1] = (uint8_t)data->xValue;
+  record[2] = (uint8_t)(data->xValue >> 8);
+  record[3] = (uint8_t)data->yValue;
+  record[4] = (uint8_t)(data->yValue >> 8);
+  record[5] = (uint8_t)data->zValue;
+  record[6] = data->buttonFlags;
+
+  telemetryCount++;
+  telemetrySequence++;
+  if(telemetryCount == TELEMETRY_BATCH || Pinnacle_zIdlePacket(data)) Telemetry_SendFrame();
+}
+
+// Completes the header and CRC-16/CCITT of the telemetry frame and writes it out
+void Telemetry_SendFrame()
+{
+  uint16_t length = TELEMETRY_HEADER_SIZE + telemetryCount * TELEMETRY_RECORD_SIZE;
+  uint16_t firstSequence = telemetrySequence - telemetryCount;
+  uint16_t crc = 0xFFFF;
+  uint16_t i;
+  uint8_t bit;
+
+  telemetryFrame[0] = TELEMETRY_SYNC_0;
+  telemetryFrame[1] = TELEMETRY_SYNC_1;
+  telemetryFrame[2] = telemetryCount;
+  telemetryFrame[3] = (uint8_t)firstSequence;
+  telemetryFrame[4] = (uint8_t)(firstSequence >> 8);
+
+  for(i = 2; i < length; i++)
+  {
+    crc ^= (uint16_t)telemetryFrame[i] << 8;
+    for(bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  telemetryFrame[length] = (uint8_t)(crc >> 8);
+  telemetryFrame[length + 1] = (uint8_t)crc;
+
+  Serial.write(telemetryFrame, length + 2);
+  telemetryCount = 0;
+}
+
 /*  Pinnacle-based TM0XX0XX Functions  */
 void Pinnacle_Init()
 {